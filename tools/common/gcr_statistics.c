@@ -0,0 +1,153 @@
+/*
+
+    TRACIS: tools/common/gcr_statistics.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "gcr_statistics.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+static int histogramValue(const uint16_t *counts, int nBins, int rank);
+
+// 1 for pixels in the region searched for GCRs
+static uint8_t roiMask[GCR_IMAGE_PIXELS];
+static bool roiMaskReady = false;
+
+static void initRoiMask(void)
+{
+    int row = 0;
+    int col = 0;
+    for (int i = 0; i < GCR_IMAGE_PIXELS; i++)
+    {
+        row = i % GCR_IMAGE_ROWS;
+        col = i / GCR_IMAGE_ROWS;
+        roiMask[i] = (col >= GCR_MIN_COL && row >= GCR_MIN_ROW2 && row <= GCR_MAX_ROW2) || (row >= GCR_MIN_ROW && row <= GCR_MAX_ROW);
+    }
+    roiMaskReady = true;
+
+    return;
+}
+
+// Mean and sample standard deviation of the image with pixels above
+// GCR_MAX_PIXEL_VALUE counted as 0, in one pass with exact integer sums
+void imageStatistics(const uint16_t *image, double *mean, double *stddev)
+{
+    uint64_t sum = 0;
+    uint64_t sumOfSquares = 0;
+    uint32_t value = 0;
+
+    for (int i = 0; i < GCR_IMAGE_PIXELS; i++)
+    {
+        value = image[i] <= GCR_MAX_PIXEL_VALUE ? image[i] : 0;
+        sum += value;
+        sumOfSquares += value * value;
+    }
+
+    int64_t n = GCR_IMAGE_PIXELS;
+    *mean = (double)sum / (double)n;
+    *stddev = sqrt((double)(n * (int64_t)sumOfSquares - (int64_t)(sum * sum)) / (double)(n * (n - 1)));
+
+    return;
+}
+
+// Median and median absolute deviation of the image with pixels above
+// GCR_MAX_PIXEL_VALUE counted as 0, from counting histograms rather than sorting
+void imageMedianStatistics(const uint16_t *image, double *median, double *mad)
+{
+    uint16_t counts[GCR_MAX_PIXEL_VALUE + 1] = {0};
+    // Deviations are kept doubled so that a half-integer median stays exact
+    uint16_t deviationCounts[2 * GCR_MAX_PIXEL_VALUE + 1] = {0};
+
+    for (int i = 0; i < GCR_IMAGE_PIXELS; i++)
+        counts[image[i] <= GCR_MAX_PIXEL_VALUE ? image[i] : 0]++;
+
+    // Even number of pixels: the median is the mean of the two middle values
+    int lower = histogramValue(counts, GCR_MAX_PIXEL_VALUE + 1, GCR_IMAGE_PIXELS / 2 - 1);
+    int upper = histogramValue(counts, GCR_MAX_PIXEL_VALUE + 1, GCR_IMAGE_PIXELS / 2);
+    int median2 = lower + upper;
+
+    for (int v = 0; v <= GCR_MAX_PIXEL_VALUE; v++)
+    {
+        if (counts[v] > 0)
+            deviationCounts[abs(2 * v - median2)] += counts[v];
+    }
+    lower = histogramValue(deviationCounts, 2 * GCR_MAX_PIXEL_VALUE + 1, GCR_IMAGE_PIXELS / 2 - 1);
+    upper = histogramValue(deviationCounts, 2 * GCR_MAX_PIXEL_VALUE + 1, GCR_IMAGE_PIXELS / 2);
+
+    *median = (double)median2 / 2.0;
+    *mad = (double)(lower + upper) / 4.0;
+
+    return;
+}
+
+// Value of the element with zero-based rank in sorted order
+static int histogramValue(const uint16_t *counts, int nBins, int rank)
+{
+    int seen = 0;
+    for (int v = 0; v < nBins; v++)
+    {
+        seen += counts[v];
+        if (seen > rank)
+            return v;
+    }
+
+    return nBins - 1;
+}
+
+// Number of ROI pixels more than GCR_SIGMAS spreads above the image centre,
+// where centre and spread are mean and standard deviation or median and MAD.
+// Also gives the brightest of those pixels if maxIntensity is not NULL.
+long countImageGcrs(const uint16_t *image, int statistic, uint16_t *maxIntensity)
+{
+    if (maxIntensity != NULL)
+        *maxIntensity = 0;
+
+    double centre = 0.0;
+    double spread = 0.0;
+    if (statistic == STATISTIC_MAD)
+        imageMedianStatistics(image, &centre, &spread);
+    else
+        imageStatistics(image, &centre, &spread);
+    if (!(spread > 0))
+        return 0;
+
+    // For integer pixel values, value > threshold is value > floor(threshold)
+    double threshold = floor(centre + (GCR_SIGMAS * spread));
+    if (threshold >= GCR_MAX_PIXEL_VALUE)
+        return 0;
+    uint16_t limit = (uint16_t)threshold;
+
+    if (!roiMaskReady)
+        initRoiMask();
+
+    long count = 0;
+    uint16_t brightest = 0;
+    uint16_t hot = 0;
+    for (int i = 0; i < GCR_IMAGE_PIXELS; i++)
+    {
+        hot = roiMask[i] & (image[i] > limit) & (image[i] <= GCR_MAX_PIXEL_VALUE);
+        count += hot;
+        brightest = hot && image[i] > brightest ? image[i] : brightest;
+    }
+    if (maxIntensity != NULL)
+        *maxIntensity = brightest;
+
+    return count;
+}
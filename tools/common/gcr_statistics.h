@@ -0,0 +1,60 @@
+/*
+
+    TRACIS: tools/common/gcr_statistics.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Hot pixel counting for galactic cosmic ray detection in raw TII images.
+// Shared by tiiGcrDetector and tracis --gcr-detection, so that offline and
+// inline counts use the same region of interest and thresholds.
+
+#ifndef _TRACIS_GCR_STATISTICS_H
+#define _TRACIS_GCR_STATISTICS_H
+
+#include <stdint.h>
+
+#define GCR_IMAGE_ROWS 66
+#define GCR_IMAGE_PIXELS 2640
+// Brighter pixels are counted as 0 in the statistics and are never hot
+#define GCR_MAX_PIXEL_VALUE 2000
+#define GCR_SIGMAS 5
+
+// Region of interest, by column and row of the raw image
+#define GCR_MIN_COL 19
+#define GCR_MIN_ROW 19
+#define GCR_MAX_ROW 46
+#define GCR_MIN_ROW2 4
+#define GCR_MAX_ROW2 61
+
+enum Statistic
+{
+    STATISTIC_MEAN = 0, // mean + GCR_SIGMAS standard deviations
+    STATISTIC_MAD // median + GCR_SIGMAS median absolute deviations
+};
+
+// Mean and sample standard deviation of the image
+void imageStatistics(const uint16_t *image, double *mean, double *stddev);
+
+// Median and median absolute deviation of the image
+void imageMedianStatistics(const uint16_t *image, double *median, double *mad);
+
+// Number of ROI pixels more than GCR_SIGMAS spreads above the image centre,
+// where centre and spread are mean and standard deviation or median and MAD.
+// Also gives the brightest of those pixels if maxIntensity is not NULL.
+long countImageGcrs(const uint16_t *image, int statistic, uint16_t *maxIntensity);
+
+#endif // _TRACIS_GCR_STATISTICS_H
@@ -0,0 +1,142 @@
+/*
+
+    TRACIS: tools/common/orbit.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "orbit.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+int initOrbit(OrbitModel *orbit, char satellite)
+{
+    double altitude = 0.0;
+    double inclination = 0.0;
+    double node = 0.0;
+    switch (satellite)
+    {
+        // A and C fly side by side, B higher in a drifting plane
+        case 'A':
+            altitude = 460.0;
+            inclination = 87.35;
+            node = 0.0;
+            break;
+        case 'C':
+            altitude = 460.0;
+            inclination = 87.35;
+            node = 1.4;
+            break;
+        case 'B':
+            altitude = 510.0;
+            inclination = 87.75;
+            node = 60.0;
+            break;
+        default:
+            return 1;
+    }
+    orbit->radiusKm = EARTH_RADIUS_KM + altitude;
+    orbit->inclination = inclination * M_PI / 180.0;
+    orbit->node = node * M_PI / 180.0;
+    orbit->phase = (satellite - 'A') * 0.1;
+    orbit->angularRate = sqrt(EARTH_MU / (orbit->radiusKm * orbit->radiusKm * orbit->radiusKm));
+
+    return 0;
+}
+
+void orbitState(const OrbitModel *orbit, double t, double *position, double *velocity, double *latitude, double *longitude)
+{
+    double u = orbit->phase + orbit->angularRate * t;
+    double node = orbit->node - EARTH_ROTATION_RATE * t;
+    double ci = cos(orbit->inclination);
+    double si = sin(orbit->inclination);
+    double cu = cos(u);
+    double su = sin(u);
+    double cn = cos(node);
+    double sn = sin(node);
+    double r = orbit->radiusKm;
+    double v = r * orbit->angularRate * 1000.0;
+
+    // Orbit plane rotated by inclination and node; Earth rotation is neglected in the velocity
+    position[0] = r * (cu * cn - su * ci * sn);
+    position[1] = r * (cu * sn + su * ci * cn);
+    position[2] = r * su * si;
+    velocity[0] = v * (-su * cn - cu * ci * sn);
+    velocity[1] = v * (-su * sn + cu * ci * cn);
+    velocity[2] = v * cu * si;
+
+    if (latitude != NULL)
+        *latitude = asin(position[2] / r) * 180.0 / M_PI;
+    if (longitude != NULL)
+        *longitude = atan2(position[1], position[0]) * 180.0 / M_PI;
+}
+
+int writeModFile(const OrbitModel *orbit, char satellite, double start, double stop, const char *dir, char *filename, size_t *records)
+{
+    time_t first = (time_t)ceil(start);
+    time_t last = (time_t)ceil(stop) - 1;
+    if (last < first)
+        return 1;
+    size_t nEpochs = (size_t)((last - first) / MOD_EPOCH_INTERVAL + 1);
+    last = first + (time_t)(nEpochs - 1) * MOD_EPOCH_INTERVAL;
+
+    struct tm firstTm;
+    struct tm lastTm;
+    gmtime_r(&first, &firstTm);
+    gmtime_r(&last, &lastTm);
+    snprintf(filename, FILENAME_MAX, "%s/SW_OPER_MOD%c_SC_1B_%04d%02d%02dT%02d%02d%02d_%04d%02d%02dT%02d%02d%02d_%s.sp3", dir, satellite, firstTm.tm_year + 1900, firstTm.tm_mon + 1, firstTm.tm_mday, firstTm.tm_hour, firstTm.tm_min, firstTm.tm_sec, lastTm.tm_year + 1900, lastTm.tm_mon + 1, lastTm.tm_mday, lastTm.tm_hour, lastTm.tm_min, lastTm.tm_sec, MOD_FILE_VERSION);
+
+    if (writeSp3File(orbit, satellite, first, nEpochs, filename))
+        return 1;
+    *records = nEpochs;
+
+    return 0;
+}
+
+int writeSp3File(const OrbitModel *orbit, char satellite, time_t first, size_t nEpochs, const char *filename)
+{
+    FILE *f = fopen(filename, "w");
+    if (f == NULL)
+        return 1;
+
+    struct tm firstTm;
+    gmtime_r(&first, &firstTm);
+    fprintf(f, "#cP%04d %2d %2d  0  0  0.00000000 %7zu ORBIT IGS14 HLM  SYN\n", firstTm.tm_year + 1900, firstTm.tm_mon + 1, firstTm.tm_mday, nEpochs);
+    fprintf(f, "## synthetic\n");
+    fprintf(f, "+    1   L%02d  0  0  0  0  0  0  0  0  0  0  0  0  0  0  0\n", 47 + satellite - 'A');
+    fprintf(f, "%%c L  cc UTC ccc cccc cccc cccc cccc ccccc ccccc ccccc ccccc\n");
+    fprintf(f, "/* synthetic circular orbit for Swarm %c\n", satellite);
+
+    double position[3];
+    double velocity[3];
+    struct tm tm;
+    time_t t = 0;
+    for (size_t i = 0; i < nEpochs; i++)
+    {
+        t = first + (time_t)i * MOD_EPOCH_INTERVAL;
+        gmtime_r(&t, &tm);
+        orbitState(orbit, (double)t, position, velocity, NULL, NULL);
+        fprintf(f, "*  %04d %2d %2d %2d %2d %11.8f\n", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, (double)tm.tm_sec);
+        fprintf(f, "PL%02d %14.6f %14.6f %14.6f 999999.999999\n", 47 + satellite - 'A', position[0], position[1], position[2]);
+        // dm/s
+        fprintf(f, "VL%02d %14.6f %14.6f %14.6f 999999.999999\n", 47 + satellite - 'A', velocity[0] * 10.0, velocity[1] * 10.0, velocity[2] * 10.0);
+    }
+    fprintf(f, "EOF\n");
+
+    return fclose(f) == 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+/*
+
+    TRACIS: tools/common/orbit.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Circular orbits like those of the Swarm satellites, written as one-day
+// MODx_SC_1B files in the SP3 layout read by loadEphemeres().
+// Also compiled into tracis_bench for its synthetic MOD file.
+
+#ifndef _ORBIT_H
+#define _ORBIT_H
+
+#include <stddef.h>
+#include <time.h>
+
+#define EARTH_RADIUS_KM 6371.2
+#define EARTH_MU 398600.4418 // km^3 / s^2
+#define EARTH_ROTATION_RATE 7.2921159e-5 // rad / s
+#define MOD_FILE_VERSION "0001"
+#define MOD_EPOCH_INTERVAL 1 // s
+
+typedef struct OrbitModel
+{
+    double radiusKm;
+    double inclination; // rad
+    double node; // longitude of the ascending node at time zero, rad
+    double phase; // argument of latitude at time zero, rad
+    double angularRate; // rad / s
+} OrbitModel;
+
+// Nominal orbit of Swarm A, B or C. Returns 1 for other satellites.
+int initOrbit(OrbitModel *orbit, char satellite);
+
+// Earth-fixed position (km) and velocity (m/s) at t seconds since 1970, with geocentric latitude and longitude in degrees
+void orbitState(const OrbitModel *orbit, double t, double *position, double *velocity, double *latitude, double *longitude);
+
+// Writes nEpochs records from first (seconds since 1970) to filename. Epochs are UTC and the
+// header start time is midnight of the first day, so loadEphemeres() applies no GPS offset.
+// Returns 0 on success.
+int writeSp3File(const OrbitModel *orbit, char satellite, time_t first, size_t nEpochs, const char *filename);
+
+// Writes records from start to stop (seconds since 1970, within one UTC day) to dir.
+// filename receives the path. Returns 0 on success.
+int writeModFile(const OrbitModel *orbit, char satellite, double start, double stop, const char *dir, char *filename, size_t *records);
+
+#endif // _ORBIT_H
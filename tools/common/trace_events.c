@@ -0,0 +1,95 @@
+/*
+
+    TRACIS: tools/common/trace_events.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "trace_events.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+int openTraceLog(TraceLog *trace, const char *filename)
+{
+    trace->pid = (int)getpid();
+    trace->fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (trace->fd < 0)
+        return TRACE_OPEN;
+
+    struct stat s;
+    if (fstat(trace->fd, &s) == 0 && s.st_size == 0 && write(trace->fd, "[\n", 2) != 2)
+    {
+        closeTraceLog(trace);
+        return TRACE_OPEN;
+    }
+
+    return TRACE_OK;
+}
+
+void closeTraceLog(TraceLog *trace)
+{
+    if (trace->fd >= 0)
+        close(trace->fd);
+    trace->fd = -1;
+}
+
+double traceMicroseconds(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static void writeEvent(TraceLog *trace, const char *event, int length)
+{
+    // Longer events were truncated and are not valid JSON
+    if (length > 0 && length < TRACE_EVENT_LENGTH)
+        (void)!write(trace->fd, event, length);
+}
+
+void traceSpan(TraceLog *trace, const char *name, const char *category, int tid, double startUs, double endUs, const char *args)
+{
+    if (trace == NULL || trace->fd < 0)
+        return;
+
+    char event[TRACE_EVENT_LENGTH];
+    int length = snprintf(event, TRACE_EVENT_LENGTH, "{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d, \"args\": {%s}},\n", name, category, startUs, endUs - startUs, trace->pid, tid, args != NULL ? args : "");
+    writeEvent(trace, event, length);
+}
+
+void traceProcessName(TraceLog *trace, const char *name)
+{
+    if (trace == NULL || trace->fd < 0)
+        return;
+
+    char event[TRACE_EVENT_LENGTH];
+    int length = snprintf(event, TRACE_EVENT_LENGTH, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 0, \"args\": {\"name\": \"%s\"}},\n", trace->pid, name);
+    writeEvent(trace, event, length);
+}
+
+void traceThreadName(TraceLog *trace, int tid, const char *name)
+{
+    if (trace == NULL || trace->fd < 0)
+        return;
+
+    char event[TRACE_EVENT_LENGTH];
+    int length = snprintf(event, TRACE_EVENT_LENGTH, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}},\n", trace->pid, tid, name);
+    writeEvent(trace, event, length);
+}
@@ -0,0 +1,62 @@
+/*
+
+    TRACIS: tools/common/trace_events.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Timeline output in the Chrome trace-event JSON array format, for loading
+// into chrome://tracing or Perfetto. Each event is appended with a single
+// write() so that tracisParallel and the tracis processes it starts can
+// share one file. Timestamps are CLOCK_MONOTONIC microseconds, which all
+// processes on a node share. The closing ] is optional in this format
+// and is not written.
+
+#ifndef _TRACE_EVENTS_H
+#define _TRACE_EVENTS_H
+
+#define TRACE_EVENT_LENGTH 1024
+// One image pair in this many gets its own span
+#define TRACE_IMAGE_PAIR_INTERVAL 500
+
+enum TRACE_STATUS
+{
+    TRACE_OK = 0,
+    TRACE_OPEN
+};
+
+typedef struct TraceLog
+{
+    int fd;
+    int pid;
+} TraceLog;
+
+// Opens filename for appending, starting the array if the file is new
+int openTraceLog(TraceLog *trace, const char *filename);
+
+void closeTraceLog(TraceLog *trace);
+
+double traceMicroseconds(void);
+
+// Complete ("X") event from startUs to endUs on thread tid. args is the
+// body of a JSON object, or NULL. These do nothing if trace is NULL.
+void traceSpan(TraceLog *trace, const char *name, const char *category, int tid, double startUs, double endUs, const char *args);
+
+// Metadata events that label this process and one of its threads in the viewer
+void traceProcessName(TraceLog *trace, const char *name);
+void traceThreadName(TraceLog *trace, int tid, const char *name);
+
+#endif // _TRACE_EVENTS_H
@@ -0,0 +1,325 @@
+/*
+
+    TRACIS: tools/common/zip_member.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "zip_member.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+
+#include <zlib.h>
+
+#define ZIP_END_SIGNATURE 0x06054b50
+#define ZIP_CENTRAL_SIGNATURE 0x02014b50
+#define ZIP_LOCAL_SIGNATURE 0x04034b50
+#define ZIP_END_LENGTH 22
+#define ZIP_CENTRAL_LENGTH 46
+#define ZIP_LOCAL_LENGTH 30
+#define ZIP_MAX_COMMENT 65535
+#define ZIP_COPY_BUFFER (1 << 18)
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | (uint16_t)p[1] << 8;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int readAt(int fd, void *buffer, size_t length, off_t offset)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = pread(fd, (uint8_t *)buffer + done, length - done, offset + done);
+        if (n <= 0)
+            return -1;
+        done += n;
+    }
+
+    return 0;
+}
+
+static int writeAll(int fd, const void *buffer, size_t length)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = write(fd, (const uint8_t *)buffer + done, length - done);
+        if (n <= 0)
+            return -1;
+        done += n;
+    }
+
+    return 0;
+}
+
+static int findMember(int fd, const char *suffix, ZipMember *member)
+{
+    struct stat s;
+    if (fstat(fd, &s) != 0)
+        return ZIP_FILE;
+    if (s.st_size < ZIP_END_LENGTH)
+        return ZIP_FORMAT;
+
+    // The end of central directory record is followed only by the archive comment
+    size_t tailLength = s.st_size < ZIP_END_LENGTH + ZIP_MAX_COMMENT ? (size_t)s.st_size : ZIP_END_LENGTH + ZIP_MAX_COMMENT;
+    uint8_t *tail = malloc(tailLength);
+    if (tail == NULL)
+        return ZIP_MEM;
+    if (readAt(fd, tail, tailLength, s.st_size - tailLength) != 0)
+    {
+        free(tail);
+        return ZIP_FILE;
+    }
+    const uint8_t *end = NULL;
+    for (long i = (long)tailLength - ZIP_END_LENGTH; i >= 0 && end == NULL; i--)
+    {
+        if (get32(tail + i) == ZIP_END_SIGNATURE)
+            end = tail + i;
+    }
+    if (end == NULL)
+    {
+        free(tail);
+        return ZIP_FORMAT;
+    }
+    uint16_t nEntries = get16(end + 10);
+    uint32_t directorySize = get32(end + 12);
+    uint32_t directoryOffset = get32(end + 16);
+    free(tail);
+    if (nEntries == 0xffff || directorySize == 0xffffffff || directoryOffset == 0xffffffff || (off_t)directoryOffset + directorySize > s.st_size)
+        return ZIP_FORMAT;
+
+    uint8_t *directory = malloc(directorySize);
+    if (directory == NULL)
+        return ZIP_MEM;
+    if (readAt(fd, directory, directorySize, directoryOffset) != 0)
+    {
+        free(directory);
+        return ZIP_FILE;
+    }
+
+    int status = ZIP_NO_MEMBER;
+    size_t suffixLength = strlen(suffix);
+    uint32_t localOffset = 0;
+    const uint8_t *entry = directory;
+    for (uint16_t i = 0; i < nEntries && status == ZIP_NO_MEMBER; i++)
+    {
+        if (entry + ZIP_CENTRAL_LENGTH > directory + directorySize || get32(entry) != ZIP_CENTRAL_SIGNATURE)
+        {
+            status = ZIP_FORMAT;
+            break;
+        }
+        uint16_t nameLength = get16(entry + 28);
+        uint16_t extraLength = get16(entry + 30);
+        uint16_t commentLength = get16(entry + 32);
+        if (entry + ZIP_CENTRAL_LENGTH + nameLength > directory + directorySize)
+        {
+            status = ZIP_FORMAT;
+            break;
+        }
+        const char *name = (const char *)entry + ZIP_CENTRAL_LENGTH;
+        if (nameLength >= suffixLength && nameLength < FILENAME_MAX && strncmp(name + nameLength - suffixLength, suffix, suffixLength) == 0)
+        {
+            memcpy(member->name, name, nameLength);
+            member->name[nameLength] = '\0';
+            member->method = get16(entry + 10);
+            member->crc = get32(entry + 16);
+            member->compressedSize = get32(entry + 20);
+            member->uncompressedSize = get32(entry + 24);
+            localOffset = get32(entry + 42);
+            status = ZIP_OK;
+        }
+        entry += ZIP_CENTRAL_LENGTH + nameLength + extraLength + commentLength;
+    }
+    free(directory);
+    if (status != ZIP_OK)
+        return status;
+    if (member->compressedSize == 0xffffffff || member->uncompressedSize == 0xffffffff || localOffset == 0xffffffff)
+        return ZIP_FORMAT;
+
+    // The local header's name and extra field lengths can differ from the central directory's
+    uint8_t local[ZIP_LOCAL_LENGTH];
+    if (readAt(fd, local, ZIP_LOCAL_LENGTH, localOffset) != 0 || get32(local) != ZIP_LOCAL_SIGNATURE)
+        return ZIP_FORMAT;
+    member->dataOffset = (off_t)localOffset + ZIP_LOCAL_LENGTH + get16(local + 26) + get16(local + 28);
+    if (member->dataOffset + (off_t)member->compressedSize > s.st_size)
+        return ZIP_FORMAT;
+
+    return ZIP_OK;
+}
+
+int findZipMember(const char *zipFilename, const char *suffix, ZipMember *member)
+{
+    int fd = open(zipFilename, O_RDONLY);
+    if (fd < 0)
+        return ZIP_FILE;
+    int status = findMember(fd, suffix, member);
+    close(fd);
+
+    return status;
+}
+
+static int copyStored(int in, int out, const ZipMember *member)
+{
+    off_t offset = member->dataOffset;
+    size_t remaining = member->compressedSize;
+    while (remaining > 0)
+    {
+        ssize_t n = sendfile(out, in, &offset, remaining);
+        if (n <= 0)
+            return ZIP_STAGE;
+        remaining -= n;
+    }
+
+    return ZIP_OK;
+}
+
+static int inflateMember(int in, int out, const ZipMember *member)
+{
+    uint8_t *input = malloc(ZIP_COPY_BUFFER);
+    uint8_t *output = malloc(ZIP_COPY_BUFFER);
+    if (input == NULL || output == NULL)
+    {
+        free(input);
+        free(output);
+        return ZIP_MEM;
+    }
+
+    z_stream stream = {0};
+    // Raw deflate data: ZIP keeps the header and checksum outside the stream
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    {
+        free(input);
+        free(output);
+        return ZIP_MEM;
+    }
+
+    int status = ZIP_OK;
+    int z = Z_OK;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    off_t offset = member->dataOffset;
+    size_t remaining = member->compressedSize;
+    size_t written = 0;
+    // inflate() can use up its input and still hold output when the output buffer fills
+    bool outputFull = false;
+    while (z != Z_STREAM_END && status == ZIP_OK)
+    {
+        if (stream.avail_in == 0 && !outputFull)
+        {
+            size_t n = remaining < ZIP_COPY_BUFFER ? remaining : ZIP_COPY_BUFFER;
+            if (n == 0 || readAt(in, input, n, offset) != 0)
+            {
+                status = ZIP_FORMAT;
+                break;
+            }
+            offset += n;
+            remaining -= n;
+            stream.next_in = input;
+            stream.avail_in = n;
+        }
+        stream.next_out = output;
+        stream.avail_out = ZIP_COPY_BUFFER;
+        z = inflate(&stream, Z_NO_FLUSH);
+        size_t n = ZIP_COPY_BUFFER - stream.avail_out;
+        // Nothing was held back after all: more input is needed
+        if (z == Z_BUF_ERROR && n == 0 && outputFull)
+        {
+            outputFull = false;
+            z = Z_OK;
+            continue;
+        }
+        if (z != Z_OK && z != Z_STREAM_END)
+        {
+            status = ZIP_FORMAT;
+            break;
+        }
+        outputFull = stream.avail_out == 0;
+        crc = crc32(crc, output, n);
+        written += n;
+        if (writeAll(out, output, n) != 0)
+            status = ZIP_STAGE;
+    }
+    inflateEnd(&stream);
+    free(input);
+    free(output);
+
+    if (status == ZIP_OK && (written != member->uncompressedSize || crc != member->crc))
+        status = ZIP_CRC;
+
+    return status;
+}
+
+int stageZipMember(const char *zipFilename, const ZipMember *member, const char *stagedFilename)
+{
+    if (member->method != ZIP_METHOD_STORED && member->method != ZIP_METHOD_DEFLATED)
+        return ZIP_METHOD;
+
+    int in = open(zipFilename, O_RDONLY);
+    if (in < 0)
+        return ZIP_FILE;
+    int out = open(stagedFilename, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (out < 0)
+    {
+        close(in);
+        return ZIP_STAGE;
+    }
+
+    int status = member->method == ZIP_METHOD_STORED ? copyStored(in, out, member) : inflateMember(in, out, member);
+
+    close(in);
+    if (close(out) != 0 && status == ZIP_OK)
+        status = ZIP_STAGE;
+    if (status != ZIP_OK)
+        unlink(stagedFilename);
+
+    return status;
+}
+
+const char *zipStatusMessage(int status)
+{
+    switch (status)
+    {
+        case ZIP_OK:
+            return "no error";
+        case ZIP_FILE:
+            return "could not read archive";
+        case ZIP_FORMAT:
+            return "not a supported ZIP archive";
+        case ZIP_NO_MEMBER:
+            return "no CDF file in archive";
+        case ZIP_METHOD:
+            return "unsupported compression method";
+        case ZIP_STAGE:
+            return "could not write staging file";
+        case ZIP_CRC:
+            return "member is corrupt";
+        case ZIP_MEM:
+            return "out of memory";
+        default:
+            return "unknown error";
+    }
+}
@@ -0,0 +1,70 @@
+/*
+
+    TRACIS: tools/common/zip_member.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Locates a member of a ZIP archive through its central directory and copies
+// only that member to a staging file, so that the CDF library can open a
+// product without extracting the whole archive. Stored members are copied
+// in the kernel; deflated members are inflated with zlib. ZIP64 archives
+// are not supported.
+
+#ifndef _TRACIS_GCR_ZIP_MEMBER_H
+#define _TRACIS_GCR_ZIP_MEMBER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// tmpfs on most Linux systems
+#define DEFAULT_STAGING_DIR "/dev/shm"
+
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+enum ZipStatus
+{
+    ZIP_OK = 0,
+    ZIP_FILE,
+    ZIP_FORMAT,
+    ZIP_NO_MEMBER,
+    ZIP_METHOD,
+    ZIP_STAGE,
+    ZIP_CRC,
+    ZIP_MEM
+};
+
+typedef struct ZipMember
+{
+    char name[FILENAME_MAX];
+    uint16_t method;
+    uint32_t crc;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+    off_t dataOffset;
+} ZipMember;
+
+// The first member whose name ends with suffix
+int findZipMember(const char *zipFilename, const char *suffix, ZipMember *member);
+
+// Writes the member's uncompressed contents to stagedFilename
+int stageZipMember(const char *zipFilename, const ZipMember *member, const char *stagedFilename);
+
+const char *zipStatusMessage(int status);
+
+#endif // _TRACIS_GCR_ZIP_MEMBER_H
@@ -0,0 +1,180 @@
+/*
+
+    TRACIS: tools/tiiGcrDetector/events.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "events.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void initImageRecords(ImageRecords *records)
+{
+    records->records = NULL;
+    records->nRecords = 0;
+    records->size = 0;
+}
+
+int appendImageRecord(ImageRecords *records, const GcrImageRecord *record)
+{
+    if (records->nRecords == records->size)
+    {
+        size_t newSize = records->size == 0 ? 1024 : 2 * records->size;
+        GcrImageRecord *mem = realloc(records->records, newSize * sizeof(GcrImageRecord));
+        if (mem == NULL)
+            return 1;
+        records->records = mem;
+        records->size = newSize;
+    }
+    records->records[records->nRecords++] = *record;
+
+    return 0;
+}
+
+void freeImageRecords(ImageRecords *records)
+{
+    free(records->records);
+    initImageRecords(records);
+}
+
+void writeEventHeader(FILE *f, int format)
+{
+    if (format == EVENT_FORMAT_BINARY)
+    {
+        uint32_t version = EVENTS_VERSION;
+        uint32_t recordSize = sizeof(GcrImageRecord);
+        fwrite(EVENTS_MAGIC, 1, strlen(EVENTS_MAGIC), f);
+        fwrite(&version, sizeof version, 1, f);
+        fwrite(&recordSize, sizeof recordSize, 1, f);
+    }
+    else
+        fprintf(f, "time,sensor,detector,latitude,longitude,radius_km,count,max_intensity\n");
+
+    return;
+}
+
+void writeEvents(FILE *f, int format, const ImageRecords *records)
+{
+    const GcrImageRecord *r = NULL;
+    for (size_t i = 0; i < records->nRecords; i++)
+    {
+        r = &records->records[i];
+        if (r->count == 0)
+            continue;
+        if (format == EVENT_FORMAT_BINARY)
+            fwrite(r, sizeof(GcrImageRecord), 1, f);
+        else
+            fprintf(f, "%.1lf,%c,%s,%.3lf,%.3lf,%.3lf,%d,%u\n", r->time, r->sensor, r->detector == DETECTOR_BINNED ? "binned" : "stat", r->latitude, r->longitude, r->radius, r->count, r->maxIntensity);
+    }
+
+    return;
+}
+
+int initGcrGrid(GcrGrid *grid, double resolution)
+{
+    grid->resolution = resolution;
+    grid->nLatitudes = (int)ceil(180.0 / resolution);
+    grid->nLongitudes = (int)ceil(360.0 / resolution);
+    size_t nCells = (size_t)grid->nLatitudes * (size_t)grid->nLongitudes;
+    grid->images = calloc(nCells, sizeof(long));
+    grid->eventImages = calloc(nCells, sizeof(long));
+    grid->hotPixels = calloc(nCells, sizeof(long));
+    if (grid->images == NULL || grid->eventImages == NULL || grid->hotPixels == NULL)
+    {
+        freeGcrGrid(grid);
+        return 1;
+    }
+
+    return 0;
+}
+
+void accumulateGcrGrid(GcrGrid *grid, const ImageRecords *records, int detector)
+{
+    const GcrImageRecord *r = NULL;
+    int latIndex = 0;
+    int lonIndex = 0;
+    double longitude = 0.0;
+    size_t cell = 0;
+
+    for (size_t i = 0; i < records->nRecords; i++)
+    {
+        r = &records->records[i];
+        if (r->detector != detector || !isfinite(r->latitude) || !isfinite(r->longitude))
+            continue;
+        // Longitudes from -180 to 180
+        longitude = fmod(r->longitude + 180.0, 360.0);
+        if (longitude < 0.0)
+            longitude += 360.0;
+        latIndex = (int)floor((r->latitude + 90.0) / grid->resolution);
+        lonIndex = (int)floor(longitude / grid->resolution);
+        if (latIndex < 0)
+            latIndex = 0;
+        if (latIndex >= grid->nLatitudes)
+            latIndex = grid->nLatitudes - 1;
+        if (lonIndex >= grid->nLongitudes)
+            lonIndex = grid->nLongitudes - 1;
+        cell = (size_t)latIndex * grid->nLongitudes + lonIndex;
+        grid->images[cell]++;
+        if (r->count > 0)
+        {
+            grid->eventImages[cell]++;
+            grid->hotPixels[cell] += r->count;
+        }
+    }
+
+    return;
+}
+
+// Counts are given with the rates so that grids from separate runs can be added
+int writeGcrGrid(const GcrGrid *grid, const char *filename)
+{
+    FILE *f = fopen(filename, "w");
+    if (f == NULL)
+        return 1;
+
+    fprintf(f, "latitude,longitude,images,gcr_images,hot_pixels,gcr_image_fraction,hot_pixels_per_image\n");
+    size_t cell = 0;
+    for (int i = 0; i < grid->nLatitudes; i++)
+    {
+        for (int j = 0; j < grid->nLongitudes; j++)
+        {
+            cell = (size_t)i * grid->nLongitudes + j;
+            if (grid->images[cell] == 0)
+                continue;
+            // Cell centres
+            fprintf(f, "%.3lf,%.3lf,%ld,%ld,%ld,%.6lf,%.6lf\n", -90.0 + (i + 0.5) * grid->resolution, -180.0 + (j + 0.5) * grid->resolution, grid->images[cell], grid->eventImages[cell], grid->hotPixels[cell], (double)grid->eventImages[cell] / (double)grid->images[cell], (double)grid->hotPixels[cell] / (double)grid->images[cell]);
+        }
+    }
+
+    int status = ferror(f) ? 1 : 0;
+    if (fclose(f) != 0)
+        status = 1;
+
+    return status;
+}
+
+void freeGcrGrid(GcrGrid *grid)
+{
+    free(grid->images);
+    free(grid->eventImages);
+    free(grid->hotPixels);
+    grid->images = NULL;
+    grid->eventImages = NULL;
+    grid->hotPixels = NULL;
+}
@@ -0,0 +1,94 @@
+/*
+
+    TRACIS: tools/tiiGcrDetector/events.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Structured detector output: a table of GCR events and a latitude-longitude
+// grid of how often candidate images have GCRs.
+
+#ifndef _TRACIS_GCR_EVENTS_H
+#define _TRACIS_GCR_EVENTS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Binary event files: EVENTS_MAGIC, uint32 EVENTS_VERSION, uint32 record size,
+// then little-endian GcrImageRecords
+#define EVENTS_MAGIC "TIIGCREV"
+#define EVENTS_VERSION 1
+
+#define DEFAULT_GRID_RESOLUTION 2.0 // degrees
+
+enum EventFormat
+{
+    EVENT_FORMAT_CSV = 0,
+    EVENT_FORMAT_BINARY
+};
+
+enum Detector
+{
+    DETECTOR_STATISTIC = 0,
+    DETECTOR_BINNED
+};
+
+// One candidate image. count is 0 for images without GCRs, which only add to the grid exposure.
+typedef struct GcrImageRecord
+{
+    double time; // Unix time, s
+    double latitude; // degrees
+    double longitude; // degrees
+    double radius; // km
+    int32_t count; // hot pixels, or binned detections
+    uint16_t maxIntensity; // brightest hot pixel, or largest binned increase
+    char sensor; // 'H' or 'V'
+    uint8_t detector;
+} GcrImageRecord;
+
+typedef struct ImageRecords
+{
+    GcrImageRecord *records;
+    size_t nRecords;
+    size_t size;
+} ImageRecords;
+
+typedef struct GcrGrid
+{
+    double resolution;
+    int nLatitudes;
+    int nLongitudes;
+    long *images;
+    long *eventImages;
+    long *hotPixels;
+} GcrGrid;
+
+void initImageRecords(ImageRecords *records);
+int appendImageRecord(ImageRecords *records, const GcrImageRecord *record);
+void freeImageRecords(ImageRecords *records);
+
+void writeEventHeader(FILE *f, int format);
+// Writes the records that have GCRs
+void writeEvents(FILE *f, int format, const ImageRecords *records);
+
+int initGcrGrid(GcrGrid *grid, double resolution);
+// Adds the records of the given detector to the grid
+void accumulateGcrGrid(GcrGrid *grid, const ImageRecords *records, int detector);
+int writeGcrGrid(const GcrGrid *grid, const char *filename);
+void freeGcrGrid(GcrGrid *grid);
+
+#endif // _TRACIS_GCR_EVENTS_H
@@ -36,7 +36,13 @@
 #define VPHOSV() (MEAS(9, 0, 1))
 #define VBIASH() (MEAS(10, 0, 1))
 #define VBIASV() (MEAS(11, 0, 1))
-#define RAW_IMAGE_H() (((uint16_t*)dataBuffers[12] + 2640 * (timeIndex)))
-#define RAW_IMAGE_V() (((uint16_t*)dataBuffers[13] + 2640 * (timeIndex)))
+#define RAW_IMAGE_H_VAR 12
+#define RAW_IMAGE_V_VAR 13
+#define RAW_IMAGE_H() (((uint16_t*)dataBuffers[RAW_IMAGE_H_VAR] + 2640 * (timeIndex)))
+#define RAW_IMAGE_V() (((uint16_t*)dataBuffers[RAW_IMAGE_V_VAR] + 2640 * (timeIndex)))
+
+// Images taken with HV off, the only ones searched for GCRs
+#define CANDIDATE_IMAGE_H() (VALID_IMAGERY_H() && VBIASH() > -1.0 && VMCPH() > -20.0 && VPHOSH() < 50.0)
+#define CANDIDATE_IMAGE_V() (VALID_IMAGERY_V() && VBIASV() > -1.0 && VMCPV() > -20.0 && VPHOSV() < 50.0)
 
 #endif // _TRACIS_INDEXING_H
@@ -19,11 +19,16 @@
 */
 
 #include "indexing.h"
+#include "state.h"
+#include "events.h"
+#include "zip_member.h"
+#include "gcr_statistics.h"
 
 #include <stdio.h>
 #include <stdint.h>
 
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <signal.h>
 #include <stdbool.h>
@@ -31,25 +36,33 @@
 #include <time.h>
 #include <ctype.h>
 #include <fts.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
 
 #include <cdf.h>
 
-#include <gsl/gsl_statistics_short.h>
-
 
 #define SOFTWARE_VERSION "1.0.0"
 #define STATUS_INTERVAL_FRACTION 0.1
 #define NUM_CDF_VARS 14
 
-#define IMAGE_PIXELS 2640
 #define GCR_BINNED_THRESHOLD 5000
-#define MAX_PIXEL_VALUE 2000
-#define GCR_SIGMAS 5
-#define MINCOL 19
-#define MINROW 19
-#define MAXROW 46
-#define MINROW2 4
-#define MAXROW2 61
+
+#define MAX_WORKERS 256
+#define BENCHMARK_REPEATS 10
+
+// Binned detector: blocks of 6 rows by 4 columns over rows 6-60 and columns 4-35
+#define BINNED_FIRST_ROW 6
+#define BINNED_LAST_ROW 60
+#define BINNED_FIRST_COL 4
+#define BINNED_ROW_PIXELS 6
+#define BINNED_COL_PIXELS 4
+#define BINNED_ROWS 10
+#define BINNED_COLS 8
+#define BINNED_HISTORY 2
 
 
 enum ProcessData
@@ -58,11 +71,75 @@ enum ProcessData
     PROCESS_DATA_MEM
 };
 
+enum Mode
+{
+    MODE_STATISTIC = 0, // hot pixels relative to the image statistic
+    MODE_BINNED, // frame-to-frame increase in binned intensity
+    MODE_BOTH
+};
+
+typedef struct DetectorOptions
+{
+    int mode;
+    int statistic;
+    bool benchmark;
+    bool records; // collect per-image records for the event table and grid
+    const char *stagingDir; // where CDF files are copied out of ZIP archives
+} DetectorOptions;
+
+enum ListFiles
+{
+    LIST_FILES_OK = 0,
+    LIST_FILES_OPEN,
+    LIST_FILES_MEM
+};
+
+// Detector output of one file; status is that of loadData(), or -1 if the worker failed
+typedef struct FileResult
+{
+    int status;
+    char *output;
+    size_t length;
+    ImageRecords records; // collected if options->records
+} FileResult;
+
+// Event table and rate grid, written in file order as files finish
+typedef struct StructuredOutput
+{
+    FILE *events;
+    int eventFormat;
+    bool grid;
+    GcrGrid gcrGrid;
+    int gridDetector;
+} StructuredOutput;
+
+typedef struct FileWorker
+{
+    pid_t pid;
+    int jobs;
+    int results;
+    long index; // file being processed, or -1 when idle
+} FileWorker;
+
+int listFiles(const char *directory, char satelliteLetter, const char *version, char ***files, long *nFiles);
+int processFile(const char *filename, FILE *output, const DetectorOptions *options, ImageRecords *records);
+int stageProduct(const char *filename, const char *stagingDir, char *cdfFilename, bool *staged);
+void processFiles(char **files, long nFiles, int nWorkers, const DetectorOptions *options, FileResult *results, StructuredOutput *structured);
+void processFilesInParallel(char **files, long nFiles, int nWorkers, const DetectorOptions *options, FileResult *results, StructuredOutput *structured);
+int processFilesIncrementally(char **files, long nFiles, int nWorkers, const DetectorOptions *options, const char *stateDir, char satelliteLetter, const char *version, StructuredOutput *structured);
+void writeStructuredOutput(StructuredOutput *structured, const ImageRecords *records);
+void reportProgress(long processedFiles, long nFiles);
+static int readFully(int fd, void *buffer, size_t length);
+static int writeFully(int fd, const void *buffer, size_t length);
+
 int loadData(const char * filename, uint8_t **dataBuffers, long *numberOfRecords);
+CDFstatus loadCandidateImages(CDFid cdfId, long varNum, uint8_t **dataBuffers, char sensor, long nRecs, long recordBytes);
 void printErrorMessage(CDFstatus status);
 
-int processData(uint8_t **dataBuffers, long nRecs);
-void processDataBinned(uint8_t **dataBuffers, long nRecs);
+int processData(uint8_t **dataBuffers, long nRecs, FILE *output, const DetectorOptions *options, ImageRecords *records);
+void benchmarkStatistics(uint8_t **dataBuffers, long nRecs);
+void processSensor(uint8_t **dataBuffers, long nRecs, char sensor, FILE *output, const DetectorOptions *options, ImageRecords *records, long *dayGcrCount, long *dayBinnedCount);
+void binImage(const uint16_t *image, int32_t *binned);
 
 int alphabeticalFts(const FTSENT **a, const FTSENT **b)
 {
@@ -81,6 +158,17 @@ int main(int argc, char* argv[])
     char date[255];
     snprintf(date, strlen(dateString), "%s", dateString);
 
+    int nWorkers = 1;
+    DetectorOptions options = {0};
+    options.stagingDir = DEFAULT_STAGING_DIR;
+    char *stateDir = NULL;
+    char *eventsFilename = NULL;
+    int eventFormat = EVENT_FORMAT_CSV;
+    char *gridFilename = NULL;
+    double gridResolution = DEFAULT_GRID_RESOLUTION;
+    char *positionalArgs[3] = {NULL};
+    int nPositionalArgs = 0;
+
     for (int i = 1; i < argc; i++)
     {
         if (strcmp(argv[i], "--about") == 0)
@@ -93,38 +181,91 @@ int main(int argc, char* argv[])
 
             exit(0);
         }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            nWorkers = atoi(argv[++i]);
+        else if (strncmp(argv[i], "-j", 2) == 0 && strlen(argv[i]) > 2)
+            nWorkers = atoi(argv[i] + 2);
+        else if (strcmp(argv[i], "--statistic") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "mean") == 0)
+                options.statistic = STATISTIC_MEAN;
+            else if (strcmp(argv[i], "mad") == 0)
+                options.statistic = STATISTIC_MAD;
+            else
+            {
+                fprintf(stderr, "Unrecognized statistic %s: expected mean or mad.\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "stat") == 0)
+                options.mode = MODE_STATISTIC;
+            else if (strcmp(argv[i], "binned") == 0)
+                options.mode = MODE_BINNED;
+            else if (strcmp(argv[i], "both") == 0)
+                options.mode = MODE_BOTH;
+            else
+            {
+                fprintf(stderr, "Unrecognized mode %s: expected stat, binned or both.\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--benchmark") == 0)
+            options.benchmark = true;
+        else if (strcmp(argv[i], "--state-dir") == 0 && i + 1 < argc)
+            stateDir = argv[++i];
+        else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc)
+            eventsFilename = argv[++i];
+        else if (strcmp(argv[i], "--event-format") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "csv") == 0)
+                eventFormat = EVENT_FORMAT_CSV;
+            else if (strcmp(argv[i], "binary") == 0)
+                eventFormat = EVENT_FORMAT_BINARY;
+            else
+            {
+                fprintf(stderr, "Unrecognized event format %s: expected csv or binary.\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc)
+            gridFilename = argv[++i];
+        else if (strcmp(argv[i], "--grid-resolution") == 0 && i + 1 < argc)
+            gridResolution = atof(argv[++i]);
+        else if (strcmp(argv[i], "--staging-dir") == 0 && i + 1 < argc)
+            options.stagingDir = argv[++i];
+        else
+        {
+            if (nPositionalArgs < 3)
+                positionalArgs[nPositionalArgs] = argv[i];
+            nPositionalArgs++;
+        }
     }
 
 
-    if (argc != 4)
+    if (nPositionalArgs != 3 || nWorkers < 1 || !(gridResolution > 0.0))
     {
-        fprintf(stderr, "usage: %s directory satelliteLetter datasetVersion\n", argv[0]);
+        fprintf(stderr, "usage: %s [-j nProcesses] [--mode stat|binned|both] [--statistic mean|mad] [--benchmark] [--state-dir dir] [--events file] [--event-format csv|binary] [--grid file] [--grid-resolution degrees] [--staging-dir dir] directory satelliteLetter datasetVersion\n", argv[0]);
         exit(1);
     }
-    const char *directory = argv[1];
-    const char *satelliteLetter = argv[2];
-    const char *version = argv[3];
+    if (nWorkers > MAX_WORKERS)
+        nWorkers = MAX_WORKERS;
+    const char *directory = positionalArgs[0];
+    const char *satelliteLetter = positionalArgs[1];
+    const char *version = positionalArgs[2];
 
-    // Count number of files in directory:
+    // Alphabetical order is chronological order for TISL1B files
+    char **files = NULL;
     long nFiles = 0;
-
-    char *searchPath[2] = {NULL, NULL};
-    searchPath[0] = (char *)directory;
-    FTS * fts = fts_open(searchPath, FTS_LOGICAL | FTS_NOCHDIR | FTS_NOSTAT, &alphabeticalFts);     
-    if (fts == NULL)
+    if (listFiles(directory, satelliteLetter[0], version, &files, &nFiles) != LIST_FILES_OK)
     {
         fprintf(stderr, "Could not open directory %s for reading.", directory);
             exit(EXIT_FAILURE);
     }
-    FTSENT * f = fts_read(fts);
-    while(f != NULL)
-    {
-        if ((strlen(f->fts_name) == 59 && *(f->fts_name+11) == satelliteLetter[0] && strncmp(f->fts_name+12, "TISL1B", 6) == 0 && strncmp(f->fts_name + 51, version, 4) == 0))
-        {
-            nFiles++;
-        }
-        f = fts_read(fts);
-    }
     if (nFiles == 0)
     {
         fprintf(stderr, "Swarm %s: no TRACIS TISL1B files found.\n", satelliteLetter);
@@ -132,62 +273,584 @@ int main(int argc, char* argv[])
     }
 
     fprintf(stderr, "found %ld files\n", nFiles);
-    // Reopen file listing for processing
-    fts_close(fts);
-    fts = fts_open(searchPath, FTS_LOGICAL | FTS_NOCHDIR | FTS_NOSTAT, &alphabeticalFts);     
-    if (fts == NULL)
+
+    StructuredOutput structured = {0};
+    if (eventsFilename != NULL)
     {
-        fprintf(stderr, "Could not open directory %s for reading.", directory);
+        structured.events = fopen(eventsFilename, "w");
+        if (structured.events == NULL)
+        {
+            fprintf(stderr, "Could not open %s for writing.\n", eventsFilename);
             exit(EXIT_FAILURE);
+        }
+        structured.eventFormat = eventFormat;
+        writeEventHeader(structured.events, eventFormat);
     }
-    f = fts_read(fts);
-    long processedFiles = 0;
-    long statusInterval = (long) (STATUS_INTERVAL_FRACTION * (double) nFiles);
+    if (gridFilename != NULL)
+    {
+        if (initGcrGrid(&structured.gcrGrid, gridResolution) != 0)
+        {
+            fprintf(stderr, "Out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        structured.grid = true;
+        structured.gridDetector = options.mode == MODE_BINNED ? DETECTOR_BINNED : DETECTOR_STATISTIC;
+    }
+    options.records = eventsFilename != NULL || gridFilename != NULL;
+    StructuredOutput *structuredOutput = options.records ? &structured : NULL;
 
-    CDFstatus status;
-    long nRecs = 0;
-    char fullPath[CDF_PATHNAME_LEN] = {0};
+    if (stateDir != NULL)
+    {
+        if (processFilesIncrementally(files, nFiles, nWorkers, &options, stateDir, satelliteLetter[0], version, structuredOutput) != STATE_OK)
+            exit(EXIT_FAILURE);
+    }
+    else
+        processFiles(files, nFiles, nWorkers, &options, NULL, structuredOutput);
 
-    uint8_t * dataBuffers[NUM_CDF_VARS];
+    if (structured.events != NULL && fclose(structured.events) != 0)
+        fprintf(stderr, "Could not write events to %s.\n", eventsFilename);
+    if (structured.grid)
+    {
+        if (writeGcrGrid(&structured.gcrGrid, gridFilename) != 0)
+            fprintf(stderr, "Could not write grid to %s.\n", gridFilename);
+        freeGcrGrid(&structured.gcrGrid);
+    }
+
+    for (long i = 0; i < nFiles; i++)
+        free(files[i]);
+    free(files);
+
+}
+
+int listFiles(const char *directory, char satelliteLetter, const char *version, char ***files, long *nFiles)
+{
+    *files = NULL;
+    *nFiles = 0;
+
+    char *searchPath[2] = {NULL, NULL};
+    searchPath[0] = (char *)directory;
+    FTS * fts = fts_open(searchPath, FTS_LOGICAL | FTS_NOCHDIR | FTS_NOSTAT, &alphabeticalFts);
+    if (fts == NULL)
+        return LIST_FILES_OPEN;
+
+    long size = 0;
+    FTSENT * f = fts_read(fts);
     while(f != NULL)
     {
-        if ((strlen(f->fts_name) == 59 && *(f->fts_name+11) == satelliteLetter[0] && strncmp(f->fts_name+12, "TISL1B", 6) == 0 && strncmp(f->fts_name + 51, version, 4) == 0))
+        if ((strlen(f->fts_name) == 59 && *(f->fts_name+11) == satelliteLetter && strncmp(f->fts_name+12, "TISL1B", 6) == 0 && strncmp(f->fts_name + 51, version, 4) == 0))
         {
-            // The memory pointers
-            for (uint8_t i = 0; i < NUM_CDF_VARS; i++)
+            if (*nFiles == size)
             {
-                dataBuffers[i] = NULL;
+                size = size == 0 ? 256 : 2 * size;
+                char **mem = realloc(*files, size * sizeof(char *));
+                if (mem == NULL)
+                {
+                    fts_close(fts);
+                    return LIST_FILES_MEM;
+                }
+                *files = mem;
             }
-            nRecs = 0;
-            status = loadData(f->fts_path, dataBuffers, &nRecs);
-            if (nRecs > 0)
+            (*files)[*nFiles] = strdup(f->fts_path);
+            if ((*files)[*nFiles] == NULL)
             {
-                // fprintf(stderr, "Processing %s\n", f->fts_name);
-                processData(dataBuffers, nRecs);
-                fflush(stdout);
-                fflush(stderr);
+                fts_close(fts);
+                return LIST_FILES_MEM;
             }
+            (*nFiles)++;
+        }
+        f = fts_read(fts);
+    }
+
+    fts_close(fts);
+
+    return LIST_FILES_OK;
+}
+
+int processFile(const char *filename, FILE *output, const DetectorOptions *options, ImageRecords *records)
+{
+    uint8_t * dataBuffers[NUM_CDF_VARS];
+    // The memory pointers
+    for (uint8_t i = 0; i < NUM_CDF_VARS; i++)
+    {
+        dataBuffers[i] = NULL;
+    }
+    long nRecs = 0;
+    char cdfFilename[FILENAME_MAX];
+    bool staged = false;
+    int status = stageProduct(filename, options->stagingDir, cdfFilename, &staged);
+    if (status != ZIP_OK)
+    {
+        fprintf(stderr, "%s: %s. Skipping this file.\n", filename, zipStatusMessage(status));
+        return -1;
+    }
+    status = loadData(cdfFilename, dataBuffers, &nRecs);
+    if (staged)
+        unlink(cdfFilename);
+    if (nRecs > 0)
+    {
+        // fprintf(stderr, "Processing %s\n", filename);
+        processData(dataBuffers, nRecs, output, options, records);
+        if (options->benchmark)
+            benchmarkStatistics(dataBuffers, nRecs);
+    }
 
-            // free memory
-            for (uint8_t i = 0; i < NUM_CDF_VARS; i++)
+    // free memory
+    for (uint8_t i = 0; i < NUM_CDF_VARS; i++)
+    {
+        free(dataBuffers[i]);
+    }
+
+    return status;
+}
+
+// The CDF file to open for filename. A ZIP archive's CDF member is copied to
+// the staging directory unless it has already been extracted next to the archive.
+int stageProduct(const char *filename, const char *stagingDir, char *cdfFilename, bool *staged)
+{
+    *staged = false;
+    size_t length = strlen(filename);
+    snprintf(cdfFilename, FILENAME_MAX, "%s", filename);
+    if (length < 4 || strcasecmp(filename + length - 4, ".zip") != 0)
+        return ZIP_OK;
+
+    snprintf(cdfFilename, FILENAME_MAX, "%.*s.cdf", (int)(length - 4), filename);
+    if (access(cdfFilename, R_OK) == 0)
+        return ZIP_OK;
+
+    ZipMember member;
+    int status = findZipMember(filename, ".cdf", &member);
+    if (status != ZIP_OK)
+        return status;
+
+    // Process ID keeps concurrent workers and runs apart
+    const char *name = strrchr(member.name, '/');
+    name = name == NULL ? member.name : name + 1;
+    snprintf(cdfFilename, FILENAME_MAX, "%s/tiiGcrDetector_%d_%s", stagingDir, (int)getpid(), name);
+    status = stageZipMember(filename, &member, cdfFilename);
+    if (status == ZIP_OK)
+        *staged = true;
+
+    return status;
+}
+
+// Prints each file's output to stdout in file order. Also returns the outputs and image records
+// if results is not NULL, and adds each file's images to the event table and grid if structured is not NULL.
+void processFiles(char **files, long nFiles, int nWorkers, const DetectorOptions *options, FileResult *results, StructuredOutput *structured)
+{
+    if (nWorkers > nFiles)
+        nWorkers = nFiles;
+    if (nWorkers > 1)
+    {
+        processFilesInParallel(files, nFiles, nWorkers, options, results, structured);
+        return;
+    }
+
+    ImageRecords records;
+    initImageRecords(&records);
+    ImageRecords *fileRecords = NULL;
+    for (long i = 0; i < nFiles; i++)
+    {
+        records.nRecords = 0;
+        fileRecords = &records;
+        if (results == NULL)
+            processFile(files[i], stdout, options, options->records ? fileRecords : NULL);
+        else
+        {
+            results[i].output = NULL;
+            results[i].length = 0;
+            fileRecords = &results[i].records;
+            initImageRecords(fileRecords);
+            FILE *stream = open_memstream(&results[i].output, &results[i].length);
+            if (stream == NULL)
             {
-                free(dataBuffers[i]);
+                fprintf(stderr, "Out of memory.\n");
+                exit(EXIT_FAILURE);
             }
+            results[i].status = processFile(files[i], stream, options, options->records ? fileRecords : NULL);
+            fclose(stream);
+            fwrite(results[i].output, 1, results[i].length, stdout);
+        }
+        if (structured != NULL)
+            writeStructuredOutput(structured, fileRecords);
+        fflush(stdout);
+        fflush(stderr);
+        reportProgress(i + 1, nFiles);
+    }
+    freeImageRecords(&records);
+
+    return;
+}
+
+void writeStructuredOutput(StructuredOutput *structured, const ImageRecords *records)
+{
+    if (structured->events != NULL)
+        writeEvents(structured->events, structured->eventFormat, records);
+    if (structured->grid)
+        accumulateGcrGrid(&structured->gcrGrid, records, structured->gridDetector);
+
+    return;
+}
+
+// Processes only files not in the state directory or changed since, and updates the state and catalog there.
+// Image records are always kept in the state, and every file's records are replayed into the event table
+// and grid in chronological order, so that they cover the same files as the catalog.
+int processFilesIncrementally(char **files, long nFiles, int nWorkers, const DetectorOptions *options, const char *stateDir, char satelliteLetter, const char *version, StructuredOutput *structured)
+{
+    DetectorOptions incrementalOptions = *options;
+    incrementalOptions.records = true;
+
+    char settings[STATE_SETTINGS_LENGTH] = {0};
+    snprintf(settings, STATE_SETTINGS_LENGTH, "%s/mode%d/statistic%d", SOFTWARE_VERSION, options->mode, options->statistic);
+
+    GcrState state = {0};
+    int status = loadState(&state, stateDir, satelliteLetter, version, settings);
+    if (status != STATE_OK)
+    {
+        fprintf(stderr, "Could not read state file %s.\n", state.stateFilename);
+        return status;
+    }
+
+    char **toProcess = calloc(nFiles, sizeof(char *));
+    struct stat *fileStats = calloc(nFiles, sizeof(struct stat));
+    FileResult *results = calloc(nFiles, sizeof(FileResult));
+    if (toProcess == NULL || fileStats == NULL || results == NULL)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    long nToProcess = 0;
+    const char *name = NULL;
+    for (long i = 0; i < nFiles; i++)
+    {
+        name = strrchr(files[i], '/') != NULL ? strrchr(files[i], '/') + 1 : files[i];
+        if (stat(files[i], &fileStats[nToProcess]) != 0)
+            continue;
+        if (unchangedStateEntry(&state, name, fileStats[nToProcess].st_size, fileStats[nToProcess].st_mtime) != NULL)
+            continue;
+        toProcess[nToProcess++] = files[i];
+    }
+    fprintf(stderr, "%ld files unchanged since the last run, %ld to process\n", nFiles - nToProcess, nToProcess);
+
+    if (nToProcess > 0)
+        processFiles(toProcess, nToProcess, nWorkers, &incrementalOptions, results, NULL);
+
+    // Files that could not be read are tried again next time
+    for (long i = 0; i < nToProcess && status == STATE_OK; i++)
+    {
+        name = strrchr(toProcess[i], '/') != NULL ? strrchr(toProcess[i], '/') + 1 : toProcess[i];
+        if (results[i].status == CDF_OK && results[i].output != NULL)
+        {
+            status = updateStateEntry(&state, name, fileStats[i].st_size, fileStats[i].st_mtime, results[i].output, results[i].length, &results[i].records);
+            if (status == STATE_OK)
+                results[i].output = NULL;
+        }
+    }
+    if (status == STATE_OK)
+        status = saveState(&state);
+    if (status != STATE_OK)
+        fprintf(stderr, "Could not update state file %s.\n", state.stateFilename);
+    else
+        fprintf(stderr, "Catalog: %s\n", state.catalogFilename);
+
+    // saveState() left the entries in chronological order
+    for (long i = 0; i < state.nEntries && status == STATE_OK && structured != NULL; i++)
+        writeStructuredOutput(structured, &state.entries[i].records);
+
+    for (long i = 0; i < nToProcess; i++)
+    {
+        free(results[i].output);
+        freeImageRecords(&results[i].records);
+    }
+    free(results);
+    free(fileStats);
+    free(toProcess);
+    freeState(&state);
+
+    return status;
+}
+
+void reportProgress(long processedFiles, long nFiles)
+{
+    long statusInterval = (long) (STATUS_INTERVAL_FRACTION * (double) nFiles);
+    if (statusInterval < 1)
+        statusInterval = 1;
+    if (processedFiles % statusInterval == 0)
+    {
+        fprintf(stderr, "Processed %ld files (%.0f%%)\n", processedFiles, (float)processedFiles / (float)nFiles * 100.0);
+        fflush(stderr);
+    }
+
+    return;
+}
 
-            processedFiles++;
-            if (processedFiles % statusInterval == 0)
+// Each worker process reads file indices from its jobs pipe and answers on its
+// results pipe with the index, the loadData() status, the length of the output,
+// the output itself, the number of image records and the records.
+// The CDF library is not thread-safe, hence processes rather than threads.
+static void runFileWorker(char **files, long nFiles, const DetectorOptions *options, int jobs, int results)
+{
+    long index = 0;
+    int status = 0;
+    char *output = NULL;
+    size_t length = 0;
+    ImageRecords records;
+    initImageRecords(&records);
+
+    while (readFully(jobs, &index, sizeof index) == 0)
+    {
+        if (index < 0 || index >= nFiles)
+            break;
+        output = NULL;
+        length = 0;
+        FILE *stream = open_memstream(&output, &length);
+        if (stream == NULL)
+            _exit(EXIT_FAILURE);
+        records.nRecords = 0;
+        status = processFile(files[index], stream, options, options->records ? &records : NULL);
+        fclose(stream);
+        fflush(stderr);
+        if (writeFully(results, &index, sizeof index) != 0 || writeFully(results, &status, sizeof status) != 0 || writeFully(results, &length, sizeof length) != 0 || writeFully(results, output, length) != 0)
+            _exit(EXIT_FAILURE);
+        if (writeFully(results, &records.nRecords, sizeof records.nRecords) != 0 || writeFully(results, records.records, records.nRecords * sizeof(GcrImageRecord)) != 0)
+            _exit(EXIT_FAILURE);
+        free(output);
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+static int startFileWorker(FileWorker *worker, char **files, long nFiles, const DetectorOptions *options)
+{
+    worker->pid = 0;
+    worker->jobs = -1;
+    worker->results = -1;
+    worker->index = -1;
+
+    int toWorker[2];
+    int fromWorker[2];
+    if (pipe(toWorker) != 0)
+        return -1;
+    if (pipe(fromWorker) != 0)
+    {
+        close(toWorker[0]);
+        close(toWorker[1]);
+        return -1;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(toWorker[0]);
+        close(toWorker[1]);
+        close(fromWorker[0]);
+        close(fromWorker[1]);
+        return -1;
+    }
+    if (pid == 0)
+    {
+        close(toWorker[1]);
+        close(fromWorker[0]);
+        runFileWorker(files, nFiles, options, toWorker[0], fromWorker[1]);
+    }
+    close(toWorker[0]);
+    close(fromWorker[1]);
+    worker->pid = pid;
+    worker->jobs = toWorker[1];
+    worker->results = fromWorker[0];
+
+    return 0;
+}
+
+static void stopFileWorker(FileWorker *worker)
+{
+    // Later workers inherit this worker's jobs pipe, so closing it is not
+    // enough to end the worker: send an explicit stop index
+    long stop = -1;
+    if (worker->jobs >= 0)
+    {
+        writeFully(worker->jobs, &stop, sizeof stop);
+        close(worker->jobs);
+    }
+    if (worker->results >= 0)
+        close(worker->results);
+    if (worker->pid > 0)
+        waitpid(worker->pid, NULL, 0);
+    worker->pid = 0;
+    worker->jobs = -1;
+    worker->results = -1;
+    worker->index = -1;
+
+    return;
+}
+
+void processFilesInParallel(char **files, long nFiles, int nWorkers, const DetectorOptions *options, FileResult *results, StructuredOutput *structured)
+{
+    // Output of a file that finishes before an earlier one is held until its turn
+    char **outputs = calloc(nFiles, sizeof(char *));
+    size_t *lengths = calloc(nFiles, sizeof(size_t));
+    int *statuses = calloc(nFiles, sizeof(int));
+    ImageRecords *fileRecords = calloc(nFiles, sizeof(ImageRecords));
+    bool *finished = calloc(nFiles, sizeof(bool));
+    FileWorker *workers = calloc(nWorkers, sizeof(FileWorker));
+    struct pollfd *fds = calloc(nWorkers, sizeof(struct pollfd));
+    if (outputs == NULL || lengths == NULL || statuses == NULL || fileRecords == NULL || finished == NULL || workers == NULL || fds == NULL)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // A worker that dies must not take the parent with it
+    signal(SIGPIPE, SIG_IGN);
+
+    for (int w = 0; w < nWorkers; w++)
+    {
+        if (startFileWorker(&workers[w], files, nFiles, options) != 0)
+        {
+            fprintf(stderr, "Could not start worker process %d.\n", w);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    long nextFile = 0;
+    long nextOutput = 0;
+    int busy = 0;
+
+    while (nextOutput < nFiles)
+    {
+        for (int w = 0; w < nWorkers && nextFile < nFiles; w++)
+        {
+            if (workers[w].index >= 0)
+                continue;
+            // Replace a worker that died on an earlier file
+            if (workers[w].pid <= 0 && startFileWorker(&workers[w], files, nFiles, options) != 0)
+                continue;
+            if (writeFully(workers[w].jobs, &nextFile, sizeof nextFile) != 0)
             {
-                fprintf(stderr, "Processed %ld files (%.0f%%)\n", processedFiles, (float)processedFiles / (float)nFiles * 100.0);
-                fflush(stderr);
+                stopFileWorker(&workers[w]);
+                continue;
             }
+            workers[w].index = nextFile++;
+            busy++;
+        }
+        if (busy == 0)
+        {
+            fprintf(stderr, "Could not run any worker processes.\n");
+            exit(EXIT_FAILURE);
+        }
 
+        for (int w = 0; w < nWorkers; w++)
+        {
+            fds[w].fd = workers[w].index >= 0 ? workers[w].results : -1;
+            fds[w].events = POLLIN;
+            fds[w].revents = 0;
+        }
+        if (poll(fds, nWorkers, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Could not wait for worker processes.\n");
+            exit(EXIT_FAILURE);
+        }
 
+        for (int w = 0; w < nWorkers; w++)
+        {
+            if (fds[w].revents == 0)
+                continue;
+            long index = workers[w].index;
+            long reportedIndex = -1;
+            int status = -1;
+            size_t length = 0;
+            char *output = NULL;
+            ImageRecords *records = &fileRecords[index];
+            if (readFully(workers[w].results, &reportedIndex, sizeof reportedIndex) != 0 || reportedIndex != index || readFully(workers[w].results, &status, sizeof status) != 0 || readFully(workers[w].results, &length, sizeof length) != 0 || (output = malloc(length + 1)) == NULL || readFully(workers[w].results, output, length) != 0 || readFully(workers[w].results, &records->nRecords, sizeof records->nRecords) != 0 || (records->records = malloc(records->nRecords * sizeof(GcrImageRecord) + 1)) == NULL || readFully(workers[w].results, records->records, records->nRecords * sizeof(GcrImageRecord)) != 0)
+            {
+                freeImageRecords(records);
+                fprintf(stderr, "Worker failed processing %s. Skipping this file.\n", files[index]);
+                free(output);
+                output = NULL;
+                length = 0;
+                status = -1;
+                stopFileWorker(&workers[w]);
+            }
+            workers[w].index = -1;
+            busy--;
+            outputs[index] = output;
+            lengths[index] = length;
+            statuses[index] = status;
+            finished[index] = true;
+        }
+
+        while (nextOutput < nFiles && finished[nextOutput])
+        {
+            if (lengths[nextOutput] > 0)
+                fwrite(outputs[nextOutput], 1, lengths[nextOutput], stdout);
+            if (structured != NULL)
+                writeStructuredOutput(structured, &fileRecords[nextOutput]);
+            if (results != NULL)
+            {
+                results[nextOutput].status = statuses[nextOutput];
+                results[nextOutput].output = outputs[nextOutput];
+                results[nextOutput].length = lengths[nextOutput];
+                results[nextOutput].records = fileRecords[nextOutput];
+                initImageRecords(&fileRecords[nextOutput]);
+            }
+            else
+            {
+                free(outputs[nextOutput]);
+                freeImageRecords(&fileRecords[nextOutput]);
+            }
+            outputs[nextOutput] = NULL;
+            fflush(stdout);
+            nextOutput++;
+            reportProgress(nextOutput, nFiles);
         }
-        f = fts_read(fts);
     }
 
-    fts_close(fts);
+    for (int w = 0; w < nWorkers; w++)
+        stopFileWorker(&workers[w]);
+
+    free(fds);
+    free(workers);
+    free(finished);
+    free(fileRecords);
+    free(statuses);
+    free(lengths);
+    free(outputs);
+
+    return;
+}
+
+static int readFully(int fd, void *buffer, size_t length)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = read(fd, (char *)buffer + done, length - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        done += n;
+    }
 
+    return 0;
+}
+
+static int writeFully(int fd, const void *buffer, size_t length)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = write(fd, (const char *)buffer + done, length - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        done += n;
+    }
+
+    return 0;
 }
 
 int loadData(const char * filename, uint8_t **dataBuffers, long *numberOfRecords)
@@ -292,8 +955,20 @@ int loadData(const char * filename, uint8_t **dataBuffers, long *numberOfRecords
             numValues *= dimSizes[j];
         }
         memorySize = numValues * nRecs * numVarBytes;
-        dataBuffers[i] = (uint8_t*) malloc((size_t) memorySize);
-        status = CDFgetzVarAllRecordsByVarID(calCdfId, varNum, dataBuffers[i]);
+        if (i == RAW_IMAGE_H_VAR || i == RAW_IMAGE_V_VAR)
+        {
+            // Images not read stay zero
+            dataBuffers[i] = (uint8_t*) calloc((size_t) memorySize, 1);
+            if (dataBuffers[i] == NULL)
+                status = CDF_WARN;
+            else
+                status = loadCandidateImages(calCdfId, varNum, dataBuffers, i == RAW_IMAGE_H_VAR ? 'H' : 'V', nRecs, numValues * numVarBytes);
+        }
+        else
+        {
+            dataBuffers[i] = (uint8_t*) malloc((size_t) memorySize);
+            status = CDFgetzVarAllRecordsByVarID(calCdfId, varNum, dataBuffers[i]);
+        }
         if (status != CDF_OK)
         {
             printErrorMessage(status);
@@ -307,6 +982,34 @@ int loadData(const char * filename, uint8_t **dataBuffers, long *numberOfRecords
     // Update number of records found
     *numberOfRecords = *numberOfRecords + nRecs;
 
+    return CDF_OK;
+}
+
+// The variables list has the small ones ahead of the images, so the voltages
+// and validity flags are already loaded. Reads only the runs of records for
+// which processData() examines the image.
+CDFstatus loadCandidateImages(CDFid cdfId, long varNum, uint8_t **dataBuffers, char sensor, long nRecs, long recordBytes)
+{
+    CDFstatus status = CDF_OK;
+    long timeIndex = 0;
+    long firstRecord = -1;
+    bool candidate = false;
+
+    for (timeIndex = 0; timeIndex <= nRecs; timeIndex++)
+    {
+        candidate = timeIndex < nRecs && (sensor == 'H' ? CANDIDATE_IMAGE_H() : CANDIDATE_IMAGE_V());
+        if (candidate && firstRecord < 0)
+            firstRecord = timeIndex;
+        else if (!candidate && firstRecord >= 0)
+        {
+            status = CDFgetzVarRangeRecordsByVarID(cdfId, varNum, firstRecord, timeIndex - 1, dataBuffers[sensor == 'H' ? RAW_IMAGE_H_VAR : RAW_IMAGE_V_VAR] + firstRecord * recordBytes);
+            if (status != CDF_OK)
+                return status;
+            firstRecord = -1;
+        }
+    }
+
+    return CDF_OK;
 }
 
 void printErrorMessage(CDFstatus status)
@@ -316,153 +1019,182 @@ void printErrorMessage(CDFstatus status)
     fprintf(stderr, "%s\n", errorMessage);
 }
 
-int processData(uint8_t **dataBuffers, long nRecs)
+int processData(uint8_t **dataBuffers, long nRecs, FILE *output, const DetectorOptions *options, ImageRecords *records)
 {
     long timeIndex = 0;
 
-    double mean = 0.0;
-    double stddev = 0.0;
-
-    double unixTime = 0.0;
-    int row = 0;
-    int col = 0;
-
-    long imageGcrCountH = 0;
-    long imageGcrCountV = 0;
     long dayGcrCountH = 0;
     long dayGcrCountV = 0;
+    long dayBinnedCountH = 0;
+    long dayBinnedCountV = 0;
 
-    uint16_t *imageBuffer = malloc(IMAGE_PIXELS * sizeof (uint16_t));
-    if (imageBuffer == NULL)
-    {
-        return PROCESS_DATA_MEM;
-    }
+    processSensor(dataBuffers, nRecs, 'H', output, options, records, &dayGcrCountH, &dayBinnedCountH);
+    processSensor(dataBuffers, nRecs, 'V', output, options, records, &dayGcrCountV, &dayBinnedCountV);
+
+    timeIndex = 0;
+    long year, month, day, hour, minute, second, millisecond;
+    EPOCHbreakdown(TIME(), &year, &month, &day, &hour, &minute, &second, &millisecond);
+    if (dayGcrCountH > 0 || dayGcrCountV > 0)
+        fprintf(output, "Processed %4ld%02ld%02ld %ld H GCRs %ld V GCRs\n", year, month, day, dayGcrCountH, dayGcrCountV);
+    if (dayBinnedCountH > 0 || dayBinnedCountV > 0)
+        fprintf(output, "Processed %4ld%02ld%02ld %ld H binned GCRs %ld V binned GCRs\n", year, month, day, dayBinnedCountH, dayBinnedCountV);
+
+    return PROCESS_DATA_OK;
+}
+
+// Runs the selected detectors on each candidate image of one sensor while the image is in cache.
+// The binned detector compares each image with the one from the previous record, if that was also a candidate.
+// Each image and detector adds a record if records is not NULL.
+void processSensor(uint8_t **dataBuffers, long nRecs, char sensor, FILE *output, const DetectorOptions *options, ImageRecords *records, long *dayGcrCount, long *dayBinnedCount)
+{
+    long timeIndex = 0;
+    double unixTime = 0.0;
+    long imageGcrCount = 0;
+    uint16_t maxIntensity = 0;
+    const uint16_t *image = NULL;
+    GcrImageRecord record = {0};
+    record.sensor = sensor;
+
+    // Ring buffer of binned frames and the record each holds
+    int32_t binned[BINNED_HISTORY][BINNED_ROWS * BINNED_COLS];
+    long binnedRecord[BINNED_HISTORY];
+    for (int k = 0; k < BINNED_HISTORY; k++)
+        binnedRecord[k] = -1;
+    int32_t *current = NULL;
+    const int32_t *previous = NULL;
+    int32_t diff = 0;
 
-    // H sensor
     for (timeIndex = 0; timeIndex < nRecs; timeIndex++)
     {
-        imageGcrCountH = 0;
-        if (VALID_IMAGERY_H() && VBIASH() > -1.0 && VMCPH() > -20.0 && VPHOSH() < 50.0)
+        if (!(sensor == 'H' ? CANDIDATE_IMAGE_H() : CANDIDATE_IMAGE_V()))
+            continue;
+        image = sensor == 'H' ? RAW_IMAGE_H() : RAW_IMAGE_V();
+        EPOCHtoUnixTime(TIME_ADDR(), &unixTime, 1);
+        record.time = unixTime;
+        record.latitude = LAT();
+        record.longitude = LON();
+        record.radius = RADIUS() / 1000.0;
+
+        if (options->mode != MODE_BINNED)
         {
-            // fprintf(stdout, "Image %ld\n", timeIndex);
-            for (int i = 0; i < IMAGE_PIXELS; i++)
+            imageGcrCount = countImageGcrs(image, options->statistic, &maxIntensity);
+            *dayGcrCount += imageGcrCount;
+            if (imageGcrCount > 0)
+                fprintf(output, "%.1lf %c image %ld: %ld hot pixels %.1f N %.1f E @ R=%.2f km\n", unixTime, sensor, timeIndex+1, imageGcrCount, LAT(), LON(), RADIUS()/1000.0);
+            if (records != NULL)
             {
-                // Disregard unphysical pixel values
-                if (RAW_IMAGE_H()[i] <= MAX_PIXEL_VALUE)
-                    imageBuffer[i] = RAW_IMAGE_H()[i];
-                else
-                    imageBuffer[i] = 0;
+                record.detector = DETECTOR_STATISTIC;
+                record.count = (int32_t)imageGcrCount;
+                record.maxIntensity = maxIntensity;
+                appendImageRecord(records, &record);
             }
-            mean = gsl_stats_short_mean(imageBuffer, 1, IMAGE_PIXELS);
-            stddev = gsl_stats_short_sd(imageBuffer, 1, IMAGE_PIXELS);
-            EPOCHtoUnixTime(TIME_ADDR(), &unixTime, 1);
-            for (int i = 0; i < IMAGE_PIXELS; i++)
+        }
+
+        if (options->mode != MODE_STATISTIC)
+        {
+            current = binned[timeIndex % BINNED_HISTORY];
+            binnedRecord[timeIndex % BINNED_HISTORY] = timeIndex;
+            binImage(image, current);
+            record.detector = DETECTOR_BINNED;
+            record.count = 0;
+            record.maxIntensity = 0;
+            if (timeIndex > 0 && binnedRecord[(timeIndex - 1) % BINNED_HISTORY] == timeIndex - 1)
             {
-                // if (mad > 0 && (double) RAW_IMAGE_H()[i] > (median + (GCR_SIGMAS * mad)))
-                row = i % 66;
-                col = i / 66;
-                if (stddev > 0 && (double) RAW_IMAGE_H()[i] > (mean + (GCR_SIGMAS * stddev)) && RAW_IMAGE_H()[i] <= MAX_PIXEL_VALUE && ((col >= MINCOL && row >= MINROW2 && row <= MAXROW2) || (row >= MINROW && row <= MAXROW)))
+                previous = binned[(timeIndex - 1) % BINNED_HISTORY];
+                for (int b = 0; b < BINNED_ROWS * BINNED_COLS; b++)
                 {
-                    // fprintf(stdout, "%.2lf H %ld (%.1f,%.1f,%.1f), col %d, row %d, intensity: %d, mean: %.2lf, sd: %.2lf\n", unixTime, timeIndex+1, LAT(), LON(), RADIUS(), col+1, row+1, RAW_IMAGE_H()[i], mean, stddev);
-                    imageGcrCountH++;
-                    dayGcrCountH++;
+                    diff = current[b] - previous[b];
+                    if (diff >= GCR_BINNED_THRESHOLD)
+                    {
+                        fprintf(output, "%.1lf %c image %ld: possible GCR in bin row %d col %d, intensity increase %d %.1f N %.1f E @ R=%.2f km\n", unixTime, sensor, timeIndex+1, b / BINNED_COLS + 1, b % BINNED_COLS + 1, diff, LAT(), LON(), RADIUS()/1000.0);
+                        (*dayBinnedCount)++;
+                        record.count++;
+                        if (diff > record.maxIntensity)
+                            record.maxIntensity = diff > UINT16_MAX ? UINT16_MAX : diff;
+                    }
                 }
             }
-            if (imageGcrCountH > 0)
-                fprintf(stdout, "%.1lf H image %ld: %ld hot pixels %.1f N %.1f E @ R=%.2f km\n", unixTime, timeIndex+1, imageGcrCountH, LAT(), LON(), RADIUS()/1000.0);
+            if (records != NULL)
+                appendImageRecord(records, &record);
         }
     }
-    // V sensor
-    for (timeIndex = 0; timeIndex < nRecs; timeIndex++)
+
+    return;
+}
+
+// Sums of BINNED_ROW_PIXELS x BINNED_COL_PIXELS blocks over the binned region.
+// Images are stored by column, so the columns of each block are first added
+// row by row as contiguous vectors, then the rows are added in groups.
+void binImage(const uint16_t *image, int32_t *binned)
+{
+    int32_t rowSums[BINNED_LAST_ROW + 1];
+    const uint16_t *column = NULL;
+    int row = 0;
+
+    for (int c = 0; c < BINNED_COLS; c++)
     {
-        imageGcrCountV = 0;
-        if (VALID_IMAGERY_V() && VBIASV() > -1.0 && VMCPV() > -20.0 && VPHOSV() < 50.0)
+        for (int i = BINNED_FIRST_ROW; i <= BINNED_LAST_ROW; i++)
+            rowSums[i] = 0;
+        for (int k = 0; k < BINNED_COL_PIXELS; k++)
         {
-            // fprintf(stdout, "Image %ld\n", timeIndex);
-            for (int i = 0; i < IMAGE_PIXELS; i++)
-            {
-                // Disregard unphysical pixel values
-                if (RAW_IMAGE_V()[i] <= MAX_PIXEL_VALUE)
-                    imageBuffer[i] = RAW_IMAGE_V()[i];
-                else
-                    imageBuffer[i] = 0;
-            }
-            mean = gsl_stats_short_mean(imageBuffer, 1, IMAGE_PIXELS);
-            stddev = gsl_stats_short_sd(imageBuffer, 1, IMAGE_PIXELS);
-            EPOCHtoUnixTime(TIME_ADDR(), &unixTime, 1);
-            for (int i = 0; i < IMAGE_PIXELS; i++)
-            {
-                // if (mad > 0 && (double) RAW_IMAGE_H()[i] > (median + (GCR_SIGMAS * mad)))
-                row = i % 66;
-                col = i / 66;
-                if (stddev > 0 && (double) RAW_IMAGE_V()[i] > (mean + (GCR_SIGMAS * stddev)) && RAW_IMAGE_V()[i] <= MAX_PIXEL_VALUE && ((col >= MINCOL && row >= MINROW2 && row <= MAXROW2) || (row >= MINROW && row <= MAXROW)))
-                {
-                    // fprintf(stdout, "%.2lf V %ld (%.1f,%.1f,%.1f), col %d, row %d, intensity: %d, mean: %.2lf, sd: %.2lf\n", unixTime, timeIndex+1, LAT(), LON(), RADIUS(), col+1, row+1, RAW_IMAGE_H()[i], mean, stddev);
-                    imageGcrCountV++;
-                    dayGcrCountV++;
-                }
-            }
-            if (imageGcrCountV > 0)
-                fprintf(stdout, "%.1lf V image %ld: %ld hot pixels %.1f N %.1f E @ R=%.2f km\n", unixTime, timeIndex+1, imageGcrCountV, LAT(), LON(), RADIUS()/1000.0);
+            column = image + (BINNED_FIRST_COL + c * BINNED_COL_PIXELS + k) * 66;
+            for (int i = BINNED_FIRST_ROW; i <= BINNED_LAST_ROW; i++)
+                rowSums[i] += column[i];
+        }
+        for (int r = 0; r < BINNED_ROWS; r++)
+            binned[r * BINNED_COLS + c] = 0;
+        for (int i = BINNED_FIRST_ROW; i <= BINNED_LAST_ROW; i++)
+        {
+            row = (i - BINNED_FIRST_ROW) / BINNED_ROW_PIXELS;
+            binned[row * BINNED_COLS + c] += rowSums[i];
         }
-
     }
-    timeIndex = 0;
-    long year, month, day, hour, minute, second, millisecond;
-    EPOCHbreakdown(TIME(), &year, &month, &day, &hour, &minute, &second, &millisecond);
-    if (dayGcrCountH > 0 || dayGcrCountV > 0)
-        fprintf(stdout, "Processed %4ld%02ld%02ld %ld H GCRs %ld V GCRs\n", year, month, day, dayGcrCountH, dayGcrCountV);
 
-    free(imageBuffer);
-    return PROCESS_DATA_OK;
+    return;
 }
 
-void processDataBinned(uint8_t **dataBuffers, long nRecs)
+// Times both detector statistics on this file's candidate images and reports to stderr
+void benchmarkStatistics(uint8_t **dataBuffers, long nRecs)
 {
+    const int statistics[2] = {STATISTIC_MEAN, STATISTIC_MAD};
+    double seconds[2] = {0.0};
+    long hotPixels[2] = {0};
+    long nImages = 0;
     long timeIndex = 0;
+    struct timespec start, stop;
 
-    uint16_t *image = NULL;
-
-    int32_t binned0[11][10] = {0};
-    int32_t binned1[11][10] = {0};
-    int32_t diff = 0;
-    bool candidateImage = false;
-
-    for (timeIndex = 0; timeIndex < nRecs; timeIndex++)
+    for (int s = 0; s < 2; s++)
     {
-        // fprintf(stdout, "Image %ld\n", timeIndex);
-        for (int i = 0; i < 11; i++)
-        {
-            for (int j = 0; j < 10; j++)
-            {
-                binned0[i][j] = binned1[i][j];
-                binned1[i][j] = 0;
-            }
-        }
-        if (VALID_IMAGERY_H() && VBIASH() > -1.0 && VMCPH() > -20.0 && VPHOSH() < 50.0)
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int r = 0; r < BENCHMARK_REPEATS; r++)
         {
-            candidateImage = true;
-            image = RAW_IMAGE_H();
-            for (int i = 6; i < 61; i++)
+            hotPixels[s] = 0;
+            nImages = 0;
+            for (timeIndex = 0; timeIndex < nRecs; timeIndex++)
             {
-                for (int j = 4; j < 36; j++)
+                if (CANDIDATE_IMAGE_H())
                 {
-                    binned1[i/6][j/4] += image[j*66 + i];
+                    hotPixels[s] += countImageGcrs(RAW_IMAGE_H(), statistics[s], NULL);
+                    nImages++;
                 }
-            }
-            for (int i = 0; i < 11; i++)
-            {
-                for (int j = 0; j < 10; j++)
+                if (CANDIDATE_IMAGE_V())
                 {
-                    diff = binned1[i][j] - binned0[i][j];
-                    if (diff >= GCR_BINNED_THRESHOLD)
-                        fprintf(stdout, "Possible GCR: image %ld, (%.1f,%.1f), row %d, col %d, intensity: %d\n", timeIndex, LAT(), LON(), i, j, diff);
+                    hotPixels[s] += countImageGcrs(RAW_IMAGE_V(), statistics[s], NULL);
+                    nImages++;
                 }
             }
         }
-        else
-        {
-            candidateImage = false;
-        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        seconds[s] = (double)(stop.tv_sec - start.tv_sec) + (double)(stop.tv_nsec - start.tv_nsec) / 1e9;
     }
+
+    if (nImages == 0)
+        return;
+
+    timeIndex = 0;
+    long year, month, day, hour, minute, second, millisecond;
+    EPOCHbreakdown(TIME(), &year, &month, &day, &hour, &minute, &second, &millisecond);
+    fprintf(stderr, "Benchmark %4ld%02ld%02ld: %ld images, mean/sd %.2f us/image (%ld hot pixels), median/MAD %.2f us/image (%ld hot pixels)\n", year, month, day, nImages, seconds[0] / (double)(nImages * BENCHMARK_REPEATS) * 1e6, hotPixels[0], seconds[1] / (double)(nImages * BENCHMARK_REPEATS) * 1e6, hotPixels[1]);
+
+    return;
 }
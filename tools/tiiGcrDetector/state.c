@@ -0,0 +1,253 @@
+/*
+
+    TRACIS: tools/tiiGcrDetector/state.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "state.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// State file layout:
+//   tiiGcrDetector state <version> <settings>
+//   file <name> <size> <mtime> <length> <nRecords>
+//   <length bytes of output>
+//   <nRecords GcrImageRecords in host byte order>
+//   ...
+
+static int compareEntries(const void *a, const void *b)
+{
+    return strcmp(((const StateEntry *)a)->name, ((const StateEntry *)b)->name);
+}
+
+static StateEntry *findEntry(const GcrState *state, const char *name)
+{
+    for (long i = 0; i < state->nEntries; i++)
+    {
+        if (strcmp(state->entries[i].name, name) == 0)
+            return &state->entries[i];
+    }
+
+    return NULL;
+}
+
+static void takeRecords(StateEntry *e, ImageRecords *records)
+{
+    e->records = *records;
+    initImageRecords(records);
+
+    return;
+}
+
+static int addEntry(GcrState *state, const char *name, off_t size, time_t modificationTime, char *output, size_t length, ImageRecords *records)
+{
+    if (state->nEntries == state->size)
+    {
+        long newSize = state->size == 0 ? 256 : 2 * state->size;
+        StateEntry *mem = realloc(state->entries, newSize * sizeof(StateEntry));
+        if (mem == NULL)
+            return STATE_MEM;
+        state->entries = mem;
+        state->size = newSize;
+    }
+    StateEntry *e = &state->entries[state->nEntries];
+    e->name = strdup(name);
+    if (e->name == NULL)
+        return STATE_MEM;
+    e->size = size;
+    e->modificationTime = modificationTime;
+    e->output = output;
+    e->length = length;
+    takeRecords(e, records);
+    state->nEntries++;
+
+    return STATE_OK;
+}
+
+int loadState(GcrState *state, const char *directory, char satelliteLetter, const char *version, const char *settings)
+{
+    state->entries = NULL;
+    state->nEntries = 0;
+    state->size = 0;
+    snprintf(state->stateFilename, FILENAME_MAX, "%s/tiiGcrDetector_%c_%s_state.dat", directory, satelliteLetter, version);
+    snprintf(state->catalogFilename, FILENAME_MAX, "%s/tiiGcrDetector_%c_%s_catalog.txt", directory, satelliteLetter, version);
+    snprintf(state->settings, STATE_SETTINGS_LENGTH, "%s", settings);
+
+    FILE *f = fopen(state->stateFilename, "r");
+    if (f == NULL)
+        return errno == ENOENT ? STATE_OK : STATE_FILE;
+
+    int status = STATE_OK;
+    char line[FILENAME_MAX + 128] = {0};
+    int fileVersion = 0;
+    char fileSettings[STATE_SETTINGS_LENGTH] = {0};
+    if (fgets(line, sizeof line, f) == NULL || sscanf(line, "tiiGcrDetector state %d %127s", &fileVersion, fileSettings) != 2)
+    {
+        fclose(f);
+        return STATE_FORMAT;
+    }
+    // Output from other settings is not reused
+    if (fileVersion != STATE_FILE_VERSION || strcmp(fileSettings, settings) != 0)
+    {
+        fclose(f);
+        return STATE_OK;
+    }
+
+    char name[FILENAME_MAX] = {0};
+    long long size = 0;
+    long long modificationTime = 0;
+    size_t length = 0;
+    size_t nRecords = 0;
+    char *output = NULL;
+    ImageRecords records;
+    initImageRecords(&records);
+    while (fgets(line, sizeof line, f) != NULL)
+    {
+        if (sscanf(line, "file %4095s %lld %lld %zu %zu", name, &size, &modificationTime, &length, &nRecords) != 5)
+        {
+            status = STATE_FORMAT;
+            break;
+        }
+        output = malloc(length + 1);
+        if (output == NULL)
+        {
+            status = STATE_MEM;
+            break;
+        }
+        if (nRecords > 0)
+        {
+            records.records = malloc(nRecords * sizeof(GcrImageRecord));
+            if (records.records == NULL)
+            {
+                free(output);
+                status = STATE_MEM;
+                break;
+            }
+            records.nRecords = nRecords;
+            records.size = nRecords;
+        }
+        if (fread(output, 1, length, f) != length || fread(records.records, sizeof(GcrImageRecord), nRecords, f) != nRecords)
+        {
+            free(output);
+            freeImageRecords(&records);
+            status = STATE_FORMAT;
+            break;
+        }
+        status = addEntry(state, name, (off_t)size, (time_t)modificationTime, output, length, &records);
+        if (status != STATE_OK)
+        {
+            free(output);
+            freeImageRecords(&records);
+            break;
+        }
+    }
+    fclose(f);
+    if (status != STATE_OK)
+        freeState(state);
+
+    return status;
+}
+
+const StateEntry *unchangedStateEntry(const GcrState *state, const char *name, off_t size, time_t modificationTime)
+{
+    const StateEntry *e = findEntry(state, name);
+    if (e != NULL && e->size == size && e->modificationTime == modificationTime)
+        return e;
+
+    return NULL;
+}
+
+int updateStateEntry(GcrState *state, const char *name, off_t size, time_t modificationTime, char *output, size_t length, ImageRecords *records)
+{
+    StateEntry *e = findEntry(state, name);
+    if (e == NULL)
+        return addEntry(state, name, size, modificationTime, output, length, records);
+
+    free(e->output);
+    freeImageRecords(&e->records);
+    e->size = size;
+    e->modificationTime = modificationTime;
+    e->output = output;
+    e->length = length;
+    takeRecords(e, records);
+
+    return STATE_OK;
+}
+
+// Writes to a temporary file and renames it so an interrupted run leaves the previous file intact
+static int writeAtomically(const char *filename, const GcrState *state, bool catalog)
+{
+    char tmpFilename[FILENAME_MAX + 8] = {0};
+    snprintf(tmpFilename, sizeof tmpFilename, "%s.tmp", filename);
+    FILE *f = fopen(tmpFilename, "w");
+    if (f == NULL)
+        return STATE_FILE;
+
+    if (!catalog)
+        fprintf(f, "tiiGcrDetector state %d %s\n", STATE_FILE_VERSION, state->settings);
+    for (long i = 0; i < state->nEntries; i++)
+    {
+        const StateEntry *e = &state->entries[i];
+        if (!catalog)
+            fprintf(f, "file %s %lld %lld %zu %zu\n", e->name, (long long)e->size, (long long)e->modificationTime, e->length, e->records.nRecords);
+        if (e->length > 0)
+            fwrite(e->output, 1, e->length, f);
+        if (!catalog && e->records.nRecords > 0)
+            fwrite(e->records.records, sizeof(GcrImageRecord), e->records.nRecords, f);
+    }
+
+    int status = ferror(f) ? STATE_FILE : STATE_OK;
+    if (fclose(f) != 0)
+        status = STATE_FILE;
+    if (status == STATE_OK && rename(tmpFilename, filename) != 0)
+        status = STATE_FILE;
+    if (status != STATE_OK)
+        remove(tmpFilename);
+
+    return status;
+}
+
+int saveState(GcrState *state)
+{
+    // File names sort chronologically
+    if (state->nEntries > 1)
+        qsort(state->entries, state->nEntries, sizeof(StateEntry), compareEntries);
+
+    int status = writeAtomically(state->catalogFilename, state, true);
+    if (status == STATE_OK)
+        status = writeAtomically(state->stateFilename, state, false);
+
+    return status;
+}
+
+void freeState(GcrState *state)
+{
+    for (long i = 0; i < state->nEntries; i++)
+    {
+        free(state->entries[i].name);
+        free(state->entries[i].output);
+        freeImageRecords(&state->entries[i].records);
+    }
+    free(state->entries);
+    state->entries = NULL;
+    state->nEntries = 0;
+    state->size = 0;
+
+    return;
+}
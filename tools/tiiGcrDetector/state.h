@@ -0,0 +1,84 @@
+/*
+
+    TRACIS: tools/tiiGcrDetector/state.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Files already processed, their detector output and image records, so that
+// later runs only process new or changed files. The catalog is the output of
+// all files in chronological order, as a full run would print it.
+
+#ifndef _TRACIS_GCR_STATE_H
+#define _TRACIS_GCR_STATE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "events.h"
+
+#define STATE_FILE_VERSION 2
+#define STATE_SETTINGS_LENGTH 128
+
+enum StateStatus
+{
+    STATE_OK = 0,
+    STATE_FILE,
+    STATE_FORMAT,
+    STATE_MEM
+};
+
+typedef struct StateEntry
+{
+    char *name;
+    off_t size;
+    time_t modificationTime;
+    char *output;
+    size_t length;
+    // Replayed into the event table and grid when the file is unchanged
+    ImageRecords records;
+} StateEntry;
+
+typedef struct GcrState
+{
+    char stateFilename[FILENAME_MAX];
+    char catalogFilename[FILENAME_MAX];
+    // Detector settings the output was made with; other settings start afresh
+    char settings[STATE_SETTINGS_LENGTH];
+    StateEntry *entries;
+    long nEntries;
+    long size;
+} GcrState;
+
+// Reads the state for this satellite, dataset version and detector settings
+// from directory, if there is one
+int loadState(GcrState *state, const char *directory, char satelliteLetter, const char *version, const char *settings);
+
+// The entry for the file, if it was processed while it had this size and modification time
+const StateEntry *unchangedStateEntry(const GcrState *state, const char *name, off_t size, time_t modificationTime);
+
+// Records the output and image records of a processed file, replacing any earlier entry.
+// Takes ownership of output and of the records, leaving records empty.
+int updateStateEntry(GcrState *state, const char *name, off_t size, time_t modificationTime, char *output, size_t length, ImageRecords *records);
+
+// Rewrites the state and catalog files
+int saveState(GcrState *state);
+
+void freeState(GcrState *state);
+
+#endif // _TRACIS_GCR_STATE_H
@@ -0,0 +1,190 @@
+/*
+
+    TRACIS Processor: tools/tracis/calibration_segment.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "calibration_segment.h"
+
+#include "image_analysis.h"
+
+#include <tii/tii.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+void fillSensorCalibration(char satellite, int sensor, SensorCalibration *calibration)
+{
+    calculateRadiusMap(satellite, sensor, calibration->radiusMap);
+    calculateAngleOfArrivalMap(satellite, sensor, calibration->angleOfArrivalMap);
+
+    // Same arithmetic as energySpectrum() and angleOfArrivalSpectrum()
+    float rMin = MIN_RADIUS;
+    float rMax = MAX_RADIUS;
+    float deltaR = (rMax - rMin) / (float) ENERGY_BINS;
+    float maxAngle = MAX_ANGLE;
+    float minAngle = MIN_ANGLE;
+    float deltaAngle = (maxAngle - minAngle) / (float) ANGULAR_BINS;
+    float radius = 0.0;
+    float angle = 0.0;
+    int bin = 0;
+
+    for (int i = 0; i < IMAGE_COLS * IMAGE_ROWS; i++)
+    {
+        radius = calibration->radiusMap[i];
+        bin = (int) floor((radius - rMin) / deltaR);
+        calibration->energyBins[i] = (bin >= 0 && bin < ENERGY_BINS) ? bin : NO_BIN;
+
+        angle = calibration->angleOfArrivalMap[i];
+        bin = (int) floor((angle - minAngle) / deltaAngle);
+        calibration->angleOfArrivalBins[i] = (angle != MISSING_ANGLE && bin >= 0 && bin < ANGULAR_BINS && radius >= rMin) ? bin : NO_BIN;
+    }
+
+    return;
+}
+
+static void fillCalibrationTables(CalibrationTables *tables)
+{
+    for (int s = 0; s < CALIBRATION_SATELLITES; s++)
+    {
+        fillSensorCalibration('A' + s, H_SENSOR, &tables->sensors[s][0]);
+        fillSensorCalibration('A' + s, V_SENSOR, &tables->sensors[s][1]);
+    }
+
+    return;
+}
+
+static int createSegment(const char *name, bool *created)
+{
+    *created = false;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return errno == EEXIST ? CALIBRATION_SEGMENT_OK : CALIBRATION_SEGMENT_OPEN;
+
+    size_t size = sizeof(CalibrationSegment);
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        close(fd);
+        shm_unlink(name);
+        return CALIBRATION_SEGMENT_OPEN;
+    }
+    CalibrationSegment *segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return CALIBRATION_SEGMENT_MAP;
+    }
+
+    segment->magic = CALIBRATION_SEGMENT_MAGIC;
+    segment->version = CALIBRATION_SEGMENT_VERSION;
+    segment->size = (uint32_t)size;
+    segment->creatorPid = (int32_t)getpid();
+    fillCalibrationTables(&segment->tables);
+    // Readers check ready before using the tables
+    __sync_synchronize();
+    segment->ready = 1;
+    munmap(segment, size);
+    *created = true;
+
+    return CALIBRATION_SEGMENT_OK;
+}
+
+// Whether the process filling the segment has exited without marking it ready
+static bool creatorDied(const CalibrationSegment *segment)
+{
+    if (segment->magic != CALIBRATION_SEGMENT_MAGIC || segment->version != CALIBRATION_SEGMENT_VERSION)
+        return false;
+    pid_t pid = (pid_t)segment->creatorPid;
+
+    return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+static int mapSegment(const char *name, const CalibrationTables **tables, bool *created)
+{
+    *tables = NULL;
+
+    int status = createSegment(name, created);
+    if (status != CALIBRATION_SEGMENT_OK)
+        return status;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return CALIBRATION_SEGMENT_OPEN;
+
+    size_t size = sizeof(CalibrationSegment);
+    struct stat s;
+    // The creator may not have sized it yet. Another build's segment has another size.
+    for (int i = 0; i < 10 * CALIBRATION_SEGMENT_WAIT && (fstat(fd, &s) != 0 || s.st_size == 0); i++)
+        usleep(100000);
+    if (fstat(fd, &s) != 0 || (size_t)s.st_size != size)
+    {
+        close(fd);
+        return CALIBRATION_SEGMENT_INVALID;
+    }
+
+    const CalibrationSegment *segment = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED)
+        return CALIBRATION_SEGMENT_MAP;
+
+    for (int i = 0; i < 10 * CALIBRATION_SEGMENT_WAIT && !segment->ready && !creatorDied(segment); i++)
+        usleep(100000);
+    __sync_synchronize();
+    if (!segment->ready || segment->magic != CALIBRATION_SEGMENT_MAGIC || segment->version != CALIBRATION_SEGMENT_VERSION || segment->size != size)
+    {
+        munmap((void *)segment, size);
+        return CALIBRATION_SEGMENT_INVALID;
+    }
+
+    *tables = &segment->tables;
+
+    return CALIBRATION_SEGMENT_OK;
+}
+
+int attachCalibrationSegment(const char *name, const CalibrationTables **tables, bool *created)
+{
+    int status = mapSegment(name, tables, created);
+    // Left by a creator that died before it was ready, or by another build. Processes
+    // that have it mapped keep their mapping. If two processes replace it at once, each
+    // uses its own copy.
+    if (status == CALIBRATION_SEGMENT_INVALID)
+    {
+        shm_unlink(name);
+        status = mapSegment(name, tables, created);
+    }
+
+    return status;
+}
+
+void detachCalibrationSegment(const CalibrationTables *tables)
+{
+    if (tables == NULL)
+        return;
+
+    const char *segment = (const char *)tables - offsetof(CalibrationSegment, tables);
+    munmap((void *)segment, sizeof(CalibrationSegment));
+
+    return;
+}
@@ -0,0 +1,90 @@
+/*
+
+    TRACIS Processor: tools/tracis/calibration_segment.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Day-independent detector geometry for all satellites and sensors, in a
+// POSIX shared memory segment that concurrent tracis processes on a node
+// map read-only. The first process to attach creates and fills it. The
+// segment persists until shm_unlink(); tracisParallel removes it at the end
+// of its run, and a standalone tracis removes a segment it created. A segment
+// that never became ready, or has another build's layout, is replaced.
+
+#ifndef _CALIBRATION_SEGMENT_H
+#define _CALIBRATION_SEGMENT_H
+
+#include "tracis_settings.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Includes the export version so that different builds do not share tables
+#define CALIBRATION_SEGMENT_NAME "/tracis_calibration_" EXPORT_VERSION_STRING
+#define CALIBRATION_SEGMENT_MAGIC 0x54524353 // "TRCS"
+#define CALIBRATION_SEGMENT_VERSION 2
+#define CALIBRATION_SEGMENT_WAIT 5 // seconds to wait for another process to fill the segment
+
+#define CALIBRATION_SATELLITES 3
+#define CALIBRATION_SENSORS 2
+
+#define NO_BIN -1
+
+typedef struct SensorCalibration
+{
+    float radiusMap[IMAGE_COLS * IMAGE_ROWS];
+    float angleOfArrivalMap[IMAGE_COLS * IMAGE_ROWS];
+    // Spectrum bin of each pixel, or NO_BIN. Energy bins are by radius;
+    // whether a pixel counts also depends on the day's energy map.
+    int8_t energyBins[IMAGE_COLS * IMAGE_ROWS];
+    int8_t angleOfArrivalBins[IMAGE_COLS * IMAGE_ROWS];
+} SensorCalibration;
+
+typedef struct CalibrationTables
+{
+    SensorCalibration sensors[CALIBRATION_SATELLITES][CALIBRATION_SENSORS];
+} CalibrationTables;
+
+typedef struct CalibrationSegment
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    int32_t creatorPid;
+    volatile uint32_t ready;
+    CalibrationTables tables;
+} CalibrationSegment;
+
+enum CALIBRATION_SEGMENT_STATUS
+{
+    CALIBRATION_SEGMENT_OK = 0,
+    CALIBRATION_SEGMENT_OPEN,
+    CALIBRATION_SEGMENT_MAP,
+    CALIBRATION_SEGMENT_INVALID
+};
+
+// Fills tables for one satellite ('A', 'B', 'C') and sensor
+void fillSensorCalibration(char satellite, int sensor, SensorCalibration *calibration);
+
+// Maps the named segment read-only, creating and filling it first if it does not exist
+// or is unusable. created is set to whether this call created the segment.
+int attachCalibrationSegment(const char *name, const CalibrationTables **tables, bool *created);
+
+void detachCalibrationSegment(const CalibrationTables *tables);
+
+#endif // _CALIBRATION_SEGMENT_H
@@ -180,6 +180,23 @@ CDFstatus addVariableAttributes(CDFid id, varAttr attr)
             return status;
         }
     }
+    else if (strcmp(attr.type, "CDF_INT2") == 0)
+    {
+        int16_t val = (int16_t) attr.validMin;
+        status = CDFputAttrzEntry(id, CDFgetAttrNum(id, "VALIDMIN"), varNum, CDF_INT2, 1, &val);
+        if (status != CDF_OK)
+        {
+            printErrorMessage(status);
+            return status;
+        }
+        val = (int16_t) attr.validMax;
+        status = CDFputAttrzEntry(id, CDFgetAttrNum(id, "VALIDMAX"), varNum, CDF_INT2, 1, &val);
+        if (status != CDF_OK)
+        {
+            printErrorMessage(status);
+            return status;
+        }
+    }
     else if (strcmp(attr.type, "CDF_UINT4") == 0)
     {
         uint32_t val = (uint32_t) attr.validMin;
@@ -393,6 +410,17 @@ void addAttributesLR(CDFid id, const char *cdfFilename, const char *efiFilenames
         addVariableAttributes(id, variableAttrs[i]);
     }
 
+    // Only exported with --gcr-detection
+    const varAttr gcrAttrs[] = {
+        {"GCR_count_H", "CDF_INT2", "*", "H sensor cosmic ray hot pixels in image with high voltages off; -1 otherwise", -1, 2640, "%4.0f"},
+        {"GCR_count_V", "CDF_INT2", "*", "V sensor cosmic ray hot pixels in image with high voltages off; -1 otherwise", -1, 2640, "%4.0f"}
+    };
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        if (CDFvarNum(id, gcrAttrs[i].name) >= 0)
+            addVariableAttributes(id, gcrAttrs[i]);
+    }
+
 }
 
 void addAttributesHR(CDFid id, const char *cdfFilename, const char *efiFilenames, size_t nFiles, const char *softwareVersion, const char satellite, const char *version, double minTime, double maxTime)
@@ -28,6 +28,15 @@
 #include <stdio.h>
 #include <ctype.h>
 
+extern char infoHeader[50];
+
+static Profile *variableProfile = NULL;
+
+void setVariableProfile(Profile *profile)
+{
+    variableProfile = profile;
+}
+
 
 CDFstatus createVarFrom1DVar(CDFid id, char *name, long dataType, long startIndex, long stopIndex, void *buffer, bool compressed)
 {
@@ -80,6 +89,8 @@ CDFstatus createVarFrom1DVar(CDFid id, char *name, long dataType, long startInde
     {
         printErrorMessage(status);
     }
+    else
+        profileVariable(variableProfile, name, stopIndex - startIndex + 1, (stopIndex - startIndex + 1) * dataTypeSize);
     return status;
 }
 
@@ -138,14 +149,16 @@ CDFstatus createVarFrom2DVar(CDFid id, char *name, long dataType, long startInde
     {
         printErrorMessage(status);
     }
+    else
+        profileVariable(variableProfile, name, nRecs, nRecs * dimSize * dataSize);
 
     return status;
 }
 
-CDFstatus createVarFromImage(CDFid id, char *name, long dataType, long startIndex, long stopIndex, void *imageBuffer, bool compressed)
+// Creates an image zVariable; its records are written by the caller
+static CDFstatus createImageVar(CDFid id, char *name, long dataType, bool compressed, long *dataSize)
 {
     CDFstatus status = CDF_OK;
-    long long nRecs = stopIndex - startIndex + 1;
     long dimSizes[2] = {0, 0};
     long recVary = {VARY};
     long dimVary[2] = {VARY, VARY};
@@ -179,20 +192,68 @@ CDFstatus createVarFromImage(CDFid id, char *name, long dataType, long startInde
         printErrorMessage(status);
         return status;
     }
-    long dataSize;
-    status = CDFgetDataTypeSize(dataType, &dataSize);
+    status = CDFgetDataTypeSize(dataType, dataSize);
     if (status != CDF_OK)
-    {
         printErrorMessage(status);
+
+    return status;
+}
+
+CDFstatus createVarFromImage(CDFid id, char *name, long dataType, long startIndex, long stopIndex, void *imageBuffer, bool compressed)
+{
+    long long nRecs = stopIndex - startIndex + 1;
+    long dataSize;
+    CDFstatus status = createImageVar(id, name, dataType, compressed, &dataSize);
+    if (status != CDF_OK)
         return status;
-    }
 
     status = CDFputVarRangeRecordsByVarName(id, name, startIndex, stopIndex-startIndex, imageBuffer);
     if (status != CDF_OK)
     {
         printErrorMessage(status);
     }
+    else
+        profileVariable(variableProfile, name, nRecs, nRecs * IMAGE_COLS * IMAGE_ROWS * dataSize);
 
     return status;
 }
 
+CDFstatus createVarFromImageStack(CDFid id, char *name, long dataType, ImageStack *stack, bool compressed)
+{
+    long dataSize;
+    CDFstatus status = createImageVar(id, name, dataType, compressed, &dataSize);
+    if (status != CDF_OK)
+        return status;
+
+    uint16_t *records = (uint16_t *) malloc(IMAGE_STACK_BLOCK_RECORDS * IMAGE_STACK_RECORD_PIXELS * sizeof(uint16_t));
+    if (records == NULL)
+    {
+        fprintf(stdout, "%sOut of memory trying to export %s.\n", infoHeader, name);
+        return BAD_MALLOC;
+    }
+
+    long firstRecord = 0;
+    size_t nRecords = 0;
+    for (size_t b = 0; b < imageStackBlocks(stack); b++)
+    {
+        if (readImageBlock(stack, b, records, &nRecords) != IMAGE_STACK_OK)
+        {
+            fprintf(stdout, "%sCould not decompress %s block %zu.\n", infoHeader, name, b);
+            status = DECOMPRESSION_ERROR;
+            break;
+        }
+        status = CDFputVarRangeRecordsByVarName(id, name, firstRecord, firstRecord + (long) nRecords - 1, records);
+        if (status != CDF_OK)
+        {
+            printErrorMessage(status);
+            break;
+        }
+        firstRecord += (long) nRecords;
+    }
+    free(records);
+
+    if (status == CDF_OK)
+        profileVariable(variableProfile, name, stack->nRecords, stack->nRecords * IMAGE_COLS * IMAGE_ROWS * dataSize);
+
+    return status;
+}
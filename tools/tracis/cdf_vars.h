@@ -28,9 +28,17 @@
 
 #include <cdf.h>
 
+#include "profile.h"
+#include "image_stack.h"
+
+// Variables created afterwards are recorded in profile, if not NULL
+void setVariableProfile(Profile *profile);
+
 CDFstatus createVarFrom1DVar(CDFid id, char *name, long dataType, long startIndex, long stopIndex, void *buffer, bool compressed);
 CDFstatus createVarFrom2DVar(CDFid id, char *name, long dataType, long startIndex, long stopIndex, void *buffer1D, uint8_t dimSize, bool compressed);
 
 CDFstatus createVarFromImage(CDFid id, char *name, long dataType, long startIndex, long stopIndex, void *buffer, bool compressed);
+// Writes the stack a block at a time
+CDFstatus createVarFromImageStack(CDFid id, char *name, long dataType, ImageStack *stack, bool compressed);
 
 #endif // CDF_VARS_H
@@ -43,9 +43,10 @@
 
 extern char infoHeader[50];
 
-CDFstatus exportTracisCdfLR(const char *cdfFilename, const char satellite, const char *exportVersion, ImageStorage *store, size_t numberOfImagePairs, Ephemeres *ephem, char *efiFilenames, size_t nEfiFiles)
+CDFstatus exportTracisCdfLR(const char *cdfFilename, const char satellite, const char *exportVersion, ImageStorage *store, size_t numberOfImagePairs, Ephemeres *ephem, char *efiFilenames, size_t nEfiFiles, Profile *profile)
 {
 
+    profileStart(profile, PROFILE_CDF_LR);
     CDFid exportCdfId;
     CDFstatus status = CDF_OK;
     status = CDFcreateCDF((char *)cdfFilename, &exportCdfId);
@@ -54,16 +55,29 @@ CDFstatus exportTracisCdfLR(const char *cdfFilename, const char satellite, const
         printErrorMessage(status);
         return status;
     }
+    if (profile != NULL)
+        profile->product = PROFILE_LR;
+    setVariableProfile(profile);
 
     // export variables
     createVarFrom1DVar(exportCdfId, "Timestamp", CDF_EPOCH, 0, numberOfImagePairs-1, store->imageTimes, true);
     createVarFrom1DVar(exportCdfId, "Latitude", CDF_REAL8, 0, numberOfImagePairs-1, ephem->Latitude, true);
     createVarFrom1DVar(exportCdfId, "Longitude", CDF_REAL8, 0, numberOfImagePairs-1, ephem->Longitude, true);
     createVarFrom1DVar(exportCdfId, "Radius", CDF_REAL8, 0, numberOfImagePairs-1, ephem->Radius, true);
-    createVarFromImage(exportCdfId, "Raw_image_H", CDF_UINT2, 0, numberOfImagePairs-1, store->rawImagesH, true);
-    createVarFromImage(exportCdfId, "Raw_image_V", CDF_UINT2, 0, numberOfImagePairs-1, store->rawImagesV, true);
-    createVarFromImage(exportCdfId, "Processed_image_H", CDF_UINT2, 0, numberOfImagePairs-1, store->correctedImagesH, true);
-    createVarFromImage(exportCdfId, "Processed_image_V", CDF_UINT2, 0, numberOfImagePairs-1, store->correctedImagesV, true);
+    if (store->compressedImages)
+    {
+        createVarFromImageStack(exportCdfId, "Raw_image_H", CDF_UINT2, &store->rawStackH, true);
+        createVarFromImageStack(exportCdfId, "Raw_image_V", CDF_UINT2, &store->rawStackV, true);
+        createVarFromImageStack(exportCdfId, "Processed_image_H", CDF_UINT2, &store->correctedStackH, true);
+        createVarFromImageStack(exportCdfId, "Processed_image_V", CDF_UINT2, &store->correctedStackV, true);
+    }
+    else
+    {
+        createVarFromImage(exportCdfId, "Raw_image_H", CDF_UINT2, 0, numberOfImagePairs-1, store->rawImagesH, true);
+        createVarFromImage(exportCdfId, "Raw_image_V", CDF_UINT2, 0, numberOfImagePairs-1, store->rawImagesV, true);
+        createVarFromImage(exportCdfId, "Processed_image_H", CDF_UINT2, 0, numberOfImagePairs-1, store->correctedImagesH, true);
+        createVarFromImage(exportCdfId, "Processed_image_V", CDF_UINT2, 0, numberOfImagePairs-1, store->correctedImagesV, true);
+    }
 
     createVarFrom1DVar(exportCdfId, "Valid_imagery_H", CDF_UINT1, 0, numberOfImagePairs-1, store->validImageryH, true);
     createVarFrom1DVar(exportCdfId, "Valid_imagery_V", CDF_UINT1, 0, numberOfImagePairs-1, store->validImageryV, true);
@@ -108,13 +122,24 @@ CDFstatus exportTracisCdfLR(const char *cdfFilename, const char satellite, const
     createVarFrom2DVar(exportCdfId, "Energies_V", CDF_REAL4, 0, numberOfImagePairs-1, store->energiesV, ENERGY_BINS, true);
     createVarFrom2DVar(exportCdfId, "Angles_of_arrival", CDF_REAL4, 0, numberOfImagePairs-1, store->anglesOfArrival, ANGULAR_BINS, true);
 
+    if (store->gcrCountH != NULL && store->gcrCountV != NULL)
+    {
+        createVarFrom1DVar(exportCdfId, "GCR_count_H", CDF_INT2, 0, numberOfImagePairs-1, store->gcrCountH, true);
+        createVarFrom1DVar(exportCdfId, "GCR_count_V", CDF_INT2, 0, numberOfImagePairs-1, store->gcrCountV, true);
+    }
+
     double minTime = store->imageTimes[0];
     double maxTime = store->imageTimes[numberOfImagePairs-1];
 
     addAttributesLR(exportCdfId, cdfFilename, efiFilenames, nEfiFiles, SOFTWARE_VERSION_STRING " " SOFTWARE_VERSION, satellite, exportVersion, minTime, maxTime);
 
     closeCdf(exportCdfId);
+    setVariableProfile(NULL);
+    profileStop(profile, PROFILE_CDF_LR);
+    profileCdfFile(profile, PROFILE_LR, cdfFilename);
+    profileStart(profile, PROFILE_ARCHIVE);
     status = archiveFiles(cdfFilename);
+    profileStop(profile, PROFILE_ARCHIVE);
     if (status == EXPORT_OK)
         fprintf(stdout, "%sArchived %ld image records in CDF file in %s.ZIP\n", infoHeader, numberOfImagePairs, cdfFilename);
     else
@@ -126,9 +151,10 @@ CDFstatus exportTracisCdfLR(const char *cdfFilename, const char satellite, const
 
 }
 
-CDFstatus exportTracisCdfHR(const char *cdfFilename, const char satellite, const char *exportVersion, ImageStorage *store, size_t numberOfColumnSums, Ephemeres *ephem, char *efiFilenames, size_t nEfiFiles)
+CDFstatus exportTracisCdfHR(const char *cdfFilename, const char satellite, const char *exportVersion, ImageStorage *store, size_t numberOfColumnSums, Ephemeres *ephem, char *efiFilenames, size_t nEfiFiles, Profile *profile)
 {
 
+    profileStart(profile, PROFILE_CDF_HR);
     CDFid exportCdfId;
     CDFstatus status = CDF_OK;
     status = CDFcreateCDF((char *)cdfFilename, &exportCdfId);
@@ -137,6 +163,9 @@ CDFstatus exportTracisCdfHR(const char *cdfFilename, const char satellite, const
         printErrorMessage(status);
         return status;
     }
+    if (profile != NULL)
+        profile->product = PROFILE_HR;
+    setVariableProfile(profile);
 
     // export variables
     createVarFrom1DVar(exportCdfId, "Timestamp", CDF_EPOCH, 0, numberOfColumnSums-1, store->colSumTimes, true);
@@ -166,7 +195,12 @@ CDFstatus exportTracisCdfHR(const char *cdfFilename, const char satellite, const
     addAttributesHR(exportCdfId, cdfFilename, efiFilenames, nEfiFiles, SOFTWARE_VERSION_STRING " " SOFTWARE_VERSION, satellite, exportVersion, minTime, maxTime);
 
     closeCdf(exportCdfId);
+    setVariableProfile(NULL);
+    profileStop(profile, PROFILE_CDF_HR);
+    profileCdfFile(profile, PROFILE_HR, cdfFilename);
+    profileStart(profile, PROFILE_ARCHIVE);
     status = archiveFiles(cdfFilename);
+    profileStop(profile, PROFILE_ARCHIVE);
     if (status == EXPORT_OK)
         fprintf(stdout, "%sArchived %ld column sum records in CDF file in %s.ZIP\n", infoHeader, numberOfColumnSums, cdfFilename);
     else
@@ -178,7 +212,7 @@ CDFstatus exportTracisCdfHR(const char *cdfFilename, const char satellite, const
 
 }
 
-int exportProducts(char satellite, ImageStorage *store, size_t numberOfLRRecords, Ephemeres *imageEphem, char *tracisLRFilename, size_t numberOfHRRecords, Ephemeres *colSumEphem, char *tracisHRFilename, char *efiFilenames, size_t nEfiFiles, time_t processingStartTime)
+int exportProducts(char satellite, ImageStorage *store, size_t numberOfLRRecords, Ephemeres *imageEphem, char *tracisLRFilename, size_t numberOfHRRecords, Ephemeres *colSumEphem, char *tracisHRFilename, char *efiFilenames, size_t nEfiFiles, time_t processingStartTime, Profile *profile)
 {
     int status = EXPORT_OK;
 
@@ -193,7 +227,7 @@ int exportProducts(char satellite, ImageStorage *store, size_t numberOfLRRecords
     EPOCHtoUnixTime(&lastMeasurementTimeLR, &endLR, 1);
 
     // Write archived CDF files
-    status = exportTracisCdfLR(tracisLRFilename, satellite, EXPORT_VERSION_STRING, store, numberOfLRRecords, imageEphem, efiFilenames, nEfiFiles);
+    status = exportTracisCdfLR(tracisLRFilename, satellite, EXPORT_VERSION_STRING, store, numberOfLRRecords, imageEphem, efiFilenames, nEfiFiles, profile);
 
     if (status != EXPORT_OK)
     {
@@ -208,7 +242,7 @@ int exportProducts(char satellite, ImageStorage *store, size_t numberOfLRRecords
     EPOCHtoUnixTime(&firstMeasurementTimeHR, &startHR, 1);
     EPOCHtoUnixTime(&lastMeasurementTimeHR, &endHR, 1);
 
-    status = exportTracisCdfHR(tracisHRFilename, satellite, EXPORT_VERSION_STRING, store, numberOfHRRecords, colSumEphem, efiFilenames, nEfiFiles);
+    status = exportTracisCdfHR(tracisHRFilename, satellite, EXPORT_VERSION_STRING, store, numberOfHRRecords, colSumEphem, efiFilenames, nEfiFiles, profile);
 
     if (status != EXPORT_OK)
     {
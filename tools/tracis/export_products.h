@@ -25,6 +25,7 @@
 
 #include "utilities.h"
 #include "load_satellite_velocity.h"
+#include "profile.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -34,11 +35,11 @@
 
 #define UTC_DATE_LENGTH 24
 
-CDFstatus exportTracisCdfLR(const char *cdfFilename, const char satellite, const char *exportVersion, ImageStorage *store, size_t numberOfImagePairs, Ephemeres *ephem, char *efiFilenames, size_t nEfiFiles);
+CDFstatus exportTracisCdfLR(const char *cdfFilename, const char satellite, const char *exportVersion, ImageStorage *store, size_t numberOfImagePairs, Ephemeres *ephem, char *efiFilenames, size_t nEfiFiles, Profile *profile);
 
-CDFstatus exportTracisCdfHR(const char *cdfFilename, const char satellite, const char *exportVersion, ImageStorage *store, size_t numberOfColumnSums, Ephemeres *ephem, char *efiFilenames, size_t nEfiFiles);
+CDFstatus exportTracisCdfHR(const char *cdfFilename, const char satellite, const char *exportVersion, ImageStorage *store, size_t numberOfColumnSums, Ephemeres *ephem, char *efiFilenames, size_t nEfiFiles, Profile *profile);
 
-int exportProducts(char satellite, ImageStorage *store, size_t numberOfLRRecords, Ephemeres *imageEphem, char *tracisLRFilename, size_t numberOfHRRecords, Ephemeres *colSumEphem, char *tracisHRFilename, char *efiFilenames, size_t nEfiFiles, time_t processingStartTime);
+int exportProducts(char satellite, ImageStorage *store, size_t numberOfLRRecords, Ephemeres *imageEphem, char *tracisLRFilename, size_t numberOfHRRecords, Ephemeres *colSumEphem, char *tracisHRFilename, char *efiFilenames, size_t nEfiFiles, time_t processingStartTime, Profile *profile);
 
 int archiveFiles(const char *filenameBase);
 
@@ -0,0 +1,36 @@
+/*
+
+    TRACIS Processor: tools/tracis/gcr_detection.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "gcr_detection.h"
+
+#include "gcr_statistics.h"
+
+#include <stddef.h>
+
+bool gcrCandidateImage(bool gotImage, float biasVoltage, float mcpVoltage, float phosphorVoltage)
+{
+    return gotImage && biasVoltage > -1.0 && mcpVoltage > -20.0 && phosphorVoltage < 50.0;
+}
+
+int16_t countGcrPixels(const uint16_t *image)
+{
+    // At most GCR_IMAGE_PIXELS
+    return (int16_t)countImageGcrs(image, STATISTIC_MEAN, NULL);
+}
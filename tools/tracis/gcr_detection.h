@@ -0,0 +1,41 @@
+/*
+
+    TRACIS Processor: tools/tracis/gcr_detection.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Galactic cosmic ray hits counted in ready-state (high voltages off)
+// images while tracis has them in memory, with tiiGcrDetector's kernel
+// (common/gcr_statistics.c) and its default statistic: ROI pixels
+// more than GCR_SIGMAS standard deviations above the image mean.
+
+#ifndef _GCR_DETECTION_H
+#define _GCR_DETECTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Stored for images not taken with the high voltages off
+#define GCR_NOT_CANDIDATE -1
+
+// Whether an image was taken with the high voltages off
+bool gcrCandidateImage(bool gotImage, float biasVoltage, float mcpVoltage, float phosphorVoltage);
+
+// Number of hot pixels in a raw image
+int16_t countGcrPixels(const uint16_t *image);
+
+#endif // _GCR_DETECTION_H
@@ -21,6 +21,7 @@
 #include "image_analysis.h"
 
 #include "tracis_settings.h"
+#include "calibration_segment.h"
 
 #include <tii/isp.h>
 #include <tii/detector.h>
@@ -266,6 +267,86 @@ void angleOfArrivalSpectrum(uint16_t *image, float *angleOfArrivalMap, float *ra
 
 }
 
+void energySpectrumBinned(uint16_t *image, float *energyMap, const int8_t *energyBins, double *gainMap, float *energySpectrum, float *energies)
+{
+    float energy = 0.0;
+    float referenceSpectrum[ENERGY_BINS] = {0.0};
+    float meanEnergies[ENERGY_BINS] = {0.0};
+
+    int bin = 0;
+    bzero(energySpectrum, sizeof(float) * ENERGY_BINS);
+
+    float counts = 0.0;
+
+    for (int i = 0; i < IMAGE_COLS * IMAGE_ROWS; i++)
+    {
+        bin = energyBins[i];
+        energy = energyMap[i];
+        // Pixels with zero gain are cropped
+        if (bin == NO_BIN || energy == MISSING_ENERGY || (gainMap != NULL && !(gainMap[i] > 0.0)))
+            continue;
+
+        counts = (float)image[i];
+        energySpectrum[bin] += counts;
+        referenceSpectrum[bin] += 1.0;
+        meanEnergies[bin] += energy;
+    }
+
+    for (int i = 0; i < ENERGY_BINS; i++)
+    {
+        if (referenceSpectrum[i] > 0.0)
+        {
+            energySpectrum[i] /= referenceSpectrum[i];
+            meanEnergies[i] /= referenceSpectrum[i];
+        }
+    }
+
+    if (energies != NULL)
+    {
+        for (int i = 0; i < ENERGY_BINS; i++)
+            energies[i] = meanEnergies[i];
+    }
+
+    return;
+}
+
+void angleOfArrivalSpectrumBinned(uint16_t *image, const float *angleOfArrivalMap, const int8_t *angleOfArrivalBins, double *gainMap, float *angleOfArrivalSpectrum, float *anglesOfArrival)
+{
+    float referenceSpectrum[ANGULAR_BINS] = {0.0};
+    float meanAngle[ANGULAR_BINS] = {0.0};
+
+    int bin = 0;
+    bzero(angleOfArrivalSpectrum, sizeof(float) * ANGULAR_BINS);
+
+    for (int i = 0; i < IMAGE_COLS * IMAGE_ROWS; i++)
+    {
+        bin = angleOfArrivalBins[i];
+        if (bin == NO_BIN || (gainMap != NULL && !(gainMap[i] > 0.0)))
+            continue;
+
+        angleOfArrivalSpectrum[bin] += (float)image[i];
+        referenceSpectrum[bin] += 1.0;
+        meanAngle[bin] += angleOfArrivalMap[i];
+    }
+
+    for (int i = 0; i < ANGULAR_BINS; i++)
+    {
+        if (referenceSpectrum[i] > 0.0)
+        {
+            angleOfArrivalSpectrum[i] /= referenceSpectrum[i];
+            meanAngle[i] /= referenceSpectrum[i];
+        }
+    }
+
+    if (anglesOfArrival != NULL)
+    {
+        for (int i = 0; i < ANGULAR_BINS; i++)
+            anglesOfArrival[i] = meanAngle[i];
+    }
+
+    return;
+}
+
 int energyBin(float energy)
 {
     static float energyBinBoundaries[ENERGY_BINS+1] =  {0, 0.25, 0.32164, 0.41381, 0.532392, 0.684956, 0.881237, 1.13377, 1.45866, 1.87666, 2.41443, 3.10632, 3.99647, 5.1417, 6.61512, 8.51076, 10.9496, 14.0874, 18.1243, 23.318, 30.};
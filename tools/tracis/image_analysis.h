@@ -33,6 +33,12 @@ void energySpectrum(uint16_t *image, float *energyMap, float *radiusMap, double
 
 void angleOfArrivalSpectrum(uint16_t *image, float *angleOfArrivalMap, float *radiusMap, double *gainMap, float *angleOfArrivalSpectrum, float *anglesOfArrival);
 
+// Same results as energySpectrum() and angleOfArrivalSpectrum(), with the
+// per-pixel bins precomputed by fillSensorCalibration()
+void energySpectrumBinned(uint16_t *image, float *energyMap, const int8_t *energyBins, double *gainMap, float *energySpectrum, float *energies);
+
+void angleOfArrivalSpectrumBinned(uint16_t *image, const float *angleOfArrivalMap, const int8_t *angleOfArrivalBins, double *gainMap, float *angleOfArrivalSpectrum, float *anglesOfArrival);
+
 int energyBin(float energy);
 
 
@@ -0,0 +1,167 @@
+/*
+
+    TRACIS Processor: tools/tracis/image_stack.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "image_stack.h"
+
+#include "memory_accounting.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#define BLOCK_PIXELS (IMAGE_STACK_BLOCK_RECORDS * IMAGE_STACK_RECORD_PIXELS)
+#define BLOCK_BYTES (BLOCK_PIXELS * sizeof(uint16_t))
+
+int initImageStack(ImageStack *stack)
+{
+    memset(stack, 0, sizeof(ImageStack));
+    stack->pending = (uint16_t *) malloc(BLOCK_BYTES);
+    // zlib needs a little more than the block in the worst case
+    stack->scratch = (uint8_t *) malloc(compressBound(BLOCK_BYTES));
+    if (stack->pending == NULL || stack->scratch == NULL)
+    {
+        freeImageStack(stack);
+        return IMAGE_STACK_MEMORY;
+    }
+    memoryAllocated(MEMORY_IMAGE_STACKS, BLOCK_BYTES + compressBound(BLOCK_BYTES));
+
+    return IMAGE_STACK_OK;
+}
+
+void freeImageStack(ImageStack *stack)
+{
+    for (size_t b = 0; b < stack->nBlocks; b++)
+        free(stack->blocks[b].data);
+    free(stack->blocks);
+    memoryReleased(MEMORY_IMAGE_STACKS, stack->compressedBytes);
+    if (stack->pending != NULL && stack->scratch != NULL)
+        memoryReleased(MEMORY_IMAGE_STACKS, BLOCK_BYTES + compressBound(BLOCK_BYTES));
+    free(stack->pending);
+    free(stack->scratch);
+    memset(stack, 0, sizeof(ImageStack));
+
+    return;
+}
+
+// Differences along each image, then low bytes of the whole block followed by high bytes
+static void encodeBlock(const uint16_t *pixels, uint8_t *shuffled)
+{
+    uint16_t previous = 0;
+    uint16_t delta = 0;
+    for (size_t i = 0; i < BLOCK_PIXELS; i++)
+    {
+        if (i % IMAGE_STACK_RECORD_PIXELS == 0)
+            previous = 0;
+        delta = (uint16_t)(pixels[i] - previous);
+        previous = pixels[i];
+        shuffled[i] = (uint8_t)(delta & 0xff);
+        shuffled[BLOCK_PIXELS + i] = (uint8_t)(delta >> 8);
+    }
+
+    return;
+}
+
+static void decodeBlock(const uint8_t *shuffled, size_t nPixels, uint16_t *pixels)
+{
+    uint16_t previous = 0;
+    for (size_t i = 0; i < nPixels; i++)
+    {
+        if (i % IMAGE_STACK_RECORD_PIXELS == 0)
+            previous = 0;
+        previous = (uint16_t)(previous + (shuffled[i] | (shuffled[BLOCK_PIXELS + i] << 8)));
+        pixels[i] = previous;
+    }
+
+    return;
+}
+
+static int compressPending(ImageStack *stack)
+{
+    if (stack->nBlocks == stack->blockCapacity)
+    {
+        size_t capacity = stack->blockCapacity == 0 ? 64 : 2 * stack->blockCapacity;
+        ImageStackBlock *blocks = (ImageStackBlock *) realloc(stack->blocks, capacity * sizeof(ImageStackBlock));
+        if (blocks == NULL)
+            return IMAGE_STACK_MEMORY;
+        stack->blocks = blocks;
+        stack->blockCapacity = capacity;
+    }
+
+    // Compress into a worst-case buffer, then shrink it to fit
+    encodeBlock(stack->pending, stack->scratch);
+    uLongf bytes = compressBound(BLOCK_BYTES);
+    uint8_t *compressed = (uint8_t *) malloc(bytes);
+    if (compressed == NULL)
+        return IMAGE_STACK_MEMORY;
+    if (compress2(compressed, &bytes, stack->scratch, BLOCK_BYTES, 1) != Z_OK)
+    {
+        free(compressed);
+        return IMAGE_STACK_ZLIB;
+    }
+    uint8_t *shrunk = (uint8_t *) realloc(compressed, bytes);
+    if (shrunk != NULL)
+        compressed = shrunk;
+
+    stack->blocks[stack->nBlocks].data = compressed;
+    stack->blocks[stack->nBlocks].bytes = bytes;
+    stack->nBlocks++;
+    stack->compressedBytes += bytes;
+    memoryAllocated(MEMORY_IMAGE_STACKS, bytes);
+    stack->nPending = 0;
+
+    return IMAGE_STACK_OK;
+}
+
+int appendImageRecord(ImageStack *stack, const uint16_t *pixels)
+{
+    memcpy(stack->pending + stack->nPending * IMAGE_STACK_RECORD_PIXELS, pixels, IMAGE_STACK_RECORD_PIXELS * sizeof(uint16_t));
+    stack->nPending++;
+    stack->nRecords++;
+    if (stack->nPending == IMAGE_STACK_BLOCK_RECORDS)
+        return compressPending(stack);
+
+    return IMAGE_STACK_OK;
+}
+
+size_t imageStackBlocks(const ImageStack *stack)
+{
+    return stack->nBlocks + (stack->nPending > 0 ? 1 : 0);
+}
+
+int readImageBlock(ImageStack *stack, size_t block, uint16_t *records, size_t *nRecords)
+{
+    if (block == stack->nBlocks && stack->nPending > 0)
+    {
+        memcpy(records, stack->pending, stack->nPending * IMAGE_STACK_RECORD_PIXELS * sizeof(uint16_t));
+        *nRecords = stack->nPending;
+        return IMAGE_STACK_OK;
+    }
+    if (block >= stack->nBlocks)
+        return IMAGE_STACK_BLOCK;
+
+    uLongf bytes = BLOCK_BYTES;
+    if (uncompress(stack->scratch, &bytes, stack->blocks[block].data, stack->blocks[block].bytes) != Z_OK || bytes != BLOCK_BYTES)
+        return IMAGE_STACK_ZLIB;
+    decodeBlock(stack->scratch, BLOCK_PIXELS, records);
+    *nRecords = IMAGE_STACK_BLOCK_RECORDS;
+
+    return IMAGE_STACK_OK;
+}
@@ -0,0 +1,75 @@
+/*
+
+    TRACIS Processor: tools/tracis/image_stack.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// A day of images held compressed in memory. Records are appended to a block
+// buffer; each full block of IMAGE_STACK_BLOCK_RECORDS images is delta coded
+// along each image, byte-shuffled so that the mostly zero high bytes are
+// contiguous, and compressed with zlib at level 1. The last, partly filled
+// block stays uncompressed.
+
+#ifndef _IMAGE_STACK_H
+#define _IMAGE_STACK_H
+
+#include "tracis_settings.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define IMAGE_STACK_BLOCK_RECORDS 64
+#define IMAGE_STACK_RECORD_PIXELS (IMAGE_ROWS * IMAGE_COLS)
+
+enum IMAGE_STACK_ERRORS {
+    IMAGE_STACK_OK = 0,
+    IMAGE_STACK_MEMORY = -1,
+    IMAGE_STACK_ZLIB = -2,
+    IMAGE_STACK_BLOCK = -3
+};
+
+typedef struct ImageStackBlock
+{
+    uint8_t *data;
+    size_t bytes;
+} ImageStackBlock;
+
+typedef struct ImageStack
+{
+    size_t nRecords;
+    ImageStackBlock *blocks; // compressed
+    size_t nBlocks;
+    size_t blockCapacity;
+    uint16_t *pending; // records not yet compressed
+    size_t nPending;
+    uint8_t *scratch; // for coding a block
+    size_t compressedBytes;
+} ImageStack;
+
+int initImageStack(ImageStack *stack);
+void freeImageStack(ImageStack *stack);
+
+// pixels holds IMAGE_STACK_RECORD_PIXELS values
+int appendImageRecord(ImageStack *stack, const uint16_t *pixels);
+
+// Including the partly filled block
+size_t imageStackBlocks(const ImageStack *stack);
+
+// Decodes a block into records, which holds IMAGE_STACK_BLOCK_RECORDS images
+int readImageBlock(ImageStack *stack, size_t block, uint16_t *records, size_t *nRecords);
+
+#endif // _IMAGE_STACK_H
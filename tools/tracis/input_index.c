@@ -0,0 +1,179 @@
+/*
+
+    TRACIS Processor: tools/tracis/input_index.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "input_index.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fts.h>
+#include <sys/stat.h>
+
+void initInputIndex(InputIndex *index)
+{
+    index->dir[0] = '\0';
+    index->entries = NULL;
+    index->nEntries = 0;
+    index->capacity = 0;
+    index->dirs = NULL;
+    index->nDirs = 0;
+    index->dirCapacity = 0;
+}
+
+void freeInputIndex(InputIndex *index)
+{
+    for (size_t i = 0; i < index->nEntries; i++)
+        free(index->entries[i].path);
+    free(index->entries);
+    for (size_t i = 0; i < index->nDirs; i++)
+        free(index->dirs[i].path);
+    free(index->dirs);
+    initInputIndex(index);
+}
+
+static int addEntry(InputIndex *index, const char *name, const char *path)
+{
+    if (index->nEntries == index->capacity)
+    {
+        size_t capacity = index->capacity == 0 ? 256 : 2 * index->capacity;
+        InputIndexEntry *entries = (InputIndexEntry *) realloc(index->entries, capacity * sizeof(InputIndexEntry));
+        if (entries == NULL)
+            return UTIL_ERR_MEMORY;
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+
+    InputIndexEntry *e = &index->entries[index->nEntries];
+    char field[5] = {0};
+    e->satellite = name[11];
+    memcpy(e->dataset, name + 13, 5);
+    e->dataset[5] = '\0';
+    memcpy(field, name + 19, 4);
+    e->year = atoi(field);
+    memset(field, 0, sizeof(field));
+    memcpy(field, name + 23, 2);
+    e->month = atoi(field);
+    memcpy(field, name + 25, 2);
+    e->day = atoi(field);
+    memcpy(field, name + 51, 4);
+    e->version = atol(field);
+    e->path = strdup(path);
+    if (e->path == NULL)
+        return UTIL_ERR_MEMORY;
+    index->nEntries++;
+
+    return UTIL_NO_ERROR;
+}
+
+static int addDir(InputIndex *index, const char *path, const struct stat *s)
+{
+    if (index->nDirs == index->dirCapacity)
+    {
+        size_t capacity = index->dirCapacity == 0 ? 16 : 2 * index->dirCapacity;
+        InputIndexDir *dirs = (InputIndexDir *) realloc(index->dirs, capacity * sizeof(InputIndexDir));
+        if (dirs == NULL)
+            return UTIL_ERR_MEMORY;
+        index->dirs = dirs;
+        index->dirCapacity = capacity;
+    }
+
+    InputIndexDir *d = &index->dirs[index->nDirs];
+    d->path = strdup(path);
+    if (d->path == NULL)
+        return UTIL_ERR_MEMORY;
+    d->modificationTime = s->st_mtim;
+    index->nDirs++;
+
+    return UTIL_NO_ERROR;
+}
+
+int buildInputIndex(InputIndex *index, const char *dir)
+{
+    freeInputIndex(index);
+
+    char *searchPath[2] = {NULL, NULL};
+    searchPath[0] = (char *)dir;
+
+    FTS * fts = fts_open(searchPath, FTS_PHYSICAL | FTS_NOCHDIR, NULL);
+    if (fts == NULL)
+    {
+        printf("Could not open directory %s for reading.", dir);
+        return UTIL_ERR_HM_FILENAME;
+    }
+
+    int status = UTIL_NO_ERROR;
+    FTSENT * f = fts_read(fts);
+    while(f != NULL && status == UTIL_NO_ERROR)
+    {
+        // Most Swarm CDF file names have a length of 59 characters. The MDR_MAG_LR files have a lend of 70 characters.
+        // The MDR_MAG_LR files have the same filename structure up to character 55.
+        size_t len = strlen(f->fts_name);
+        // Directories are recorded on the way in, before their entries are read
+        if (f->fts_info == FTS_D)
+            status = addDir(index, f->fts_path, f->fts_statp);
+        else if (len == 59 || len == 70)
+            status = addEntry(index, f->fts_name, f->fts_path);
+        f = fts_read(fts);
+    }
+
+    fts_close(fts);
+
+    snprintf(index->dir, FILENAME_MAX, "%s", dir);
+
+    return status;
+}
+
+int refreshInputIndex(InputIndex *index, const char *dir)
+{
+    if (strcmp(index->dir, dir) != 0 || index->nDirs == 0)
+        return buildInputIndex(index, dir);
+
+    // A file added to or removed from a subdirectory only changes that subdirectory;
+    // a new or removed subdirectory changes its parent
+    struct stat s;
+    for (size_t i = 0; i < index->nDirs; i++)
+    {
+        InputIndexDir *d = &index->dirs[i];
+        if (stat(d->path, &s) != 0 || s.st_mtim.tv_sec != d->modificationTime.tv_sec || s.st_mtim.tv_nsec != d->modificationTime.tv_nsec)
+            return buildInputIndex(index, dir);
+    }
+
+    return UTIL_NO_ERROR;
+}
+
+int findInputFilename(InputIndex *index, const char satelliteLetter, long year, long month, long day, const char *dataset, char *filename)
+{
+    bool gotFile = false;
+    long lastVersion = -1;
+    for (size_t i = 0; i < index->nEntries; i++)
+    {
+        InputIndexEntry *e = &index->entries[i];
+        if (e->satellite == satelliteLetter && strncmp(e->dataset, dataset, 5) == 0 && e->year == year && e->month == month && e->day == day && e->version > lastVersion)
+        {
+            lastVersion = e->version;
+            sprintf(filename, "%s", e->path);
+            gotFile = true;
+        }
+    }
+
+    return gotFile ? UTIL_NO_ERROR : UTIL_ERR_HM_FILENAME;
+}
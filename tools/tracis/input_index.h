@@ -0,0 +1,71 @@
+/*
+
+    TRACIS Processor: tools/tracis/input_index.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _INPUT_INDEX_H
+#define _INPUT_INDEX_H
+
+#include <stdio.h>
+#include <time.h>
+
+// Swarm-named files found under a directory tree, so that repeated
+// lookups do not walk the tree each time
+typedef struct InputIndexEntry
+{
+    char satellite;
+    char dataset[6];
+    int year;
+    int month;
+    int day;
+    long version;
+    char *path;
+} InputIndexEntry;
+
+// A directory walked when the index was built, so that files added anywhere in the tree are noticed
+typedef struct InputIndexDir
+{
+    char *path;
+    struct timespec modificationTime;
+} InputIndexDir;
+
+typedef struct InputIndex
+{
+    char dir[FILENAME_MAX];
+    InputIndexEntry *entries;
+    size_t nEntries;
+    size_t capacity;
+    InputIndexDir *dirs;
+    size_t nDirs;
+    size_t dirCapacity;
+} InputIndex;
+
+void initInputIndex(InputIndex *index);
+
+// Walks the directory tree once and records every Swarm-named file
+int buildInputIndex(InputIndex *index, const char *dir);
+
+// Rebuilds the index if it is for another directory or any directory in the tree has changed
+int refreshInputIndex(InputIndex *index, const char *dir);
+
+// Same result as getInputFilename(): the highest version for the satellite, date and dataset
+int findInputFilename(InputIndex *index, const char satelliteLetter, long year, long month, long day, const char *dataset, char *filename);
+
+void freeInputIndex(InputIndex *index);
+
+#endif // _INPUT_INDEX_H
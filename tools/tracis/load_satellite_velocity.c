@@ -24,6 +24,7 @@
 
 #include "tracis_settings.h"
 #include "utilities.h"
+#include "memory_accounting.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -60,12 +61,14 @@ void freeEphemeres(Ephemeres *ephem)
     free(ephem->Latitude);
     free(ephem->Longitude);
     free(ephem->Radius);
+    memoryReleased(MEMORY_EPHEMERES, ephem->nEphem * EPHEMERES_ARRAYS * sizeof(double));
     ephem->nEphem = 0;
 }
 
 int allocEphemeres(Ephemeres *ephem, size_t nEphem)
 {
     ephem->nEphem = ephem->nEphem + nEphem;
+    memoryAllocated(MEMORY_EPHEMERES, nEphem * EPHEMERES_ARRAYS * sizeof(double));
 
     ephem->time = (double*) realloc(ephem->time, (size_t) (ephem->nEphem * sizeof(double)));
     if (ephem->time == NULL)
@@ -102,6 +105,32 @@ int allocEphemeres(Ephemeres *ephem, size_t nEphem)
 
 }
 
+int appendEphemeres(Ephemeres *ephem, const Ephemeres *src)
+{
+    size_t offset = ephem->nEphem;
+    size_t n = src->nEphem;
+    if (n == 0)
+        return SAT_OK;
+
+    int status = allocEphemeres(ephem, n);
+    if (status != SAT_OK)
+        return status;
+
+    size_t bytes = n * sizeof(double);
+    memcpy(ephem->time + offset, src->time, bytes);
+    memcpy(ephem->X + offset, src->X, bytes);
+    memcpy(ephem->Y + offset, src->Y, bytes);
+    memcpy(ephem->Z + offset, src->Z, bytes);
+    memcpy(ephem->VN + offset, src->VN, bytes);
+    memcpy(ephem->VE + offset, src->VE, bytes);
+    memcpy(ephem->VC + offset, src->VC, bytes);
+    memcpy(ephem->Latitude + offset, src->Latitude, bytes);
+    memcpy(ephem->Longitude + offset, src->Longitude, bytes);
+    memcpy(ephem->Radius + offset, src->Radius, bytes);
+
+    return SAT_OK;
+}
+
 int loadEphemeres(const char *modFilename, Ephemeres *ephem)
 {
     int status = (int) SAT_ERROR_UNAVAILABLE;
@@ -35,6 +35,9 @@ enum SAT_POSVEL_ERRORS {
     SAT_ERROR_WRONG_NUMBER_OF_RECORDS_READ = -5
 };
 
+// Number of arrays in Ephemeres, each nEphem doubles
+#define EPHEMERES_ARRAYS 10
+
 typedef struct Ephemeres 
 {
     double *time;
@@ -53,6 +56,8 @@ typedef struct Ephemeres
 void initEphemeres(Ephemeres *ephem);
 int allocEphemeres(Ephemeres *ephem, size_t nEphem);
 void freeEphemeres(Ephemeres *ephem);
+// Appends copies of the records in src to ephem
+int appendEphemeres(Ephemeres *ephem, const Ephemeres *src);
 
 // Using long to be consistent with CDF epoch parsing in slidem.c
 int loadEphemeres(const char *modFilename, Ephemeres *ephem);
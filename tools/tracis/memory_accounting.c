@@ -0,0 +1,101 @@
+/*
+
+    TRACIS Processor: tools/tracis/memory_accounting.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "memory_accounting.h"
+
+#include <sys/resource.h>
+
+// Prefix for all fprintf messages
+extern char infoHeader[50];
+
+const char *memoryCategoryNames[MEMORY_CATEGORIES] = {
+    "image_stacks",
+    "maps",
+    "spectra",
+    "image_series",
+    "2hz_arrays",
+    "ephemeres",
+    "libtii_packets"
+};
+
+static size_t currentBytes[MEMORY_CATEGORIES];
+static size_t peakBytes[MEMORY_CATEGORIES];
+static size_t totalBytes = 0;
+static size_t totalPeakBytes = 0;
+
+void memoryAllocated(enum MemoryCategory category, size_t bytes)
+{
+    currentBytes[category] += bytes;
+    if (currentBytes[category] > peakBytes[category])
+        peakBytes[category] = currentBytes[category];
+    totalBytes += bytes;
+    if (totalBytes > totalPeakBytes)
+        totalPeakBytes = totalBytes;
+
+    return;
+}
+
+void memoryReleased(enum MemoryCategory category, size_t bytes)
+{
+    // Never below zero, in case an allocation failed partway
+    if (bytes > currentBytes[category])
+        bytes = currentBytes[category];
+    currentBytes[category] -= bytes;
+    totalBytes -= bytes;
+
+    return;
+}
+
+void resetMemoryPeaks(void)
+{
+    for (int c = 0; c < MEMORY_CATEGORIES; c++)
+        peakBytes[c] = currentBytes[c];
+    totalPeakBytes = totalBytes;
+
+    return;
+}
+
+void getMemoryReport(MemoryReport *report)
+{
+    for (int c = 0; c < MEMORY_CATEGORIES; c++)
+    {
+        report->current[c] = currentBytes[c];
+        report->peak[c] = peakBytes[c];
+    }
+    report->totalCurrent = totalBytes;
+    report->totalPeak = totalPeakBytes;
+
+    struct rusage usage;
+    report->peakRssKiB = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+
+    return;
+}
+
+void printMemoryReport(const MemoryReport *report, FILE *f)
+{
+    fprintf(f, "%sMemory:\n", infoHeader);
+    fprintf(f, "%s  %-14s %12s %12s\n", infoHeader, "category", "current (MB)", "peak (MB)");
+    for (int c = 0; c < MEMORY_CATEGORIES; c++)
+        fprintf(f, "%s  %-14s %12.1f %12.1f\n", infoHeader, memoryCategoryNames[c], report->current[c] / 1e6, report->peak[c] / 1e6);
+    fprintf(f, "%s  %-14s %12.1f %12.1f\n", infoHeader, "total", report->totalCurrent / 1e6, report->totalPeak / 1e6);
+    fprintf(f, "%s  peak RSS %.1f MB\n", infoHeader, report->peakRssKiB * 1024 / 1e6);
+
+    return;
+}
@@ -0,0 +1,64 @@
+/*
+
+    TRACIS Processor: tools/tracis/memory_accounting.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Byte counts for tracis's large allocations, by category, with the high-water
+// mark of each. The counts are for the whole process, so in worker mode they
+// include what the cache keeps between days. Arrays that libtii allocates are
+// counted from libtii's record counts.
+
+#ifndef _MEMORY_ACCOUNTING_H
+#define _MEMORY_ACCOUNTING_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+enum MemoryCategory
+{
+    MEMORY_IMAGE_STACKS = 0, // raw and gain-corrected images
+    MEMORY_MAPS, // energy and angle-of-arrival pixel maps
+    MEMORY_SPECTRA, // energy and angle-of-arrival spectra and their bins
+    MEMORY_IMAGE_SERIES, // per-image times, monitors, flags and GCR counts
+    MEMORY_2HZ, // column sums and voltage settings
+    MEMORY_EPHEMERES,
+    MEMORY_PACKETS, // libtii image packets and 2 Hz time series
+    MEMORY_CATEGORIES
+};
+
+typedef struct MemoryReport
+{
+    size_t current[MEMORY_CATEGORIES];
+    size_t peak[MEMORY_CATEGORIES];
+    size_t totalCurrent;
+    size_t totalPeak; // largest simultaneous total, not the sum of the peaks
+    long peakRssKiB; // for the life of the process
+} MemoryReport;
+
+extern const char *memoryCategoryNames[MEMORY_CATEGORIES];
+
+void memoryAllocated(enum MemoryCategory category, size_t bytes);
+void memoryReleased(enum MemoryCategory category, size_t bytes);
+
+// Restarts the high-water marks from the current counts, e.g. at the start of a day
+void resetMemoryPeaks(void);
+
+void getMemoryReport(MemoryReport *report);
+void printMemoryReport(const MemoryReport *report, FILE *f);
+
+#endif // _MEMORY_ACCOUNTING_H
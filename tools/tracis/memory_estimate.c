@@ -0,0 +1,175 @@
+/*
+
+    TRACIS Processor: tools/tracis/memory_estimate.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "memory_estimate.h"
+
+#include "tracis_settings.h"
+#include "utilities.h"
+#include "load_satellite_velocity.h"
+
+#include <tii/tii.h>
+#include <tii/isp.h>
+#include <tii/timeseries.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Prefix for all fprintf messages
+extern char infoHeader[50];
+
+// TII images and 2 Hz science arrive at most twice a second
+#define SAMPLES_PER_SECOND 2
+
+size_t imagePacketBytes(size_t numberOfImages)
+{
+    return numberOfImages * (sizeof(FullImagePacket) + sizeof(FullImageContinuedPacket));
+}
+
+size_t timeSeriesBytes(size_t n2Hz)
+{
+    const LpTiiTimeSeries *t = NULL;
+    return n2Hz * (sizeof *t->lpTiiTime2Hz + COLUMN_SUM_ENERGY_BINS * (sizeof *t->columnSumH + sizeof *t->columnSumV) + sizeof *t->biasGridVoltageSettingH + sizeof *t->biasGridVoltageSettingV + sizeof *t->mcpVoltageSettingH + sizeof *t->mcpVoltageSettingV + sizeof *t->phosphorVoltageSettingH + sizeof *t->phosphorVoltageSettingV);
+}
+
+// yyyymmddThhmmss, or yyyymmdd for midnight
+static bool parseTime(const char *s, bool withTime, time_t *t)
+{
+    struct tm tm = {0};
+    int n = sscanf(s, "%4d%2d%2dT%2d%2d%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    if (n != (withTime ? 6 : 3))
+        return false;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    *t = timegm(&tm);
+
+    return true;
+}
+
+// Number of records from the header of an SP3 MOD file, 0 if unavailable
+static size_t modRecords(char satellite, int year, int month, int day, const char *modDir)
+{
+    char filename[FILENAME_MAX];
+    if (getInputFilename(satellite, year, month, day, modDir, "SC_1B", filename))
+        return 0;
+
+    FILE *f = fopen(filename, "r");
+    if (f == NULL)
+        return 0;
+    char buf[100] = {0};
+    long epochs = 0;
+    if (fgets(buf, sizeof buf, f) == NULL || sscanf(buf + 3, "%*d %*d %*d %*d %*d %*f %ld", &epochs) != 1 || epochs < 0)
+        epochs = 0;
+    fclose(f);
+
+    return (size_t) epochs;
+}
+
+int estimateDayMemory(const char *satDate, const char *l0Dir, const char *modDir, bool gcrDetection, MemoryEstimate *estimate)
+{
+    memset(estimate, 0, sizeof(MemoryEstimate));
+
+    char satellite = satDate[0];
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    time_t dayStart = 0;
+    if (sscanf(satDate + 1, "%4d%2d%2d", &year, &month, &day) != 3 || !parseTime(satDate + 1, false, &dayStart))
+        return MEMORY_ESTIMATE_DATE;
+    time_t dayEnd = dayStart + 86400;
+
+    // L0 files are named SW_OPER_EFIX_0_..._yyyymmddThhmmss_yyyymmddThhmmss_vvvv.
+    // libtii loads the whole of each file that overlaps the day.
+    DIR *dir = opendir(l0Dir);
+    if (dir == NULL)
+        return MEMORY_ESTIMATE_L0_DIR;
+
+    char path[FILENAME_MAX];
+    struct stat st;
+    struct dirent *entry = NULL;
+    time_t first = 0;
+    time_t last = 0;
+    double dayBytes = 0.0;
+    double l0Seconds = 0.0;
+    double coveredSeconds = 0.0;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        const char *name = entry->d_name;
+        if (strlen(name) < 51 || strncmp(name + 8, "EFI", 3) != 0 || name[11] != satellite || strncmp(name + 12, "_0", 2) != 0)
+            continue;
+        if (!parseTime(name + 19, true, &first) || !parseTime(name + 35, true, &last) || last < first)
+            continue;
+        last++; // stop time is inclusive
+        if (last <= dayStart || first >= dayEnd)
+            continue;
+        snprintf(path, FILENAME_MAX, "%s/%s", l0Dir, name);
+        if (stat(path, &st) != 0)
+            continue;
+
+        double overlap = (double)((last < dayEnd ? last : dayEnd) - (first > dayStart ? first : dayStart));
+        estimate->l0Files++;
+        estimate->l0Bytes += (size_t) st.st_size;
+        dayBytes += (double) st.st_size * overlap / (double)(last - first);
+        l0Seconds += (double)(last - first);
+        coveredSeconds += overlap;
+    }
+    closedir(dir);
+    if (coveredSeconds > 86400.0)
+        coveredSeconds = 86400.0;
+
+    // Two images per pair, each a full and a continued packet
+    size_t maxSamples = (size_t)(SAMPLES_PER_SECOND * coveredSeconds);
+    estimate->imagePairs = (size_t)(dayBytes / (double) imagePacketBytes(2));
+    if (estimate->imagePairs > maxSamples)
+        estimate->imagePairs = maxSamples;
+    estimate->columnSums = maxSamples;
+
+    int yearPrev = year;
+    int monthPrev = month;
+    int dayPrev = day;
+    dateAdjust(&yearPrev, &monthPrev, &dayPrev, -1);
+    estimate->modRecords = modRecords(satellite, year, month, day, modDir) + modRecords(satellite, yearPrev, monthPrev, dayPrev, modDir);
+
+    imageStorageBytes(estimate->imagePairs, estimate->columnSums, gcrDetection, estimate->bytes);
+    // The cache keeps its own copy of the MOD records
+    estimate->bytes[MEMORY_EPHEMERES] = (2 * estimate->modRecords + estimate->imagePairs + estimate->columnSums) * EPHEMERES_ARRAYS * sizeof(double);
+    size_t imagesLoaded = estimate->l0Bytes / imagePacketBytes(1);
+    estimate->bytes[MEMORY_PACKETS] = imagePacketBytes(imagesLoaded) + timeSeriesBytes((size_t)(SAMPLES_PER_SECOND * l0Seconds));
+
+    // Everything is held until the products are exported
+    for (int c = 0; c < MEMORY_CATEGORIES; c++)
+        estimate->total += estimate->bytes[c];
+
+    return MEMORY_ESTIMATE_OK;
+}
+
+void printMemoryEstimate(const MemoryEstimate *estimate, FILE *f)
+{
+    fprintf(f, "%sMemory estimate:\n", infoHeader);
+    fprintf(f, "%s  %zu L0 files, %.1f MB; about %zu image pairs, %zu column sums, %zu MOD records\n", infoHeader, estimate->l0Files, estimate->l0Bytes / 1e6, estimate->imagePairs, estimate->columnSums, estimate->modRecords);
+    fprintf(f, "%s  %-14s %12s\n", infoHeader, "category", "peak (MB)");
+    for (int c = 0; c < MEMORY_CATEGORIES; c++)
+        fprintf(f, "%s  %-14s %12.1f\n", infoHeader, memoryCategoryNames[c], estimate->bytes[c] / 1e6);
+    fprintf(f, "%s  %-14s %12.1f\n", infoHeader, "total", estimate->total / 1e6);
+
+    return;
+}
@@ -0,0 +1,59 @@
+/*
+
+    TRACIS Processor: tools/tracis/memory_estimate.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Dry-run estimate of the memory that tracis accounts for on one day, from the
+// sizes of the L0 files and the MOD file headers, before anything is loaded.
+
+#ifndef _MEMORY_ESTIMATE_H
+#define _MEMORY_ESTIMATE_H
+
+#include "memory_accounting.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+enum MEMORY_ESTIMATE_ERRORS {
+    MEMORY_ESTIMATE_OK = 0,
+    MEMORY_ESTIMATE_DATE = -1,
+    MEMORY_ESTIMATE_L0_DIR = -2
+};
+
+typedef struct MemoryEstimate
+{
+    size_t l0Files; // L0 files overlapping the day
+    size_t l0Bytes;
+    size_t imagePairs; // at most one per half second of L0 coverage
+    size_t columnSums;
+    size_t modRecords; // this day and the day before
+    size_t bytes[MEMORY_CATEGORIES];
+    size_t total;
+} MemoryEstimate;
+
+// libtii allocates these itself; their sizes follow from its record counts
+size_t imagePacketBytes(size_t numberOfImages);
+size_t timeSeriesBytes(size_t n2Hz);
+
+// satDate is Xyyyymmdd; l0Dir holds the EFI L0 files as for a normal run
+int estimateDayMemory(const char *satDate, const char *l0Dir, const char *modDir, bool gcrDetection, MemoryEstimate *estimate);
+
+void printMemoryEstimate(const MemoryEstimate *estimate, FILE *f);
+
+#endif // _MEMORY_ESTIMATE_H
@@ -0,0 +1,106 @@
+/*
+
+    TRACIS Processor: tools/tracis/perf_counters.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "perf_counters.h"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+const char *perfCounterNames[PERF_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "cache_references",
+    "cache_misses",
+    "branches",
+    "branch_misses"
+};
+
+static const uint64_t perfCounterConfigs[PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_REFERENCES,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+void openPerfCounters(PerfCounters *counters)
+{
+    counters->available = false;
+    counters->error = 0;
+
+    struct perf_event_attr attr;
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        memset(&attr, 0, sizeof attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof attr;
+        attr.config = perfCounterConfigs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // Separate events rather than a group, so that one unsupported counter does not lose the others
+        counters->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (counters->fd[i] < 0)
+        {
+            if (counters->error == 0)
+                counters->error = errno;
+            counters->fd[i] = -1;
+            continue;
+        }
+        ioctl(counters->fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        counters->available = true;
+    }
+
+    return;
+}
+
+void closePerfCounters(PerfCounters *counters)
+{
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        if (counters->fd[i] >= 0)
+            close(counters->fd[i]);
+        counters->fd[i] = -1;
+    }
+    counters->available = false;
+
+    return;
+}
+
+void readPerfCounters(const PerfCounters *counters, uint64_t *values)
+{
+    // value, time enabled, time running
+    uint64_t data[3];
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        values[i] = 0;
+        if (counters->fd[i] < 0 || read(counters->fd[i], data, sizeof data) != sizeof data || data[2] == 0)
+            continue;
+        values[i] = data[2] < data[1] ? (uint64_t)((double)data[0] * (double)data[1] / (double)data[2]) : data[0];
+    }
+
+    return;
+}
@@ -0,0 +1,57 @@
+/*
+
+    TRACIS Processor: tools/tracis/perf_counters.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Hardware counters for this process, user space only, read with
+// perf_event_open(). Counters the kernel or a container does not allow
+// are left out; if none open, the profile reports them as unavailable.
+
+#ifndef _PERF_COUNTERS_H
+#define _PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum PerfCounter
+{
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_REFERENCES,
+    PERF_CACHE_MISSES,
+    PERF_BRANCHES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTERS
+};
+
+typedef struct PerfCounters
+{
+    int fd[PERF_COUNTERS]; // -1 if that counter is unavailable
+    bool available; // at least one counter opened
+    int error; // errno from the first counter that failed
+} PerfCounters;
+
+extern const char *perfCounterNames[PERF_COUNTERS];
+
+void openPerfCounters(PerfCounters *counters);
+void closePerfCounters(PerfCounters *counters);
+
+// Current counts, scaled for time lost to counter multiplexing. Unavailable counters read 0.
+void readPerfCounters(const PerfCounters *counters, uint64_t *values);
+
+#endif // _PERF_COUNTERS_H
@@ -0,0 +1,287 @@
+/*
+
+    TRACIS Processor: tools/tracis/profile.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "profile.h"
+
+#include "tracis.h"
+#include "tracis_settings.h"
+
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <sys/stat.h>
+
+extern char infoHeader[50];
+
+static const char *stageNames[PROFILE_STAGES] = {
+    "ephemeres",
+    "imagery",
+    "science",
+    "image_loop",
+    "column_sums",
+    "interpolation",
+    "cdf_lr",
+    "cdf_hr",
+    "archive"
+};
+
+static const char *productNames[PROFILE_PRODUCTS] = {"LR", "HR"};
+
+static double wallSeconds(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double cpuSeconds(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void initProfile(Profile *profile, bool enabled)
+{
+    memset(profile, 0, sizeof(Profile));
+    profile->enabled = enabled;
+    if (enabled)
+    {
+        profile->startWall = wallSeconds();
+        profile->startCpu = cpuSeconds();
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++)
+        profile->counters.fd[i] = -1;
+}
+
+bool enableProfileCounters(Profile *profile)
+{
+    if (!profile->enabled)
+        return false;
+
+    profile->perfCounters = true;
+    openPerfCounters(&profile->counters);
+
+    return profile->counters.available;
+}
+
+void freeProfile(Profile *profile)
+{
+    if (profile->perfCounters)
+        closePerfCounters(&profile->counters);
+}
+
+void setProfileTrace(Profile *profile, TraceLog *trace, const char *label)
+{
+    profile->trace = trace;
+    profile->traceLabel = label;
+}
+
+void profileStart(Profile *profile, int stage)
+{
+    if (profile == NULL || (!profile->enabled && profile->trace == NULL) || stage < 0 || stage >= PROFILE_STAGES)
+        return;
+
+    profile->stageStartWall[stage] = wallSeconds();
+    profile->stageStartCpu[stage] = cpuSeconds();
+    if (profile->counters.available)
+        readPerfCounters(&profile->counters, profile->stageStartCounts[stage]);
+}
+
+void profileStop(Profile *profile, int stage)
+{
+    if (profile == NULL || (!profile->enabled && profile->trace == NULL) || stage < 0 || stage >= PROFILE_STAGES)
+        return;
+
+    double end = wallSeconds();
+    profile->wallSeconds[stage] += end - profile->stageStartWall[stage];
+    profile->cpuSeconds[stage] += cpuSeconds() - profile->stageStartCpu[stage];
+    profile->calls[stage]++;
+    if (profile->counters.available)
+    {
+        uint64_t counts[PERF_COUNTERS];
+        readPerfCounters(&profile->counters, counts);
+        for (int i = 0; i < PERF_COUNTERS; i++)
+            profile->stageCounts[stage][i] += counts[i] - profile->stageStartCounts[stage][i];
+    }
+
+    if (profile->trace != NULL)
+    {
+        char args[128];
+        snprintf(args, sizeof args, "\"day\": \"%s\"", profile->traceLabel != NULL ? profile->traceLabel : "");
+        traceSpan(profile->trace, stageNames[stage], "stage", 0, profile->stageStartWall[stage] * 1e6, end * 1e6, args);
+    }
+}
+
+void profileVariable(Profile *profile, const char *name, long records, size_t bytes)
+{
+    if (profile == NULL || !profile->enabled || profile->nVariables >= PROFILE_MAX_VARIABLES)
+        return;
+
+    ProfileVariable *v = &profile->variables[profile->nVariables++];
+    v->product = profile->product;
+    snprintf(v->name, PROFILE_NAME_LENGTH, "%s", name);
+    v->records = records;
+    v->bytes = bytes;
+}
+
+void profileCdfFile(Profile *profile, int product, const char *filenameBase)
+{
+    if (profile == NULL || !profile->enabled || product < 0 || product >= PROFILE_PRODUCTS)
+        return;
+
+    char cdfFilename[FILENAME_MAX];
+    snprintf(cdfFilename, FILENAME_MAX, "%s.cdf", filenameBase);
+    struct stat s;
+    profile->cdfBytes[product] = stat(cdfFilename, &s) == 0 ? s.st_size : 0;
+}
+
+// NaN when the counters needed are missing
+static double counterRatio(const uint64_t *counts, int numerator, int denominator)
+{
+    if (counts[denominator] == 0)
+        return NAN;
+
+    return (double)counts[numerator] / (double)counts[denominator];
+}
+
+// JSON has no NaN
+static void writeJsonRatio(FILE *f, const char *name, double value, const char *suffix)
+{
+    if (isfinite(value))
+        fprintf(f, "\"%s\": %.4f%s", name, value, suffix);
+    else
+        fprintf(f, "\"%s\": null%s", name, suffix);
+}
+
+static size_t productVariableBytes(const Profile *profile, int product, int *nVariables)
+{
+    size_t bytes = 0;
+    *nVariables = 0;
+    for (int i = 0; i < profile->nVariables; i++)
+    {
+        if (profile->variables[i].product == product)
+        {
+            bytes += profile->variables[i].bytes;
+            (*nVariables)++;
+        }
+    }
+
+    return bytes;
+}
+
+void printProfile(const Profile *profile, FILE *f)
+{
+    if (!profile->enabled)
+        return;
+
+    fprintf(f, "%sProfile:\n", infoHeader);
+    fprintf(f, "%s  %-14s %6s %10s %10s\n", infoHeader, "stage", "calls", "wall (s)", "cpu (s)");
+    for (int s = 0; s < PROFILE_STAGES; s++)
+        fprintf(f, "%s  %-14s %6ld %10.3f %10.3f\n", infoHeader, stageNames[s], profile->calls[s], profile->wallSeconds[s], profile->cpuSeconds[s]);
+    fprintf(f, "%s  %-14s %6s %10.3f %10.3f\n", infoHeader, "total", "", wallSeconds() - profile->startWall, cpuSeconds() - profile->startCpu);
+    if (profile->counters.available)
+    {
+        fprintf(f, "%s  %-14s %8s %8s %8s %12s\n", infoHeader, "stage", "IPC", "cache %", "branch %", "instructions");
+        const uint64_t *counts = NULL;
+        for (int s = 0; s < PROFILE_STAGES; s++)
+        {
+            if (profile->calls[s] == 0)
+                continue;
+            counts = profile->stageCounts[s];
+            fprintf(f, "%s  %-14s %8.2f %8.2f %8.2f %12.4g\n", infoHeader, stageNames[s], counterRatio(counts, PERF_INSTRUCTIONS, PERF_CYCLES), 100.0 * counterRatio(counts, PERF_CACHE_MISSES, PERF_CACHE_REFERENCES), 100.0 * counterRatio(counts, PERF_BRANCH_MISSES, PERF_BRANCHES), (double)counts[PERF_INSTRUCTIONS]);
+        }
+    }
+    else if (profile->perfCounters)
+        fprintf(f, "%s  hardware counters unavailable: %s\n", infoHeader, strerror(profile->counters.error));
+    fprintf(f, "%s  %zu image packets, %zu image pairs, %zu image records, %zu column sums\n", infoHeader, profile->imagePackets, profile->imagePairs, profile->imageRecords, profile->columnSums);
+
+    int nVariables = 0;
+    size_t bytes = 0;
+    for (int p = 0; p < PROFILE_PRODUCTS; p++)
+    {
+        bytes = productVariableBytes(profile, p, &nVariables);
+        if (nVariables == 0)
+            continue;
+        fprintf(f, "%s  %s: %d variables, %.1f MB uncompressed, %.1f MB CDF, compression ratio %.2f\n", infoHeader, productNames[p], nVariables, bytes / 1e6, profile->cdfBytes[p] / 1e6, profile->cdfBytes[p] > 0 ? (double)bytes / (double)profile->cdfBytes[p] : 0.0);
+    }
+
+    return;
+}
+
+int writeProfile(const Profile *profile, const char *filename, const char *satDate, int status)
+{
+    if (!profile->enabled)
+        return 0;
+
+    FILE *f = fopen(filename, "w");
+    if (f == NULL)
+        return 1;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"profile_version\": %d,\n", PROFILE_VERSION);
+    fprintf(f, "  \"tracis_version\": \"%s\",\n", TRACIS_VERSION_STRING);
+    fprintf(f, "  \"export_version\": \"%s\",\n", EXPORT_VERSION_STRING);
+    fprintf(f, "  \"satellite_date\": \"%s\",\n", satDate);
+    fprintf(f, "  \"status\": %d,\n", status);
+    fprintf(f, "  \"wall_seconds\": %.6f,\n", wallSeconds() - profile->startWall);
+    fprintf(f, "  \"cpu_seconds\": %.6f,\n", cpuSeconds() - profile->startCpu);
+    fprintf(f, "  \"counters_available\": %s,\n", profile->counters.available ? "true" : "false");
+    fprintf(f, "  \"stages\": [\n");
+    for (int s = 0; s < PROFILE_STAGES; s++)
+    {
+        fprintf(f, "    {\"name\": \"%s\", \"calls\": %ld, \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f", stageNames[s], profile->calls[s], profile->wallSeconds[s], profile->cpuSeconds[s]);
+        if (profile->counters.available)
+        {
+            const uint64_t *counts = profile->stageCounts[s];
+            fprintf(f, ", \"counters\": {");
+            for (int i = 0; i < PERF_COUNTERS; i++)
+                fprintf(f, "\"%s\": %llu, ", perfCounterNames[i], (unsigned long long)counts[i]);
+            writeJsonRatio(f, "ipc", counterRatio(counts, PERF_INSTRUCTIONS, PERF_CYCLES), ", ");
+            writeJsonRatio(f, "cache_miss_rate", counterRatio(counts, PERF_CACHE_MISSES, PERF_CACHE_REFERENCES), ", ");
+            writeJsonRatio(f, "branch_miss_rate", counterRatio(counts, PERF_BRANCH_MISSES, PERF_BRANCHES), "}");
+        }
+        fprintf(f, "}%s\n", s < PROFILE_STAGES - 1 ? "," : "");
+    }
+    fprintf(f, "  ],\n");
+    fprintf(f, "  \"counts\": {\"image_packets\": %zu, \"image_pairs\": %zu, \"image_records\": %zu, \"column_sums\": %zu},\n", profile->imagePackets, profile->imagePairs, profile->imageRecords, profile->columnSums);
+    fprintf(f, "  \"products\": [\n");
+    int nVariables = 0;
+    size_t bytes = 0;
+    for (int p = 0; p < PROFILE_PRODUCTS; p++)
+    {
+        bytes = productVariableBytes(profile, p, &nVariables);
+        fprintf(f, "    {\"product\": \"%s\", \"variable_bytes\": %zu, \"cdf_bytes\": %lld, \"compression_ratio\": %.4f, \"variables\": [", productNames[p], bytes, (long long)profile->cdfBytes[p], profile->cdfBytes[p] > 0 ? (double)bytes / (double)profile->cdfBytes[p] : 0.0);
+        int n = 0;
+        for (int i = 0; i < profile->nVariables; i++)
+        {
+            const ProfileVariable *v = &profile->variables[i];
+            if (v->product != p)
+                continue;
+            fprintf(f, "%s\n      {\"name\": \"%s\", \"records\": %ld, \"bytes\": %zu}", n > 0 ? "," : "", v->name, v->records, v->bytes);
+            n++;
+        }
+        fprintf(f, "%s]}%s\n", n > 0 ? "\n    " : "", p < PROFILE_PRODUCTS - 1 ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    return fclose(f) == 0 ? 0 : 1;
+}
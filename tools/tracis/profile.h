@@ -0,0 +1,127 @@
+/*
+
+    TRACIS Processor: tools/tracis/profile.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Wall and CPU time of each processing stage of a tracis day, with record
+// and byte counts, for --profile. CPU time is that of tracis itself; the
+// zip child process is only seen in the archive stage's wall time.
+// Stages are also traced as spans if trace is set, and counted with
+// hardware performance counters if perfCounters is set.
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "trace_events.h"
+#include "perf_counters.h"
+
+#define PROFILE_VERSION 2
+#define PROFILE_MAX_VARIABLES 64
+#define PROFILE_NAME_LENGTH 64
+
+enum ProfileStage
+{
+    PROFILE_EPHEMERES = 0,
+    PROFILE_IMAGERY,
+    PROFILE_SCIENCE,
+    PROFILE_IMAGE_LOOP,
+    PROFILE_COLUMN_SUMS,
+    PROFILE_INTERPOLATION,
+    PROFILE_CDF_LR,
+    PROFILE_CDF_HR,
+    PROFILE_ARCHIVE,
+    PROFILE_STAGES
+};
+
+enum ProfileProduct
+{
+    PROFILE_LR = 0,
+    PROFILE_HR,
+    PROFILE_PRODUCTS
+};
+
+typedef struct ProfileVariable
+{
+    int product;
+    char name[PROFILE_NAME_LENGTH];
+    long records;
+    size_t bytes; // uncompressed
+} ProfileVariable;
+
+typedef struct Profile
+{
+    bool enabled;
+    TraceLog *trace;
+    const char *traceLabel; // satellite and date of the spans
+    double startWall;
+    double startCpu;
+    double stageStartWall[PROFILE_STAGES];
+    double stageStartCpu[PROFILE_STAGES];
+    double wallSeconds[PROFILE_STAGES];
+    double cpuSeconds[PROFILE_STAGES];
+    long calls[PROFILE_STAGES];
+
+    bool perfCounters;
+    PerfCounters counters;
+    uint64_t stageStartCounts[PROFILE_STAGES][PERF_COUNTERS];
+    uint64_t stageCounts[PROFILE_STAGES][PERF_COUNTERS];
+
+    size_t imagePackets;
+    size_t imagePairs;
+    size_t imageRecords;
+    size_t columnSums;
+
+    // Product that profileVariable() attributes variables to
+    int product;
+    ProfileVariable variables[PROFILE_MAX_VARIABLES];
+    int nVariables;
+    off_t cdfBytes[PROFILE_PRODUCTS];
+} Profile;
+
+void initProfile(Profile *profile, bool enabled);
+
+// Opens hardware counters for an enabled profile. Returns false if none are available,
+// in which case the profile continues without them.
+bool enableProfileCounters(Profile *profile);
+
+void freeProfile(Profile *profile);
+
+// Times stages for trace too, whether or not the profile is enabled
+void setProfileTrace(Profile *profile, TraceLog *trace, const char *label);
+
+void profileStart(Profile *profile, int stage);
+void profileStop(Profile *profile, int stage);
+
+// Records a CDF variable written for the current product. Does nothing if profile is NULL.
+void profileVariable(Profile *profile, const char *name, long records, size_t bytes);
+
+// Records the size of a product's CDF file (filenameBase.cdf) before it is archived
+void profileCdfFile(Profile *profile, int product, const char *filenameBase);
+
+void printProfile(const Profile *profile, FILE *f);
+
+// JSON version of printProfile() for tracking across versions
+int writeProfile(const Profile *profile, const char *filename, const char *satDate, int status);
+
+#endif // _PROFILE_H
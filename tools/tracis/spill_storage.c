@@ -0,0 +1,76 @@
+/*
+
+    TRACIS Processor: tools/tracis/spill_storage.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "spill_storage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+void *spillAlloc(const char *dir, size_t bytes)
+{
+    if (bytes == 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    char filename[FILENAME_MAX];
+    if (snprintf(filename, FILENAME_MAX, "%s/tracis_spill_XXXXXX", dir) >= FILENAME_MAX)
+    {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    int fd = mkstemp(filename);
+    if (fd < 0)
+        return NULL;
+    // The blocks are returned to the file system when the mapping goes away, even after a crash
+    unlink(filename);
+
+    void *p = NULL;
+    int error = posix_fallocate(fd, 0, (off_t) bytes);
+    if (error == 0)
+    {
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            error = errno;
+            p = NULL;
+        }
+        else
+            // Records are filled in order and exported in order
+            madvise(p, bytes, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    errno = error;
+
+    return p;
+}
+
+void spillFree(void *p, size_t bytes)
+{
+    if (p != NULL)
+        munmap(p, bytes);
+
+    return;
+}
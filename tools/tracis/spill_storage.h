@@ -0,0 +1,38 @@
+/*
+
+    TRACIS Processor: tools/tracis/spill_storage.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Large arrays backed by unlinked files in a scratch directory instead of
+// anonymous memory. Under memory pressure the kernel writes their pages back
+// to the file and drops them, rather than the process being killed.
+
+#ifndef _SPILL_STORAGE_H
+#define _SPILL_STORAGE_H
+
+#include <stddef.h>
+
+// Maps bytes of a new file in dir, reserving its disk blocks so that a full
+// disk fails here rather than with SIGBUS later. Access is advised to be
+// sequential. Returns NULL with errno set on failure.
+void *spillAlloc(const char *dir, size_t bytes);
+
+// p may be NULL
+void spillFree(void *p, size_t bytes);
+
+#endif // _SPILL_STORAGE_H
@@ -29,6 +29,11 @@
 #include "utilities.h"
 #include "export_products.h"
 #include "image_analysis.h"
+#include "tracis_cache.h"
+#include "gcr_detection.h"
+#include "profile.h"
+#include "memory_accounting.h"
+#include "memory_estimate.h"
 
 #include <tii/tii.h>
 
@@ -46,6 +51,8 @@
 #include <time.h>
 #include <math.h>
 #include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
 
 #include <cdf.h>
 
@@ -53,26 +60,106 @@ char infoHeader[50];
 
 int main(int argc, char **argv)
 {
+    TracisOptions options = {0};
+    char *traceFilename = NULL;
+    char *positionalArgs[3] = {NULL};
+    int nPositionalArgs = 0;
 
-    time_t processingStartTime = time(NULL);
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--worker") == 0)
+            options.worker = true;
+        else if (strcmp(argv[i], "--shared-calibration") == 0)
+            options.sharedCalibration = true;
+        else if (strcmp(argv[i], "--keep-shared-calibration") == 0)
+        {
+            options.sharedCalibration = true;
+            options.keepSharedCalibration = true;
+        }
+        else if (strcmp(argv[i], "--gcr-detection") == 0)
+            options.gcrDetection = true;
+        else if (strcmp(argv[i], "--profile") == 0)
+            options.profile = true;
+        else if (strcmp(argv[i], "--perf-counters") == 0)
+        {
+            options.profile = true;
+            options.perfCounters = true;
+        }
+        else if (strcmp(argv[i], "--memory-report") == 0)
+            options.memoryReport = true;
+        else if (strcmp(argv[i], "--estimate-memory") == 0)
+            options.estimateMemory = true;
+        else if (strcmp(argv[i], "--compress-images") == 0)
+            options.compressImages = true;
+        else if (strcmp(argv[i], "--spill-dir") == 0 && i + 1 < argc)
+            options.spillDir = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            traceFilename = argv[++i];
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            printf("Unrecognized option %s\n", argv[i]);
+            usage(argv[0]);
+            exit(1);
+        }
+        else
+        {
+            if (nPositionalArgs < 3)
+                positionalArgs[nPositionalArgs] = argv[i];
+            nPositionalArgs++;
+        }
+    }
 
-    if (argc != 4)
+    // Checked before the calibration segment can be created
+    if (options.worker ? nPositionalArgs != 0 : (nPositionalArgs != 3 || strlen(positionalArgs[0]) != 9))
     {
         usage(argv[0]);
         exit(1);
     }
 
-    char * satDate = argv[1];
-    size_t sourceLen = strlen(satDate);
-
-    if (sourceLen != 9)
+    TracisCache *cache = (TracisCache *) malloc(sizeof(TracisCache));
+    if (cache == NULL)
     {
-        usage(argv[0]);
-	    exit(1);
+        printf("Out of memory trying to set up TRACIS cache.\n");
+        exit(1);
+    }
+    initTracisCache(cache);
+    // Computing the tables locally gives the same results if the segment is unavailable
+    bool createdCalibrationSegment = false;
+    if (options.sharedCalibration && attachCalibrationSegment(CALIBRATION_SEGMENT_NAME, &cache->sharedCalibration, &createdCalibrationSegment) != CALIBRATION_SEGMENT_OK)
+        fprintf(stderr, "Shared calibration segment %s unavailable; computing calibration tables locally.\n", CALIBRATION_SEGMENT_NAME);
+
+    TraceLog traceLog = {0};
+    if (traceFilename != NULL)
+    {
+        if (openTraceLog(&traceLog, traceFilename) == TRACE_OK)
+        {
+            options.trace = &traceLog;
+            traceProcessName(options.trace, options.worker ? "tracis worker" : "tracis");
+        }
+        else
+            fprintf(stderr, "Could not open trace file %s; not tracing.\n", traceFilename);
     }
 
-    char *modDir = argv[2];
-    char *outputDir = argv[3];
+    int status = 0;
+    if (options.worker)
+        status = runWorker(&options, cache);
+    else
+        status = processDay(positionalArgs[0], positionalArgs[1], positionalArgs[2], &options, cache);
+
+    freeTracisCache(cache);
+    free(cache);
+    // Processes that still have the segment mapped keep their mapping
+    if (createdCalibrationSegment && !options.keepSharedCalibration)
+        shm_unlink(CALIBRATION_SEGMENT_NAME);
+    if (options.trace != NULL)
+        closeTraceLog(options.trace);
+
+    exit(status);
+}
+
+int processDay(char *satDate, const char *modDir, const char *outputDir, TracisOptions *options, TracisCache *cache)
+{
+    time_t processingStartTime = time(NULL);
 
     char satellite = satDate[0];
     int year = 0;
@@ -82,9 +169,30 @@ int main(int argc, char **argv)
 
     sprintf(infoHeader, "TRACIS %c%s %04d-%02d-%02d: ", satellite, EXPORT_VERSION_STRING, year, month, day);
 
+    if (options->estimateMemory)
+    {
+        MemoryEstimate estimate;
+        int estimateStatus = estimateDayMemory(satDate, ".", modDir, options->gcrDetection, &estimate);
+        if (estimateStatus == MEMORY_ESTIMATE_OK)
+            printMemoryEstimate(&estimate, stdout);
+        else
+            fprintf(stdout, "%sCould not estimate memory for this date.\n", infoHeader);
+        fflush(stdout);
+        return estimateStatus;
+    }
+    resetMemoryPeaks();
+
     ImageStorage store = {0};
     initImageStorage(&store);
 
+    Profile profile;
+    initProfile(&profile, options->profile);
+    setProfileTrace(&profile, options->trace, satDate);
+    if (options->perfCounters)
+        enableProfileCounters(&profile);
+    double dayStartUs = traceMicroseconds();
+    char traceArgs[128];
+
     char *efiFilenames = NULL;
     size_t nEfiFiles = 0;
 
@@ -98,6 +206,7 @@ int main(int argc, char **argv)
     ImagePackets imagePackets = {0};
     SciencePackets sciencePackets = {0};
     LpTiiTimeSeries timeSeries = {0};
+    size_t packetBytes = 0;
 
     double cdfTime = 0.0;
     Ephemeres ephem = {0};
@@ -139,6 +248,7 @@ int main(int argc, char **argv)
         goto cleanup;
     }
     sprintf(tracisLRFullFilename, "%s.cdf", tracisLRFilename);
+    sprintf(tracisLRZipFilename, "%s.ZIP", tracisLRFilename);
     sprintf(tracisHRZipFilename, "%s.ZIP", tracisHRFilename);
     if (access(tracisLRZipFilename, F_OK) == 0 || access(tracisHRZipFilename, F_OK) == 0)
     {
@@ -147,10 +257,11 @@ int main(int argc, char **argv)
     }
 
     // Data
+    profileStart(&profile, PROFILE_EPHEMERES);
     int nModFiles = 1;
 
     char modFilename[FILENAME_MAX];
-    if (getInputFilename(satellite, year, month, day, modDir, "SC_1B", modFilename))
+    if (cachedInputFilename(cache, satellite, year, month, day, modDir, "SC_1B", modFilename))
     {
         fprintf(stdout, "%sOPER MODx SC_1B input file is not available.\n", infoHeader);
         goto cleanup;
@@ -160,21 +271,22 @@ int main(int argc, char **argv)
     int monthPrev = month;
     int dayPrev = day;
     dateAdjust(&yearPrev, &monthPrev, &dayPrev, -1);
-    if (getInputFilename(satellite, yearPrev, monthPrev, dayPrev, modDir, "SC_1B", modFilenamePrevious))
+    if (cachedInputFilename(cache, satellite, yearPrev, monthPrev, dayPrev, modDir, "SC_1B", modFilenamePrevious))
     {
         sprintf(modFilenamePrevious, "%s", "<unavailable>");
     }
     else
     {
         nModFiles = 2;
-        status = loadEphemeres(modFilenamePrevious, &ephem);
+        status = cachedLoadEphemeres(cache, modFilenamePrevious, &ephem);
     }
-    status = loadEphemeres(modFilename, &ephem);
+    status = cachedLoadEphemeres(cache, modFilename, &ephem);
     if (status)
     {
         fprintf(stdout, "%sUnable to load satellite ephemeres.\n", infoHeader);
         goto cleanup;
     }
+    profileStop(&profile, PROFILE_EPHEMERES);
 
     efiFilenames = (char *)realloc(efiFilenames, (nEfiFiles + nModFiles)*FILENAME_MAX);
     if (efiFilenames == NULL)
@@ -190,7 +302,12 @@ int main(int argc, char **argv)
     sprintf(efiFilenames + nEfiFiles * FILENAME_MAX, "%s", modFilename);
     nEfiFiles++;
 
+    profileStart(&profile, PROFILE_IMAGERY);
     status = importImageryWithFilenames(satDate, &imagePackets, &efiFilenames, &nEfiFiles);
+    profileStop(&profile, PROFILE_IMAGERY);
+    profile.imagePackets = imagePackets.numberOfImages;
+    packetBytes = imagePacketBytes(imagePackets.numberOfImages);
+    memoryAllocated(MEMORY_PACKETS, packetBytes);
     if (status)
     {
         fprintf(stderr, "%sCould not import image data.\n", infoHeader);
@@ -203,9 +320,13 @@ int main(int argc, char **argv)
         goto cleanup;
     }
     
+    profileStart(&profile, PROFILE_SCIENCE);
     initLpTiiTimeSeries(&timeSeries);
     importScience(satDate, &sciencePackets);
     getLpTiiTimeSeries(satDate[0], &sciencePackets, &timeSeries);
+    memoryAllocated(MEMORY_PACKETS, timeSeriesBytes(timeSeries.n2Hz));
+    packetBytes += timeSeriesBytes(timeSeries.n2Hz);
+    profileStop(&profile, PROFILE_SCIENCE);
 
     initializeImagePair(&imagePair, &auxH, pixelsH, &auxV, pixelsV);
     getFirstImagePair(&imagePackets, &imagePair);
@@ -222,26 +343,35 @@ int main(int argc, char **argv)
 
     int imagesRead = 0;
 
-    status = allocateImageMemory(&store, numberOfImagePairs, numberOfColumnSums);
-    if (status)
+    status = allocateImageMemory(&store, numberOfImagePairs, numberOfColumnSums, options->gcrDetection, options->compressImages, options->spillDir);
+    if (status == UTIL_ERR_SPILL)
+    {
+        printf("%sCould not map image data from spill directory %s: %s\n", infoHeader, options->spillDir, strerror(errno));
+        goto cleanup;
+    }
+    else if (status)
     {
         printf("%sOut of memory trying to store image data.\n", infoHeader);
         goto cleanup;
     }
 
-    size_t imageBytes = IMAGE_ROWS * IMAGE_COLS * sizeof(uint16_t);
-
     size_t numberOfRecords = 0;
 
     double *gainMapH = NULL;
     double *gainMapV = NULL;
 
-    float radiusMapH[IMAGE_COLS*IMAGE_ROWS];
-    float radiusMapV[IMAGE_COLS*IMAGE_ROWS];
-
-    calculateRadiusMap(satellite, H_SENSOR, radiusMapH);
-    calculateRadiusMap(satellite, V_SENSOR, radiusMapV);
+    const SensorCalibration *calibrationH = cachedCalibration(cache, satellite, H_SENSOR);
+    const SensorCalibration *calibrationV = cachedCalibration(cache, satellite, V_SENSOR);
+    if (calibrationH == NULL || calibrationV == NULL)
+    {
+        fprintf(stdout, "%sInvalid satellite %c.\n", infoHeader, satellite);
+        status = -1;
+        goto cleanup;
+    }
 
+    profile.imagePairs = numberOfImagePairs;
+    profile.columnSums = numberOfColumnSums;
+    profileStart(&profile, PROFILE_IMAGE_LOOP);
     for (size_t i = 0; i < imagePackets.numberOfImages-1;)
     {
 
@@ -257,6 +387,9 @@ int main(int argc, char **argv)
         if (ignoreTime(imagePair.secondsSince1970, dayStart, dayEnd) || (imagePair.gotImageH == false && imagePair.gotImageV == false))
             continue;
 
+        bool tracePair = options->trace != NULL && numberOfRecords % TRACE_IMAGE_PAIR_INTERVAL == 0;
+        double pairStartUs = tracePair ? traceMicroseconds() : 0.0;
+
         UnixTimetoEPOCH(&imagePair.secondsSince1970, &cdfTime, 1);
         store.imageTimes[numberOfRecords] = cdfTime;
 
@@ -267,8 +400,12 @@ int main(int argc, char **argv)
         store.imagingMode[numberOfRecords] = (scienceMode(imagePair.auxH) && scienceMode(imagePair.auxV));
 
         // Copy imagery to image time series
-        memcpy(store.rawImagesH + numberOfRecords * imageBytes, imagePair.pixelsH, imageBytes);
-        memcpy(store.rawImagesV + numberOfRecords * imageBytes, imagePair.pixelsV, imageBytes);
+        status = storeImagePair(&store, numberOfRecords, false, imagePair.pixelsH, imagePair.pixelsV);
+        if (status)
+        {
+            printf("%sOut of memory trying to store image data.\n", infoHeader);
+            goto cleanup;
+        }
 
         // Raw anomaly data
         initializeAnomalyData(&h);
@@ -276,33 +413,44 @@ int main(int argc, char **argv)
         analyzeRawImageAnomalies(imagePair.pixelsH, imagePair.gotImageH, imagePair.auxH->satellite, &h);
         analyzeRawImageAnomalies(imagePair.pixelsV, imagePair.gotImageV, imagePair.auxV->satellite, &v);
 
+        // GCR hits, from the raw image before gain correction
+        if (options->gcrDetection)
+        {
+            store.gcrCountH[numberOfRecords] = gcrCandidateImage(imagePair.gotImageH, imagePair.auxH->BiasGridVoltageMonitor, imagePair.auxH->McpVoltageMonitor, imagePair.auxH->PhosphorVoltageMonitor) ? countGcrPixels(imagePair.pixelsH) : GCR_NOT_CANDIDATE;
+            store.gcrCountV[numberOfRecords] = gcrCandidateImage(imagePair.gotImageV, imagePair.auxV->BiasGridVoltageMonitor, imagePair.auxV->McpVoltageMonitor, imagePair.auxV->PhosphorVoltageMonitor) ? countGcrPixels(imagePair.pixelsV) : GCR_NOT_CANDIDATE;
+        }
+
         // Energy pixel map
         calculateEnergyMap(satellite, H_SENSOR, imagePair.auxH->BiasGridVoltageMonitor, imagePair.auxH->McpVoltageMonitor, store.energyMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS);
 
         calculateEnergyMap(satellite, V_SENSOR, imagePair.auxV->BiasGridVoltageMonitor, imagePair.auxV->McpVoltageMonitor, store.energyMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS);
 
         // Angle-of-arrival pixel map
-        calculateAngleOfArrivalMap(satellite, H_SENSOR, store.angleOfArrivalMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS);
+        memcpy(store.angleOfArrivalMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationH->angleOfArrivalMap, sizeof(calibrationH->angleOfArrivalMap));
 
-        calculateAngleOfArrivalMap(satellite, V_SENSOR, store.angleOfArrivalMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS);
+        memcpy(store.angleOfArrivalMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationV->angleOfArrivalMap, sizeof(calibrationV->angleOfArrivalMap));
 
         // Calculated from raw image
         // Raw energy spectrum
-        energySpectrum(imagePair.pixelsH, store.energyMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, radiusMapH, NULL, imagePair.auxH->BiasGridVoltageMonitor, imagePair.auxH->McpVoltageMonitor, store.rawEnergySpectrumH + numberOfRecords * ENERGY_BINS, store.energiesH + numberOfRecords * ENERGY_BINS);
+        energySpectrumBinned(imagePair.pixelsH, store.energyMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationH->energyBins, NULL, store.rawEnergySpectrumH + numberOfRecords * ENERGY_BINS, store.energiesH + numberOfRecords * ENERGY_BINS);
 
-        energySpectrum(imagePair.pixelsV, store.energyMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, radiusMapV, NULL, imagePair.auxV->BiasGridVoltageMonitor, imagePair.auxV->McpVoltageMonitor, store.rawEnergySpectrumV + numberOfRecords * ENERGY_BINS, store.energiesV + numberOfRecords * ENERGY_BINS);
+        energySpectrumBinned(imagePair.pixelsV, store.energyMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationV->energyBins, NULL, store.rawEnergySpectrumV + numberOfRecords * ENERGY_BINS, store.energiesV + numberOfRecords * ENERGY_BINS);
 
         // Raw angle-of-arrival spectrum
-        angleOfArrivalSpectrum(imagePair.pixelsH, store.angleOfArrivalMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, radiusMapH, NULL, store.rawAngleOfArrivalSpectrumH + numberOfRecords * ANGULAR_BINS, store.anglesOfArrival + numberOfRecords * ANGULAR_BINS);
+        angleOfArrivalSpectrumBinned(imagePair.pixelsH, store.angleOfArrivalMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationH->angleOfArrivalBins, NULL, store.rawAngleOfArrivalSpectrumH + numberOfRecords * ANGULAR_BINS, store.anglesOfArrival + numberOfRecords * ANGULAR_BINS);
 
-        angleOfArrivalSpectrum(imagePair.pixelsV, store.angleOfArrivalMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, radiusMapV, NULL, store.rawAngleOfArrivalSpectrumV + numberOfRecords * ANGULAR_BINS, NULL);
+        angleOfArrivalSpectrumBinned(imagePair.pixelsV, store.angleOfArrivalMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationV->angleOfArrivalBins, NULL, store.rawAngleOfArrivalSpectrumV + numberOfRecords * ANGULAR_BINS, NULL);
 
         // Gain corrected images and anomalies
         latestConfigValues(&imagePair, &timeSeries, &pixelThreshold, NULL, NULL, NULL, NULL, NULL, NULL);
         applyImagePairGainMaps(&imagePair, pixelThreshold, NULL, NULL);
 
-        memcpy(store.correctedImagesH + numberOfRecords * imageBytes, imagePair.pixelsH, imageBytes);
-        memcpy(store.correctedImagesV + numberOfRecords * imageBytes, imagePair.pixelsV, imageBytes);
+        status = storeImagePair(&store, numberOfRecords, true, imagePair.pixelsH, imagePair.pixelsV);
+        if (status)
+        {
+            printf("%sOut of memory trying to store image data.\n", infoHeader);
+            goto cleanup;
+        }
 
         analyzeGainCorrectedImageAnomalies(imagePair.pixelsH, imagePair.gotImageH, imagePair.auxH->satellite, &h);
         analyzeGainCorrectedImageAnomalies(imagePair.pixelsV, imagePair.gotImageV, imagePair.auxV->satellite, &v);
@@ -359,20 +507,29 @@ int main(int argc, char **argv)
         gainMapV = getGainMap(imagePair.auxV->EfiInstrumentId, V_SENSOR, store.imageTimes[numberOfRecords]);
 
         // Energy spectrum
-        energySpectrum(imagePair.pixelsH, store.energyMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, radiusMapH, gainMapH, imagePair.auxH->BiasGridVoltageMonitor, imagePair.auxH->McpVoltageMonitor, store.energySpectrumH + numberOfRecords * ENERGY_BINS, NULL);
+        energySpectrumBinned(imagePair.pixelsH, store.energyMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationH->energyBins, gainMapH, store.energySpectrumH + numberOfRecords * ENERGY_BINS, NULL);
 
-        energySpectrum(imagePair.pixelsV, store.energyMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, radiusMapV, gainMapV, imagePair.auxV->BiasGridVoltageMonitor, imagePair.auxV->McpVoltageMonitor, store.energySpectrumV + numberOfRecords * ENERGY_BINS, NULL);
+        energySpectrumBinned(imagePair.pixelsV, store.energyMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationV->energyBins, gainMapV, store.energySpectrumV + numberOfRecords * ENERGY_BINS, NULL);
 
         // Angle-of-arrival spectrum
-        angleOfArrivalSpectrum(imagePair.pixelsH, store.angleOfArrivalMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, radiusMapH, gainMapH, store.angleOfArrivalSpectrumH + numberOfRecords * ANGULAR_BINS, NULL);
+        angleOfArrivalSpectrumBinned(imagePair.pixelsH, store.angleOfArrivalMapH + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationH->angleOfArrivalBins, gainMapH, store.angleOfArrivalSpectrumH + numberOfRecords * ANGULAR_BINS, NULL);
 
-        angleOfArrivalSpectrum(imagePair.pixelsV, store.angleOfArrivalMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, radiusMapV, gainMapV, store.angleOfArrivalSpectrumV + numberOfRecords * ANGULAR_BINS, NULL);
+        angleOfArrivalSpectrumBinned(imagePair.pixelsV, store.angleOfArrivalMapV + numberOfRecords * IMAGE_COLS * IMAGE_ROWS, calibrationV->angleOfArrivalBins, gainMapV, store.angleOfArrivalSpectrumV + numberOfRecords * ANGULAR_BINS, NULL);
+
+        if (tracePair)
+        {
+            snprintf(traceArgs, sizeof traceArgs, "\"day\": \"%s\", \"record\": %zu", satDate, numberOfRecords);
+            traceSpan(options->trace, "image_pair", "image", 0, pairStartUs, traceMicroseconds(), traceArgs);
+        }
 
         numberOfRecords++;
 
     }
+    profileStop(&profile, PROFILE_IMAGE_LOOP);
+    profile.imageRecords = numberOfRecords;
 
     // Column sum spectra, 2 Hz
+    profileStart(&profile, PROFILE_COLUMN_SUMS);
     size_t colSumRecords = 0;
     float xcH = 0.0;
     float xcV = 0.0;
@@ -425,9 +582,11 @@ int main(int argc, char **argv)
     size_t lastColumnInd = i-1;
     memcpy(store.colSumSpectrumH, timeSeries.columnSumH + COLUMN_SUM_ENERGY_BINS * firstColumnInd, numberOfColumnSums * sizeof(uint16_t) * COLUMN_SUM_ENERGY_BINS);
     memcpy(store.colSumSpectrumV, timeSeries.columnSumV + COLUMN_SUM_ENERGY_BINS * firstColumnInd, numberOfColumnSums * sizeof(uint16_t) * COLUMN_SUM_ENERGY_BINS);
+    profileStop(&profile, PROFILE_COLUMN_SUMS);
 
     // TODO Fix image times to account for delay packing by onboard processor
     // Interpolate ephemeres at image times
+    profileStart(&profile, PROFILE_INTERPOLATION);
     status = allocEphemeres(&imageEphem, numberOfRecords);
     if (status)
     {
@@ -443,23 +602,45 @@ int main(int argc, char **argv)
         goto cleanup;
     }
     interpolateEphemeres(&ephem, store.colSumTimes, numberOfColumnSums, &colSumEphem);
+    profileStop(&profile, PROFILE_INTERPOLATION);
 
-    status = exportProducts(satellite, &store, numberOfRecords, &imageEphem, tracisLRFilename, numberOfColumnSums, &colSumEphem, tracisHRFilename, efiFilenames, nEfiFiles, processingStartTime);
+    status = exportProducts(satellite, &store, numberOfRecords, &imageEphem, tracisLRFilename, numberOfColumnSums, &colSumEphem, tracisHRFilename, efiFilenames, nEfiFiles, processingStartTime, &profile);
+
+    if (options->profile)
+    {
+        printProfile(&profile, stdout);
+        char profileFilename[FILENAME_MAX];
+        snprintf(profileFilename, FILENAME_MAX, "%s/%s_profile.json", outputDir, satDate);
+        if (writeProfile(&profile, profileFilename, satDate, status))
+            fprintf(stdout, "%sCould not write profile %s.\n", infoHeader, profileFilename);
+    }
 
 cleanup:
     if (imagePackets.fullImagePackets != NULL) free(imagePackets.fullImagePackets);
     if (imagePackets.continuedPackets != NULL) free(imagePackets.continuedPackets);
     freeLpTiiTimeSeries(&timeSeries);
+    memoryReleased(MEMORY_PACKETS, packetBytes);
 
     freeImageMemory(&store);
     freeEphemeres(&ephem);
     freeEphemeres(&imageEphem);
     freeEphemeres(&colSumEphem);
     free(efiFilenames);
+    freeProfile(&profile);
+
+    if (options->memoryReport)
+    {
+        MemoryReport memoryReport;
+        getMemoryReport(&memoryReport);
+        printMemoryReport(&memoryReport, stdout);
+    }
+
+    snprintf(traceArgs, sizeof traceArgs, "\"status\": %d", status);
+    traceSpan(options->trace, satDate, "day", 0, dayStartUs, traceMicroseconds(), traceArgs);
 
     fflush(stdout);
 
-    exit(status);
+    return status;
 }
 
 void usage(const char * name)
@@ -468,9 +649,26 @@ void usage(const char * name)
     printf("\nLicense: GPL 3.0 ");
     printf("Copyright 2022 Johnathan Kerr Burchill\n");
     printf("\nUsage:\n");
-    printf("\n  %s Xyyyymmdd modFileDir outputDir\n", name);
+    printf("\n  %s [options] Xyyyymmdd modFileDir outputDir\n", name);
+    printf("\n  %s [options] --worker\n", name);
     printf("\n");
     printf("X designates the Swarm satellite (A, B or C). Must be run from directory containing EFI L0 files.\n");
+    printf("\nWith --worker, reads one job per line from stdin:\n");
+    printf("\n  Xyyyymmdd modFileDir outputDir [l0FileDir]\n");
+    printf("\nand processes each in turn, appending its output to outputDir/Xyyyymmdd.log.\n");
+    printf("One status line per job goes to stdout: Xyyyymmdd exitStatus wallSeconds peakRssKb\n");
+    printf("peakRssKb is the peak during the job where /proc/self/clear_refs can reset it, otherwise the peak of the worker so far.\n");
+    printf("\nOptions:\n");
+    printf("\n  --shared-calibration\n\tmap detector geometry tables from shared memory segment %s, creating it if needed and removing it at exit if this process created it.\n", CALIBRATION_SEGMENT_NAME);
+    printf("\n  --keep-shared-calibration\n\tas --shared-calibration, but leave the segment for later processes. Used by tracisParallel, which removes it at the end of its run.\n");
+    printf("\n  --profile\n\tprint wall and CPU time of each processing stage with record and byte counts, and write them to outputDir/Xyyyymmdd_profile.json.\n");
+    printf("\n  --perf-counters\n\twith --profile, also count cycles, instructions, cache misses and branch misses in each stage where perf_event_open() permits.\n");
+    printf("\n  --memory-report\n\tat the end of each day, print current and peak bytes of image stacks, maps, spectra, 2 Hz arrays, ephemeres and libtii packets, and the peak RSS of the process.\n");
+    printf("\n  --estimate-memory\n\tprint an estimate of those peaks from the sizes of the L0 and MOD files, without processing the day.\n");
+    printf("\n  --compress-images\n\tkeep raw and gain-corrected images zlib-compressed in memory in blocks of %d records until they are exported.\n", IMAGE_STACK_BLOCK_RECORDS);
+    printf("\n  --spill-dir dir\n\tkeep image stacks and pixel maps in files under dir, mapped into memory, so that the kernel can page them out under memory pressure. dir should be local scratch with room for them; see --estimate-memory.\n");
+    printf("\n  --trace file\n\tappend Chrome trace-event JSON spans for each processing stage and every %dth image pair to file.\n", TRACE_IMAGE_PAIR_INTERVAL);
+    printf("\n  --gcr-detection\n\tcount cosmic ray hot pixels in images taken with the high voltages off and export them as GCR_count_H and GCR_count_V.\n");
 
     return;
 }
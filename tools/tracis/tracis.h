@@ -23,11 +23,34 @@
 #ifndef _ANOMALY_STATS_H
 #define _ANOMALY_STATS_H
 
+#include "tracis_cache.h"
+#include "trace_events.h"
+
 #include <stdint.h>
+#include <stdbool.h>
 
 #define TRACIS_VERSION_STRING "2.0"
 
-
+typedef struct TracisOptions
+{
+    bool worker;
+    bool sharedCalibration;
+    bool keepSharedCalibration; // leave a segment this process created for later processes
+    bool gcrDetection;
+    bool profile;
+    bool perfCounters; // implies profile
+    bool memoryReport;
+    bool estimateMemory; // report the estimate for each day instead of processing it
+    const char *spillDir; // NULL keeps image stacks and maps in anonymous memory
+    bool compressImages;
+    TraceLog *trace; // NULL unless --trace is given
+} TracisOptions;
+
+// Processes one satellite-day. satDate is Xyyyymmdd. Returns the exit status for that day.
+int processDay(char *satDate, const char *modDir, const char *outputDir, TracisOptions *options, TracisCache *cache);
+
+// Processes jobs read from stdin until end of input. See usage().
+int runWorker(TracisOptions *options, TracisCache *cache);
 
 void usage(const char * name);
 
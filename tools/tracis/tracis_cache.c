@@ -0,0 +1,132 @@
+/*
+
+    TRACIS Processor: tools/tracis/tracis_cache.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tracis_cache.h"
+
+#include "utilities.h"
+
+#include <tii/tii.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+void initTracisCache(TracisCache *cache)
+{
+    cache->sharedCalibration = NULL;
+    for (int i = 0; i < CALIBRATION_SATELLITES; i++)
+        cache->haveCalibration[i] = false;
+    initInputIndex(&cache->modIndex);
+    for (int i = 0; i < EPHEMERIS_CACHE_SLOTS; i++)
+    {
+        cache->ephemeres[i].filename[0] = '\0';
+        cache->ephemeres[i].modificationTime = 0;
+        cache->ephemeres[i].size = 0;
+        cache->ephemeres[i].lastUsed = 0;
+        initEphemeres(&cache->ephemeres[i].ephem);
+    }
+    cache->uses = 0;
+}
+
+void freeTracisCache(TracisCache *cache)
+{
+    detachCalibrationSegment(cache->sharedCalibration);
+    freeInputIndex(&cache->modIndex);
+    for (int i = 0; i < EPHEMERIS_CACHE_SLOTS; i++)
+        freeEphemeres(&cache->ephemeres[i].ephem);
+    initTracisCache(cache);
+}
+
+const SensorCalibration *cachedCalibration(TracisCache *cache, char satellite, int sensor)
+{
+    int s = satellite - 'A';
+    if (s < 0 || s >= CALIBRATION_SATELLITES)
+        return NULL;
+    int k = sensor == H_SENSOR ? 0 : 1;
+
+    if (cache->sharedCalibration != NULL)
+        return &cache->sharedCalibration->sensors[s][k];
+
+    if (!cache->haveCalibration[s])
+    {
+        fillSensorCalibration(satellite, H_SENSOR, &cache->calibration.sensors[s][0]);
+        fillSensorCalibration(satellite, V_SENSOR, &cache->calibration.sensors[s][1]);
+        cache->haveCalibration[s] = true;
+    }
+
+    return &cache->calibration.sensors[s][k];
+}
+
+int cachedInputFilename(TracisCache *cache, const char satelliteLetter, long year, long month, long day, const char *path, const char *dataset, char *filename)
+{
+    int status = refreshInputIndex(&cache->modIndex, path);
+    if (status != UTIL_NO_ERROR)
+        return status;
+
+    return findInputFilename(&cache->modIndex, satelliteLetter, year, month, day, dataset, filename);
+}
+
+int cachedLoadEphemeres(TracisCache *cache, const char *modFilename, Ephemeres *ephem)
+{
+    struct stat s;
+    if (stat(modFilename, &s) != 0)
+        return SAT_ERROR_FILE;
+
+    cache->uses++;
+
+    CachedEphemeres *slot = NULL;
+    for (int i = 0; i < EPHEMERIS_CACHE_SLOTS; i++)
+    {
+        CachedEphemeres *c = &cache->ephemeres[i];
+        if (strcmp(c->filename, modFilename) == 0 && c->modificationTime == s.st_mtime && c->size == s.st_size)
+        {
+            slot = c;
+            break;
+        }
+    }
+
+    if (slot == NULL)
+    {
+        // Replace the least recently used file
+        slot = &cache->ephemeres[0];
+        for (int i = 1; i < EPHEMERIS_CACHE_SLOTS; i++)
+        {
+            if (cache->ephemeres[i].lastUsed < slot->lastUsed)
+                slot = &cache->ephemeres[i];
+        }
+        freeEphemeres(&slot->ephem);
+        initEphemeres(&slot->ephem);
+        slot->filename[0] = '\0';
+        int status = loadEphemeres(modFilename, &slot->ephem);
+        if (status != SAT_OK)
+        {
+            freeEphemeres(&slot->ephem);
+            initEphemeres(&slot->ephem);
+            slot->lastUsed = 0;
+            return status;
+        }
+        snprintf(slot->filename, FILENAME_MAX, "%s", modFilename);
+        slot->modificationTime = s.st_mtime;
+        slot->size = s.st_size;
+    }
+    slot->lastUsed = cache->uses;
+
+    return appendEphemeres(ephem, &slot->ephem);
+}
@@ -0,0 +1,70 @@
+/*
+
+    TRACIS Processor: tools/tracis/tracis_cache.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TRACIS_CACHE_H
+#define _TRACIS_CACHE_H
+
+#include "tracis_settings.h"
+#include "input_index.h"
+#include "load_satellite_velocity.h"
+#include "calibration_segment.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+// Consecutive days share a MOD file: day N needs the files for days N-1 and N
+#define EPHEMERIS_CACHE_SLOTS 3
+
+typedef struct CachedEphemeres
+{
+    char filename[FILENAME_MAX];
+    time_t modificationTime;
+    off_t size;
+    long lastUsed;
+    Ephemeres ephem;
+} CachedEphemeres;
+
+// State that does not depend on the day being processed. A one-shot run
+// fills it once; a worker keeps it across jobs.
+typedef struct TracisCache
+{
+    // Detector geometry from the shared segment if attached, otherwise computed here per satellite
+    const CalibrationTables *sharedCalibration;
+    bool haveCalibration[CALIBRATION_SATELLITES];
+    CalibrationTables calibration;
+    InputIndex modIndex;
+    CachedEphemeres ephemeres[EPHEMERIS_CACHE_SLOTS];
+    long uses;
+} TracisCache;
+
+void initTracisCache(TracisCache *cache);
+void freeTracisCache(TracisCache *cache);
+
+const SensorCalibration *cachedCalibration(TracisCache *cache, char satellite, int sensor);
+
+// getInputFilename() through an index of the directory that is reused while the directory is unchanged
+int cachedInputFilename(TracisCache *cache, const char satelliteLetter, long year, long month, long day, const char *path, const char *dataset, char *filename);
+
+// loadEphemeres() that parses each MOD file once while it is unchanged on disk
+int cachedLoadEphemeres(TracisCache *cache, const char *modFilename, Ephemeres *ephem);
+
+#endif // _TRACIS_CACHE_H
@@ -23,6 +23,8 @@
 #include "utilities.h"
 
 #include "tracis_settings.h"
+#include "memory_accounting.h"
+#include "spill_storage.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -139,6 +141,8 @@ void initImageStorage(ImageStorage *store)
     store->energiesH = NULL;
     store->energiesV = NULL;
     store->anglesOfArrival = NULL;
+    store->gcrCountH = NULL;
+    store->gcrCountV = NULL;
 
     store->colSumTimes = NULL;
     store->biasGridVoltageSettingH = NULL;
@@ -152,22 +156,95 @@ void initImageStorage(ImageStorage *store)
     store->colSumEnergiesH = NULL;
     store->colSumEnergiesV = NULL;
     store->colSumImagingMode = NULL;
+
+    store->allocatedImagePairs = 0;
+    store->allocatedColumnSums = 0;
+    store->allocatedGcrCounts = false;
+    store->spilledImages = false;
+
+    store->compressedImages = false;
+    memset(&store->rawStackH, 0, sizeof(ImageStack));
+    memset(&store->rawStackV, 0, sizeof(ImageStack));
+    memset(&store->correctedStackH, 0, sizeof(ImageStack));
+    memset(&store->correctedStackV, 0, sizeof(ImageStack));
     
 }
 
-int allocateImageMemory(ImageStorage *store, size_t numberOfImagePairs, size_t numberOfColumnSums)
+void imageStorageBytes(size_t numberOfImagePairs, size_t numberOfColumnSums, bool gcrCounts, size_t *bytes)
+{
+    size_t pixels = numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS;
+
+    bytes[MEMORY_IMAGE_STACKS] += 4 * pixels * sizeof(uint16_t);
+    bytes[MEMORY_MAPS] += 4 * pixels * sizeof(float);
+    bytes[MEMORY_SPECTRA] += numberOfImagePairs * (6 * ENERGY_BINS + 5 * ANGULAR_BINS) * sizeof(float);
+    bytes[MEMORY_IMAGE_SERIES] += numberOfImagePairs * (sizeof(double) + 5 * sizeof(uint8_t) + 2 * sizeof(uint16_t) + 11 * sizeof(float) + (gcrCounts ? 2 * sizeof(int16_t) : 0));
+    bytes[MEMORY_2HZ] += numberOfColumnSums * (sizeof(double) + 6 * sizeof(float) + COLUMN_SUM_ENERGY_BINS * 2 * (sizeof(uint16_t) + sizeof(float)) + sizeof(uint8_t));
+
+    return;
+}
+
+static void accountImageMemory(const ImageStorage *store, void (*account)(enum MemoryCategory, size_t))
+{
+    size_t bytes[MEMORY_CATEGORIES] = {0};
+    imageStorageBytes(store->allocatedImagePairs, store->allocatedColumnSums, store->allocatedGcrCounts, bytes);
+    // ImageStacks account for themselves as they grow
+    if (store->compressedImages)
+        bytes[MEMORY_IMAGE_STACKS] = 0;
+    for (int c = 0; c < MEMORY_CATEGORIES; c++)
+        if (bytes[c] > 0)
+            account(c, bytes[c]);
+
+    return;
+}
+
+// Image stacks and pixel maps, the arrays that spill
+static void *allocateImageArray(const ImageStorage *store, const char *spillDir, size_t bytes)
 {
+    return store->spilledImages ? spillAlloc(spillDir, bytes) : malloc(bytes);
+}
+
+static void freeImageArray(const ImageStorage *store, void *p, size_t bytes)
+{
+    if (store->spilledImages)
+        spillFree(p, bytes);
+    else
+        free(p);
+
+    return;
+}
+
+int allocateImageMemory(ImageStorage *store, size_t numberOfImagePairs, size_t numberOfColumnSums, bool gcrCounts, bool compressImages, const char *spillDir)
+{
+    // Counted up front so that freeImageMemory() releases the same amount after a failure
+    store->allocatedImagePairs = numberOfImagePairs;
+    store->allocatedColumnSums = numberOfColumnSums;
+    store->allocatedGcrCounts = gcrCounts;
+    store->compressedImages = compressImages;
+    accountImageMemory(store, memoryAllocated);
+    store->spilledImages = spillDir != NULL && numberOfImagePairs > 0;
+    int imageArrayError = store->spilledImages ? UTIL_ERR_SPILL : UTIL_ERR_MEMORY;
+    size_t imageStackBytes = numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(uint16_t);
+    size_t mapBytes = numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(float);
+
     if ((store->imageTimes = (double*)malloc(numberOfImagePairs * sizeof(double))) == NULL)
         return UTIL_ERR_MEMORY;
 
-    if ((store->rawImagesH = (uint8_t*)malloc(numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(uint16_t))) == NULL)
-        return UTIL_ERR_MEMORY;
-    if ((store->rawImagesV = (uint8_t*)malloc(numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(uint16_t))) == NULL)
-        return UTIL_ERR_MEMORY;
-    if ((store->correctedImagesH = (uint8_t*)malloc(numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(uint16_t))) == NULL)
-        return UTIL_ERR_MEMORY;
-    if ((store->correctedImagesV = (uint8_t*)malloc(numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(uint16_t))) == NULL)
-        return UTIL_ERR_MEMORY;
+    if (compressImages)
+    {
+        if (initImageStack(&store->rawStackH) != IMAGE_STACK_OK || initImageStack(&store->rawStackV) != IMAGE_STACK_OK || initImageStack(&store->correctedStackH) != IMAGE_STACK_OK || initImageStack(&store->correctedStackV) != IMAGE_STACK_OK)
+            return UTIL_ERR_MEMORY;
+    }
+    else
+    {
+        if ((store->rawImagesH = (uint8_t*)allocateImageArray(store, spillDir, imageStackBytes)) == NULL)
+            return imageArrayError;
+        if ((store->rawImagesV = (uint8_t*)allocateImageArray(store, spillDir, imageStackBytes)) == NULL)
+            return imageArrayError;
+        if ((store->correctedImagesH = (uint8_t*)allocateImageArray(store, spillDir, imageStackBytes)) == NULL)
+            return imageArrayError;
+        if ((store->correctedImagesV = (uint8_t*)allocateImageArray(store, spillDir, imageStackBytes)) == NULL)
+            return imageArrayError;
+    }
 
     if ((store->validImageryH = (uint8_t*)malloc(numberOfImagePairs * sizeof(uint8_t))) == NULL)
         return UTIL_ERR_MEMORY;
@@ -215,15 +292,15 @@ int allocateImageMemory(ImageStorage *store, size_t numberOfImagePairs, size_t n
     if ((store->ShutterDutyCycleV = (float*)malloc(numberOfImagePairs * sizeof(float))) == NULL)
         return UTIL_ERR_MEMORY;
 
-    if ((store->energyMapH = (float*)malloc(numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(float))) == NULL)
-        return UTIL_ERR_MEMORY;
-    if ((store->energyMapV = (float*)malloc(numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(float))) == NULL)
-        return UTIL_ERR_MEMORY;
+    if ((store->energyMapH = (float*)allocateImageArray(store, spillDir, mapBytes)) == NULL)
+        return imageArrayError;
+    if ((store->energyMapV = (float*)allocateImageArray(store, spillDir, mapBytes)) == NULL)
+        return imageArrayError;
 
-    if ((store->angleOfArrivalMapH = (float*)malloc(numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(float))) == NULL)
-        return UTIL_ERR_MEMORY;
-    if ((store->angleOfArrivalMapV = (float*)malloc(numberOfImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(float))) == NULL)
-        return UTIL_ERR_MEMORY;
+    if ((store->angleOfArrivalMapH = (float*)allocateImageArray(store, spillDir, mapBytes)) == NULL)
+        return imageArrayError;
+    if ((store->angleOfArrivalMapV = (float*)allocateImageArray(store, spillDir, mapBytes)) == NULL)
+        return imageArrayError;
 
     if ((store->energySpectrumH = (float*)malloc(numberOfImagePairs * ENERGY_BINS * sizeof(float))) == NULL)
         return UTIL_ERR_MEMORY;
@@ -254,6 +331,9 @@ int allocateImageMemory(ImageStorage *store, size_t numberOfImagePairs, size_t n
     if ((store->anglesOfArrival = (float*)malloc(numberOfImagePairs * ANGULAR_BINS * sizeof(float))) == NULL)
         return UTIL_ERR_MEMORY;
 
+    if (gcrCounts && ((store->gcrCountH = (int16_t*)malloc(numberOfImagePairs * sizeof(int16_t))) == NULL || (store->gcrCountV = (int16_t*)malloc(numberOfImagePairs * sizeof(int16_t))) == NULL))
+        return UTIL_ERR_MEMORY;
+
     // 2 Hz
 
     if ((store->colSumTimes = (double*)malloc(numberOfColumnSums * sizeof(double))) == NULL)
@@ -298,11 +378,18 @@ int allocateImageMemory(ImageStorage *store, size_t numberOfImagePairs, size_t n
 
 void freeImageMemory(ImageStorage *store)
 {
+    size_t imageStackBytes = store->allocatedImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(uint16_t);
+    size_t mapBytes = store->allocatedImagePairs * IMAGE_ROWS * IMAGE_COLS * sizeof(float);
+
     free(store->imageTimes);
-    free(store->rawImagesH);
-    free(store->rawImagesV);
-    free(store->correctedImagesH);
-    free(store->correctedImagesV);
+    freeImageArray(store, store->rawImagesH, imageStackBytes);
+    freeImageArray(store, store->rawImagesV, imageStackBytes);
+    freeImageArray(store, store->correctedImagesH, imageStackBytes);
+    freeImageArray(store, store->correctedImagesV, imageStackBytes);
+    freeImageStack(&store->rawStackH);
+    freeImageStack(&store->rawStackV);
+    freeImageStack(&store->correctedStackH);
+    freeImageStack(&store->correctedStackV);
     free(store->validImageryH);
     free(store->validImageryV);
     free(store->imagingMode);
@@ -321,10 +408,10 @@ void freeImageMemory(ImageStorage *store)
     free(store->VFaceplate);
     free(store->ShutterDutyCycleH);
     free(store->ShutterDutyCycleV);
-    free(store->energyMapH);
-    free(store->energyMapV);
-    free(store->angleOfArrivalMapH);
-    free(store->angleOfArrivalMapV);
+    freeImageArray(store, store->energyMapH, mapBytes);
+    freeImageArray(store, store->energyMapV, mapBytes);
+    freeImageArray(store, store->angleOfArrivalMapH, mapBytes);
+    freeImageArray(store, store->angleOfArrivalMapV, mapBytes);
     free(store->energySpectrumH);
     free(store->energySpectrumV);
     free(store->angleOfArrivalSpectrumH);
@@ -336,6 +423,8 @@ void freeImageMemory(ImageStorage *store)
     free(store->energiesH);
     free(store->energiesV);
     free(store->anglesOfArrival);
+    free(store->gcrCountH);
+    free(store->gcrCountV);
     free(store->colSumTimes);
     free(store->biasGridVoltageSettingH);
     free(store->biasGridVoltageSettingV);
@@ -349,9 +438,34 @@ void freeImageMemory(ImageStorage *store)
     free(store->colSumEnergiesV);
     free(store->colSumImagingMode);
 
+    accountImageMemory(store, memoryReleased);
+    store->allocatedImagePairs = 0;
+    store->allocatedColumnSums = 0;
+    store->allocatedGcrCounts = false;
+    store->spilledImages = false;
+    store->compressedImages = false;
+
     return;
 }
 
+int storeImagePair(ImageStorage *store, size_t record, bool corrected, const uint16_t *pixelsH, const uint16_t *pixelsV)
+{
+    if (store->compressedImages)
+    {
+        ImageStack *h = corrected ? &store->correctedStackH : &store->rawStackH;
+        ImageStack *v = corrected ? &store->correctedStackV : &store->rawStackV;
+        if (appendImageRecord(h, pixelsH) != IMAGE_STACK_OK || appendImageRecord(v, pixelsV) != IMAGE_STACK_OK)
+            return UTIL_ERR_MEMORY;
+        return UTIL_NO_ERROR;
+    }
+
+    size_t imageBytes = IMAGE_ROWS * IMAGE_COLS * sizeof(uint16_t);
+    memcpy((corrected ? store->correctedImagesH : store->rawImagesH) + record * imageBytes, pixelsH, imageBytes);
+    memcpy((corrected ? store->correctedImagesV : store->rawImagesV) + record * imageBytes, pixelsV, imageBytes);
+
+    return UTIL_NO_ERROR;
+}
+
 int getInputFilename(const char satelliteLetter, long year, long month, long day, const char *path, const char *dataset, char *filename)
 {
 	char *searchPath[2] = {NULL, NULL};
@@ -25,6 +25,9 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
+
+#include "image_stack.h"
 
 #include <cdf.h>
 
@@ -92,6 +95,10 @@ typedef struct ImageStorage {
     float *energiesV;
     float *anglesOfArrival;
 
+    // Hot pixels in ready-state images, or GCR_NOT_CANDIDATE. NULL unless GCR detection is on.
+    int16_t *gcrCountH;
+    int16_t *gcrCountV;
+
     // Obtained at 2 Hz
     double *colSumTimes;
     float *biasGridVoltageSettingH;
@@ -106,11 +113,35 @@ typedef struct ImageStorage {
     float *colSumEnergiesV;
     uint8_t *colSumImagingMode;
 
+    // Sizes passed to allocateImageMemory(), for memory accounting
+    size_t allocatedImagePairs;
+    size_t allocatedColumnSums;
+    bool allocatedGcrCounts;
+    // Image stacks and pixel maps are file-backed, see spill_storage.h
+    bool spilledImages;
+
+    // Replace the four image arrays above when images are compressed
+    bool compressedImages;
+    ImageStack rawStackH;
+    ImageStack rawStackV;
+    ImageStack correctedStackH;
+    ImageStack correctedStackV;
+
 } ImageStorage;
 
 void initImageStorage(ImageStorage *store);
 
-int allocateImageMemory(ImageStorage *store, size_t numberOfImagePairs, size_t numberOfColumnSums);
+// Adds the bytes allocateImageMemory() would allocate to bytes[], indexed by enum MemoryCategory
+void imageStorageBytes(size_t numberOfImagePairs, size_t numberOfColumnSums, bool gcrCounts, size_t *bytes);
+
+// gcrCounts also allocates gcrCountH and gcrCountV. compressImages keeps raw and
+// corrected images in ImageStacks instead of arrays. Image arrays and pixel maps
+// are mapped from files in spillDir unless it is NULL.
+int allocateImageMemory(ImageStorage *store, size_t numberOfImagePairs, size_t numberOfColumnSums, bool gcrCounts, bool compressImages, const char *spillDir);
+
+// Stores an image pair as record of the raw or gain-corrected images. Records
+// must be stored in order when images are compressed.
+int storeImagePair(ImageStorage *store, size_t record, bool corrected, const uint16_t *pixelsH, const uint16_t *pixelsV);
 
 void freeImageMemory(ImageStorage *store);
 
@@ -126,7 +157,8 @@ enum UTIL_ERRORS {
     UTIL_ERR_SATELLITE_LETTER = -4,
     UTIL_ERR_DAY_OF_YEAR_CONVERSION = -5,
     UTIL_ERR_MEMORY = -6,
-    UTIL_ERR_DATE_ADJUST = -7
+    UTIL_ERR_DATE_ADJUST = -7,
+    UTIL_ERR_SPILL = -8
 };
 
 int dateAdjust(int *year, int *month, int *day, int deltaDays);
@@ -0,0 +1,152 @@
+/*
+
+    TRACIS Processor: tools/tracis/worker.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tracis.h"
+#include "trace_events.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <sys/resource.h>
+
+#define WORKER_JOB_LINE_LENGTH (3 * FILENAME_MAX + 64)
+
+// Restarts the kernel's peak RSS (VmHWM) from the current RSS, so that
+// the peak read after a job is that job's rather than the worker's
+static bool resetPeakRss(void)
+{
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0)
+        return false;
+    bool reset = write(fd, "5", 1) == 1;
+    close(fd);
+
+    return reset;
+}
+
+// Peak RSS in kB since resetPeakRss(), or for the life of the worker if it could not be reset
+static long peakRssKb(bool reset)
+{
+    long peak = -1;
+    if (reset)
+    {
+        FILE *f = fopen("/proc/self/status", "r");
+        char line[256];
+        while (f != NULL && peak < 0 && fgets(line, sizeof line, f) != NULL)
+            if (sscanf(line, "VmHWM: %ld", &peak) != 1)
+                peak = -1;
+        if (f != NULL)
+            fclose(f);
+    }
+    if (peak < 0)
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        peak = usage.ru_maxrss;
+    }
+
+    return peak;
+}
+
+// Points stdout and stderr at the job's log file, as the shell redirect
+// does for a one-shot run
+static int redirectOutput(const char *outputDir, const char *satDate)
+{
+    char logFilename[FILENAME_MAX];
+    snprintf(logFilename, FILENAME_MAX, "%s/%s.log", outputDir, satDate);
+    int log = open(logFilename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log < 0)
+        return -1;
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(log, STDOUT_FILENO);
+    dup2(log, STDERR_FILENO);
+    close(log);
+
+    return 0;
+}
+
+int runWorker(TracisOptions *options, TracisCache *cache)
+{
+    // Status lines go to the original stdout; job output goes to log files
+    int statusFd = dup(STDOUT_FILENO);
+    int idleFd = dup(STDERR_FILENO);
+    FILE *statusOut = statusFd >= 0 ? fdopen(statusFd, "w") : NULL;
+    if (statusOut == NULL || idleFd < 0)
+    {
+        fprintf(stderr, "Could not set up worker status output.\n");
+        return 1;
+    }
+    setvbuf(statusOut, NULL, _IOLBF, 0);
+    dup2(idleFd, STDOUT_FILENO);
+
+    char startDir[FILENAME_MAX];
+    if (getcwd(startDir, FILENAME_MAX) == NULL)
+    {
+        fprintf(stderr, "Could not get working directory.\n");
+        return 1;
+    }
+
+    char line[WORKER_JOB_LINE_LENGTH];
+    char satDate[16];
+    char modDir[FILENAME_MAX];
+    char outputDir[FILENAME_MAX];
+    char l0Dir[FILENAME_MAX];
+
+    while (fgets(line, WORKER_JOB_LINE_LENGTH, stdin) != NULL)
+    {
+        l0Dir[0] = '\0';
+        int nFields = sscanf(line, "%15s %4095s %4095s %4095s", satDate, modDir, outputDir, l0Dir);
+        if (nFields < 1)
+            continue;
+        if (nFields < 3 || strlen(satDate) != 9)
+        {
+            fprintf(statusOut, "%s %d %.3f %ld\n", satDate, 1, 0.0, 0L);
+            continue;
+        }
+
+        double startUs = traceMicroseconds();
+        bool rssReset = resetPeakRss();
+        int status = 0;
+        // Each job runs from the L0 directory if given, otherwise from where the worker
+        // was started, so relative paths mean the same as for a one-shot run from there
+        if (chdir(startDir) != 0 || (l0Dir[0] != '\0' && chdir(l0Dir) != 0) || redirectOutput(outputDir, satDate) != 0)
+            status = 1;
+        else
+            status = processDay(satDate, modDir, outputDir, options, cache);
+
+        fflush(stdout);
+        fflush(stderr);
+        dup2(idleFd, STDOUT_FILENO);
+        dup2(idleFd, STDERR_FILENO);
+
+        // Same value a shell would see as the exit code of a one-shot run
+        fprintf(statusOut, "%s %d %.3f %ld\n", satDate, status & 0xff, (traceMicroseconds() - startUs) / 1e6, peakRssKb(rssReset));
+    }
+
+    fclose(statusOut);
+    close(idleFd);
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+
+    TRACIS: tools/tracisBench/bench.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "bench.h"
+
+#include "tracis.h"
+
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#ifndef BENCH_C_FLAGS
+#define BENCH_C_FLAGS "unknown"
+#endif
+
+double benchSeconds(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void summarizeRuns(BenchResult *result, const double *seconds, int runs)
+{
+    double nsPerItem = 0.0;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+
+    result->runs = runs;
+    result->minNs = INFINITY;
+    for (int i = 0; i < runs; i++)
+    {
+        nsPerItem = seconds[i] * 1e9 / (double)result->itemsPerRun;
+        sum += nsPerItem;
+        sumSquares += nsPerItem * nsPerItem;
+        if (nsPerItem < result->minNs)
+            result->minNs = nsPerItem;
+    }
+    result->meanNs = sum / (double)runs;
+    result->varianceNs = runs > 1 ? (sumSquares - sum * result->meanNs) / (double)(runs - 1) : 0.0;
+    if (result->varianceNs < 0.0)
+        result->varianceNs = 0.0;
+
+    return;
+}
+
+void printBenchHeader(FILE *f)
+{
+    fprintf(f, "%-30s %8s %10s %8s %10s %14s %12s\n", "kernel", "per", "mean ns", "sd %", "best ns", "items/s", "images/s");
+}
+
+void printBenchResult(FILE *f, const BenchResult *result)
+{
+    fprintf(f, "%-30s %8s %10.3f %8.2f %10.3f %14.4g ", result->name, result->unit, result->meanNs, result->meanNs > 0.0 ? 100.0 * sqrt(result->varianceNs) / result->meanNs : 0.0, result->minNs, 1e9 / result->meanNs);
+    if (result->imagesPerRun > 0)
+        fprintf(f, "%12.1f\n", 1e9 / (result->meanNs * (double)result->itemsPerRun / (double)result->imagesPerRun));
+    else
+        fprintf(f, "%12s\n", "-");
+}
+
+static void writeJsonString(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(f, "\\u%04x", (unsigned char)*s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+// CPU model from /proc/cpuinfo, or "unknown"
+static void cpuModel(char *model, size_t size)
+{
+    snprintf(model, size, "unknown");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f == NULL)
+        return;
+    char line[256];
+    char *value = NULL;
+    while (fgets(line, sizeof line, f) != NULL)
+    {
+        if (strncmp(line, "model name", 10) != 0 || (value = strchr(line, ':')) == NULL)
+            continue;
+        value += strspn(value, ": \t");
+        value[strcspn(value, "\n")] = '\0';
+        snprintf(model, size, "%s", value);
+        break;
+    }
+    fclose(f);
+}
+
+// One kernel per line so that readBenchBaseline() need not parse JSON
+int writeBenchResults(const char *filename, const BenchResult *results, int nResults, int runs, const char *note)
+{
+    FILE *f = fopen(filename, "w");
+    if (f == NULL)
+        return 1;
+
+    char cpu[256];
+    cpuModel(cpu, sizeof cpu);
+    struct utsname system;
+    char systemName[sizeof system.sysname + sizeof system.release + sizeof system.machine + 3] = "unknown";
+    if (uname(&system) == 0)
+        snprintf(systemName, sizeof systemName, "%s %s %s", system.sysname, system.release, system.machine);
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"bench_version\": %d,\n", BENCH_VERSION);
+    fprintf(f, "  \"tracis_version\": \"%s\",\n", TRACIS_VERSION_STRING);
+    fprintf(f, "  \"machine\": {\"cpu\": ");
+    writeJsonString(f, cpu);
+    fprintf(f, ", \"online_cpus\": %ld, \"system\": ", sysconf(_SC_NPROCESSORS_ONLN));
+    writeJsonString(f, systemName);
+    fprintf(f, "},\n");
+    fprintf(f, "  \"compiler\": ");
+    writeJsonString(f, __VERSION__);
+    fprintf(f, ",\n  \"flags\": ");
+    writeJsonString(f, BENCH_C_FLAGS);
+    fprintf(f, ",\n");
+    if (note != NULL)
+    {
+        fprintf(f, "  \"note\": ");
+        writeJsonString(f, note);
+        fprintf(f, ",\n");
+    }
+    fprintf(f, "  \"runs\": %d,\n", runs);
+    fprintf(f, "  \"kernels\": [\n");
+    const BenchResult *r = NULL;
+    for (int i = 0; i < nResults; i++)
+    {
+        r = &results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"unit\": \"%s\", \"items_per_run\": %zu, \"images_per_run\": %zu, \"mean_ns\": %.4f, \"variance_ns\": %.6f, \"min_ns\": %.4f, \"items_per_second\": %.1f", r->name, r->unit, r->itemsPerRun, r->imagesPerRun, r->meanNs, r->varianceNs, r->minNs, 1e9 / r->meanNs);
+        if (r->imagesPerRun > 0)
+            fprintf(f, ", \"images_per_second\": %.1f", 1e9 / (r->meanNs * (double)r->itemsPerRun / (double)r->imagesPerRun));
+        fprintf(f, "}%s\n", i < nResults - 1 ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    return fclose(f) == 0 ? 0 : 1;
+}
+
+int readBenchBaseline(const char *filename, BenchBaseline *baseline, int maxKernels)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL)
+        return -1;
+
+    char line[1024];
+    char *name = NULL;
+    char *min = NULL;
+    int n = 0;
+    while (n < maxKernels && fgets(line, sizeof line, f) != NULL)
+    {
+        name = strstr(line, "\"name\": \"");
+        min = strstr(line, "\"min_ns\": ");
+        if (name == NULL || min == NULL)
+            continue;
+        if (sscanf(name + 9, "%63[^\"]", baseline[n].name) != 1 || sscanf(min + 10, "%lf", &baseline[n].minNs) != 1)
+            continue;
+        n++;
+    }
+    fclose(f);
+
+    return n;
+}
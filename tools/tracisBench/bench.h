@@ -0,0 +1,67 @@
+/*
+
+    TRACIS: tools/tracisBench/bench.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Timing statistics over repeated runs of a kernel, and the JSON results
+// file that later runs are compared against.
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define BENCH_VERSION 2
+#define BENCH_NAME_LENGTH 64
+#define BENCH_MAX_RUNS 1000
+
+typedef struct BenchResult
+{
+    char name[BENCH_NAME_LENGTH];
+    const char *unit; // what ns are per, e.g. "pixel" or "record"
+    size_t itemsPerRun;
+    size_t imagesPerRun; // 0 for kernels that do not process images
+    int runs;
+    double meanNs; // per item
+    double varianceNs; // per item, sample variance
+    double minNs; // per item
+} BenchResult;
+
+typedef struct BenchBaseline
+{
+    char name[BENCH_NAME_LENGTH];
+    double minNs;
+} BenchBaseline;
+
+double benchSeconds(void);
+
+// Fills the statistics of result from the wall time of each run
+void summarizeRuns(BenchResult *result, const double *seconds, int runs);
+
+void printBenchHeader(FILE *f);
+void printBenchResult(FILE *f, const BenchResult *result);
+
+// Also records the machine, compiler and compiler flags the results were measured with, and note if not NULL
+int writeBenchResults(const char *filename, const BenchResult *results, int nResults, int runs, const char *note);
+
+// Reads the name and best ns per item of each kernel in a file written by writeBenchResults().
+// Returns the number read, or -1 if the file cannot be opened.
+int readBenchBaseline(const char *filename, BenchBaseline *baseline, int maxKernels);
+
+#endif // _BENCH_H
@@ -0,0 +1,449 @@
+/*
+
+    TRACIS: tools/tracisBench/main.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Times the tracis image-analysis and ephemeris kernels on synthetic inputs
+// of a day's size, for comparing builds and catching regressions.
+
+#include "bench.h"
+
+#include "tracis_settings.h"
+#include "image_analysis.h"
+#include "calibration_segment.h"
+#include "interpolate.h"
+#include "load_satellite_velocity.h"
+#include "orbit.h"
+
+#include <tii/tii.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#define DEFAULT_IMAGES 1000
+#define DEFAULT_RUNS 10
+#define DEFAULT_EPOCHS 86400 // one day of 1 Hz MOD records
+#define DEFAULT_TOLERANCE 10.0 // percent
+#define IMAGES_PER_SECOND 2 // image pair cadence, for interpolation times
+#define PIXELS (IMAGE_COLS * IMAGE_ROWS)
+#define MAX_KERNELS 16
+
+// Nominal monitor values; only the shape of the energy map matters here
+#define BENCH_INNER_DOME_VOLTAGE -62.0
+#define BENCH_MCP_VOLTAGE -1800.0
+
+#define BENCH_MOD_START 1577836800 // 2020-01-01T00:00:00 UTC
+
+enum BENCH_STATUS
+{
+    BENCH_OK = 0,
+    BENCH_ERROR = 1,
+    BENCH_REGRESSION = 2
+};
+
+typedef struct BenchContext
+{
+    char satellite;
+    size_t nImages;
+    uint16_t *images;
+    float radiusMap[PIXELS];
+    float energyMap[PIXELS];
+    float angleOfArrivalMap[PIXELS];
+    double gainMap[PIXELS];
+    SensorCalibration calibration;
+    float spectrum[ANGULAR_BINS > ENERGY_BINS ? ANGULAR_BINS : ENERGY_BINS];
+    float bins[ANGULAR_BINS > ENERGY_BINS ? ANGULAR_BINS : ENERGY_BINS];
+    const char *modFilename;
+    Ephemeres ephem;
+    double *times;
+    size_t nTimes;
+    Ephemeres interpolated;
+    double checksum; // keeps results live
+} BenchContext;
+
+typedef struct Kernel
+{
+    const char *name;
+    const char *unit;
+    void (*run)(BenchContext *context);
+    size_t (*items)(const BenchContext *context);
+    bool images;
+} Kernel;
+
+// Prefix for messages from the tracis sources compiled in
+char infoHeader[50];
+
+static void radiusMapKernel(BenchContext *c)
+{
+    for (size_t i = 0; i < c->nImages; i++)
+    {
+        calculateRadiusMap(c->satellite, i % 2 == 0 ? H_SENSOR : V_SENSOR, c->radiusMap);
+        c->checksum += c->radiusMap[i % PIXELS];
+    }
+}
+
+static void energyMapKernel(BenchContext *c)
+{
+    for (size_t i = 0; i < c->nImages; i++)
+    {
+        // Monitor voltages change from image to image
+        calculateEnergyMap(c->satellite, i % 2 == 0 ? H_SENSOR : V_SENSOR, BENCH_INNER_DOME_VOLTAGE + 0.01 * (i % 16), BENCH_MCP_VOLTAGE, c->energyMap);
+        c->checksum += c->energyMap[i % PIXELS];
+    }
+}
+
+static void angleOfArrivalMapKernel(BenchContext *c)
+{
+    for (size_t i = 0; i < c->nImages; i++)
+    {
+        calculateAngleOfArrivalMap(c->satellite, i % 2 == 0 ? H_SENSOR : V_SENSOR, c->angleOfArrivalMap);
+        c->checksum += c->angleOfArrivalMap[i % PIXELS];
+    }
+}
+
+static void energySpectrumKernel(BenchContext *c)
+{
+    for (size_t i = 0; i < c->nImages; i++)
+    {
+        energySpectrum(c->images + i * PIXELS, c->energyMap, c->radiusMap, c->gainMap, BENCH_INNER_DOME_VOLTAGE, BENCH_MCP_VOLTAGE, c->spectrum, c->bins);
+        c->checksum += c->spectrum[i % ENERGY_BINS];
+    }
+}
+
+static void angleOfArrivalSpectrumKernel(BenchContext *c)
+{
+    for (size_t i = 0; i < c->nImages; i++)
+    {
+        angleOfArrivalSpectrum(c->images + i * PIXELS, c->angleOfArrivalMap, c->radiusMap, c->gainMap, c->spectrum, c->bins);
+        c->checksum += c->spectrum[i % ANGULAR_BINS];
+    }
+}
+
+static void energySpectrumBinnedKernel(BenchContext *c)
+{
+    for (size_t i = 0; i < c->nImages; i++)
+    {
+        energySpectrumBinned(c->images + i * PIXELS, c->energyMap, c->calibration.energyBins, c->gainMap, c->spectrum, c->bins);
+        c->checksum += c->spectrum[i % ENERGY_BINS];
+    }
+}
+
+static void angleOfArrivalSpectrumBinnedKernel(BenchContext *c)
+{
+    for (size_t i = 0; i < c->nImages; i++)
+    {
+        angleOfArrivalSpectrumBinned(c->images + i * PIXELS, c->calibration.angleOfArrivalMap, c->calibration.angleOfArrivalBins, c->gainMap, c->spectrum, c->bins);
+        c->checksum += c->spectrum[i % ANGULAR_BINS];
+    }
+}
+
+static void interpolateKernel(BenchContext *c)
+{
+    interpolateEphemeres(&c->ephem, c->times, c->nTimes, &c->interpolated);
+    c->checksum += c->interpolated.Latitude[c->nTimes / 2];
+}
+
+static void loadEphemeresKernel(BenchContext *c)
+{
+    Ephemeres ephem;
+    initEphemeres(&ephem);
+    if (loadEphemeres(c->modFilename, &ephem) == SAT_OK)
+        c->checksum += ephem.Radius[ephem.nEphem / 2];
+    freeEphemeres(&ephem);
+}
+
+static size_t imagePixels(const BenchContext *c)
+{
+    return c->nImages * PIXELS;
+}
+
+static size_t interpolationTimes(const BenchContext *c)
+{
+    return c->nTimes;
+}
+
+static size_t modRecords(const BenchContext *c)
+{
+    return c->ephem.nEphem;
+}
+
+static const Kernel kernels[] = {
+    {"calculateRadiusMap", "pixel", radiusMapKernel, imagePixels, true},
+    {"calculateEnergyMap", "pixel", energyMapKernel, imagePixels, true},
+    {"calculateAngleOfArrivalMap", "pixel", angleOfArrivalMapKernel, imagePixels, true},
+    {"energySpectrum", "pixel", energySpectrumKernel, imagePixels, true},
+    {"angleOfArrivalSpectrum", "pixel", angleOfArrivalSpectrumKernel, imagePixels, true},
+    {"energySpectrumBinned", "pixel", energySpectrumBinnedKernel, imagePixels, true},
+    {"angleOfArrivalSpectrumBinned", "pixel", angleOfArrivalSpectrumBinnedKernel, imagePixels, true},
+    {"interpolateEphemeres", "record", interpolateKernel, interpolationTimes, false},
+    {"loadEphemeres", "record", loadEphemeresKernel, modRecords, false}
+};
+
+#define N_KERNELS (int)(sizeof kernels / sizeof kernels[0])
+
+// xorshift, so that every build sees the same images
+static uint32_t nextRandom(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Background counts with a ring of ions near the inner dome radius, drifting in angle
+static void fillImages(BenchContext *c)
+{
+    uint32_t state = 2463534242u;
+    double ringRadius = 0.0;
+    double angle = 0.0;
+    double peak = 0.0;
+    double radius = 0.0;
+    double counts = 0.0;
+    for (size_t k = 0; k < c->nImages; k++)
+    {
+        ringRadius = 20.0 + 4.0 * sin(0.01 * k);
+        angle = 0.001 * k;
+        for (int i = 0; i < PIXELS; i++)
+        {
+            radius = c->radiusMap[i];
+            peak = 1000.0 * exp(-0.5 * (radius - ringRadius) * (radius - ringRadius) / 4.0);
+            counts = peak * (1.0 + 0.5 * cos(c->calibration.angleOfArrivalMap[i] * M_PI / 180.0 - angle)) + (double)(nextRandom(&state) % 20);
+            c->images[k * PIXELS + i] = (uint16_t)counts;
+        }
+    }
+}
+
+static int prepareContext(BenchContext *c)
+{
+    calculateRadiusMap(c->satellite, H_SENSOR, c->radiusMap);
+    calculateEnergyMap(c->satellite, H_SENSOR, BENCH_INNER_DOME_VOLTAGE, BENCH_MCP_VOLTAGE, c->energyMap);
+    calculateAngleOfArrivalMap(c->satellite, H_SENSOR, c->angleOfArrivalMap);
+    fillSensorCalibration(c->satellite, H_SENSOR, &c->calibration);
+    // Gain map cropped to the imaged region, as for flight gain maps
+    for (int i = 0; i < PIXELS; i++)
+        c->gainMap[i] = c->radiusMap[i] < MAX_RADIUS ? 1.0 : 0.0;
+
+    c->images = malloc(c->nImages * PIXELS * sizeof(uint16_t));
+    if (c->images == NULL)
+        return BENCH_ERROR;
+    fillImages(c);
+
+    int status = loadEphemeres(c->modFilename, &c->ephem);
+    if (status != SAT_OK)
+    {
+        fprintf(stderr, "Could not load MOD file %s: status %d\n", c->modFilename, status);
+        return BENCH_ERROR;
+    }
+
+    // Image pair times across the ephemeris span
+    double t0 = c->ephem.time[0];
+    double span = c->ephem.time[c->ephem.nEphem - 1] - t0;
+    c->nTimes = (size_t)(span / 1000.0 * IMAGES_PER_SECOND); // CDF epoch is in ms
+    if (c->nTimes == 0)
+        c->nTimes = 1;
+    c->times = malloc(c->nTimes * sizeof(double));
+    if (c->times == NULL || allocEphemeres(&c->interpolated, c->nTimes) != SAT_OK)
+        return BENCH_ERROR;
+    for (size_t i = 0; i < c->nTimes; i++)
+        c->times[i] = t0 + (double)i * 1000.0 / IMAGES_PER_SECOND;
+
+    return BENCH_OK;
+}
+
+static void freeContext(BenchContext *c)
+{
+    free(c->images);
+    free(c->times);
+    freeEphemeres(&c->ephem);
+    freeEphemeres(&c->interpolated);
+}
+
+static void usage(const char *name)
+{
+    printf("\nTRACIS kernel benchmarks\n");
+    printf("\nUsage:\n");
+    printf("\n  %s [options]\n", name);
+    printf("\nTimes each kernel over synthetic images and a synthetic MOD file, with one warm-up run\n");
+    printf("followed by the given number of timed runs.\n");
+    printf("\nOptions:\n");
+    printf("\n  --images n\n\timages per run (default %d).\n", DEFAULT_IMAGES);
+    printf("\n  --runs n\n\ttimed runs of each kernel (default %d, at most %d).\n", DEFAULT_RUNS, BENCH_MAX_RUNS);
+    printf("\n  --epochs n\n\trecords in the synthetic MOD file (default %d).\n", DEFAULT_EPOCHS);
+    printf("\n  --mod-file file\n\tload this MOD file instead of a synthetic one.\n");
+    printf("\n  --satellite X\n\tdetector geometry of Swarm A, B or C (default A).\n");
+    printf("\n  --kernel name\n\tonly run kernels whose names contain name.\n");
+    printf("\n  --output file\n\twrite results as JSON, for use as a baseline.\n");
+    printf("\n  --note text\n\trecord text in the --output file, e.g. how the build was made.\n");
+    printf("\n  --baseline file\n\tcompare the best ns per item of each kernel with a previous --output file,\n\texiting with status %d if any is slower by more than the tolerance.\n", BENCH_REGRESSION);
+    printf("\n  --tolerance percent\n\tallowed slowdown relative to the baseline (default %.0f).\n", DEFAULT_TOLERANCE);
+    printf("\n  --help\n\tprint this message.\n");
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    BenchContext context = {0};
+    context.satellite = 'A';
+    context.nImages = DEFAULT_IMAGES;
+    initEphemeres(&context.ephem);
+    initEphemeres(&context.interpolated);
+
+    int runs = DEFAULT_RUNS;
+    long epochs = DEFAULT_EPOCHS;
+    double tolerance = DEFAULT_TOLERANCE;
+    const char *kernelFilter = NULL;
+    const char *outputFilename = NULL;
+    const char *baselineFilename = NULL;
+    const char *note = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            usage(argv[0]);
+            exit(0);
+        }
+        else if (strcmp(argv[i], "--images") == 0 && i + 1 < argc)
+            context.nImages = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--epochs") == 0 && i + 1 < argc)
+            epochs = atol(argv[++i]);
+        else if (strcmp(argv[i], "--mod-file") == 0 && i + 1 < argc)
+            context.modFilename = argv[++i];
+        else if (strcmp(argv[i], "--satellite") == 0 && i + 1 < argc)
+            context.satellite = argv[++i][0];
+        else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc)
+            kernelFilter = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputFilename = argv[++i];
+        else if (strcmp(argv[i], "--note") == 0 && i + 1 < argc)
+            note = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baselineFilename = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else
+        {
+            printf("Unrecognized option %s\n", argv[i]);
+            usage(argv[0]);
+            exit(BENCH_ERROR);
+        }
+    }
+    if (context.nImages == 0 || runs < 1 || runs > BENCH_MAX_RUNS || epochs < MINIMUM_VELOCITY_EPOCHS || epochs > 31 * DEFAULT_EPOCHS || context.satellite < 'A' || context.satellite > 'C')
+    {
+        usage(argv[0]);
+        exit(BENCH_ERROR);
+    }
+
+    char modFilename[FILENAME_MAX] = {0};
+    if (context.modFilename == NULL)
+    {
+        const char *tmpDir = getenv("TMPDIR");
+        snprintf(modFilename, FILENAME_MAX, "%s/tracis_bench_%d.sp3", tmpDir != NULL ? tmpDir : "/tmp", (int)getpid());
+        OrbitModel orbit;
+        initOrbit(&orbit, context.satellite);
+        if (writeSp3File(&orbit, context.satellite, BENCH_MOD_START, (size_t)epochs, modFilename))
+        {
+            fprintf(stderr, "Could not write %s\n", modFilename);
+            exit(BENCH_ERROR);
+        }
+        context.modFilename = modFilename;
+    }
+
+    int status = prepareContext(&context);
+    if (status != BENCH_OK)
+        goto cleanup;
+
+    BenchResult results[MAX_KERNELS] = {0};
+    int nResults = 0;
+    double seconds[BENCH_MAX_RUNS];
+    double start = 0.0;
+    BenchResult *result = NULL;
+
+    printf("%zu images of %d pixels, %zu MOD records, %zu interpolation times, %d runs\n\n", context.nImages, PIXELS, context.ephem.nEphem, context.nTimes, runs);
+    printBenchHeader(stdout);
+    for (int k = 0; k < N_KERNELS; k++)
+    {
+        if (kernelFilter != NULL && strstr(kernels[k].name, kernelFilter) == NULL)
+            continue;
+        kernels[k].run(&context);
+        for (int r = 0; r < runs; r++)
+        {
+            start = benchSeconds();
+            kernels[k].run(&context);
+            seconds[r] = benchSeconds() - start;
+        }
+        result = &results[nResults++];
+        snprintf(result->name, BENCH_NAME_LENGTH, "%s", kernels[k].name);
+        result->unit = kernels[k].unit;
+        result->itemsPerRun = kernels[k].items(&context);
+        result->imagesPerRun = kernels[k].images ? context.nImages : 0;
+        summarizeRuns(result, seconds, runs);
+        printBenchResult(stdout, result);
+        fflush(stdout);
+    }
+    printf("\nchecksum %g\n", context.checksum);
+
+    if (outputFilename != NULL && writeBenchResults(outputFilename, results, nResults, runs, note))
+    {
+        fprintf(stderr, "Could not write %s\n", outputFilename);
+        status = BENCH_ERROR;
+        goto cleanup;
+    }
+
+    if (baselineFilename != NULL)
+    {
+        BenchBaseline baseline[MAX_KERNELS];
+        int nBaseline = readBenchBaseline(baselineFilename, baseline, MAX_KERNELS);
+        if (nBaseline < 0)
+        {
+            fprintf(stderr, "Could not read baseline %s\n", baselineFilename);
+            status = BENCH_ERROR;
+            goto cleanup;
+        }
+        printf("\n%-30s %10s %10s %9s\n", "kernel", "baseline", "best ns", "change %");
+        double change = 0.0;
+        for (int i = 0; i < nResults; i++)
+        {
+            for (int j = 0; j < nBaseline; j++)
+            {
+                if (strcmp(results[i].name, baseline[j].name) != 0 || baseline[j].minNs <= 0.0)
+                    continue;
+                change = 100.0 * (results[i].minNs - baseline[j].minNs) / baseline[j].minNs;
+                printf("%-30s %10.3f %10.3f %+9.1f%s\n", results[i].name, baseline[j].minNs, results[i].minNs, change, change > tolerance ? "  REGRESSION" : "");
+                if (change > tolerance)
+                    status = BENCH_REGRESSION;
+            }
+        }
+    }
+
+cleanup:
+    freeContext(&context);
+    if (modFilename[0] != '\0')
+        unlink(modFilename);
+
+    return status;
+}
@@ -0,0 +1,159 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/affinity.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "affinity.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define NUMA_SYSFS_DIR "/sys/devices/system/node"
+
+// From linux/mempolicy.h, to avoid depending on libnuma headers
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+
+// Parses a sysfs cpulist such as "0-3,8-11"
+static int parseCpuList(const char *list, cpu_set_t *cpus)
+{
+	CPU_ZERO(cpus);
+	int n = 0;
+	const char *p = list;
+	while (*p != '\0' && *p != '\n')
+	{
+		char *end = NULL;
+		long first = strtol(p, &end, 10);
+		if (end == p)
+			break;
+		long last = first;
+		p = end;
+		if (*p == '-')
+		{
+			p++;
+			last = strtol(p, &end, 10);
+			p = end;
+		}
+		for (long c = first; c <= last && c < CPU_SETSIZE; c++)
+		{
+			CPU_SET(c, cpus);
+			n++;
+		}
+		if (*p == ',')
+			p++;
+	}
+
+	return n;
+}
+
+static int compareInts(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+void readNumaTopology(NumaTopology *topology)
+{
+	topology->nNodes = 0;
+
+	int ids[MAX_NUMA_NODES];
+	int nIds = 0;
+	DIR *dir = opendir(NUMA_SYSFS_DIR);
+	if (dir != NULL)
+	{
+		struct dirent *entry = NULL;
+		while ((entry = readdir(dir)) != NULL && nIds < MAX_NUMA_NODES)
+		{
+			if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4]))
+				ids[nIds++] = atoi(entry->d_name + 4);
+		}
+		closedir(dir);
+	}
+	qsort(ids, nIds, sizeof(int), compareInts);
+
+	char filename[FILENAME_MAX];
+	char list[4096];
+	for (int i = 0; i < nIds; i++)
+	{
+		snprintf(filename, FILENAME_MAX, "%s/node%d/cpulist", NUMA_SYSFS_DIR, ids[i]);
+		FILE *f = fopen(filename, "r");
+		if (f == NULL)
+			continue;
+		bool gotList = fgets(list, sizeof(list), f) != NULL;
+		fclose(f);
+		// Memory-only nodes have no CPUs to run on
+		if (!gotList || parseCpuList(list, &topology->cpus[topology->nNodes]) == 0)
+			continue;
+		topology->nodeIds[topology->nNodes] = ids[i];
+		topology->nNodes++;
+	}
+
+	if (topology->nNodes == 0)
+	{
+		topology->nNodes = 1;
+		topology->nodeIds[0] = 0;
+		if (sched_getaffinity(0, sizeof(cpu_set_t), &topology->cpus[0]) != 0)
+		{
+			CPU_ZERO(&topology->cpus[0]);
+			long n = sysconf(_SC_NPROCESSORS_ONLN);
+			for (long c = 0; c < n && c < CPU_SETSIZE; c++)
+				CPU_SET(c, &topology->cpus[0]);
+		}
+	}
+
+	return;
+}
+
+void slotPlacement(const NumaTopology *topology, int slot, Placement *placement)
+{
+	placement->enabled = topology->nNodes > 0;
+	placement->node = -1;
+	placement->nodeId = -1;
+	CPU_ZERO(&placement->cpus);
+	if (!placement->enabled)
+		return;
+
+	placement->node = slot % topology->nNodes;
+	placement->nodeId = topology->nodeIds[placement->node];
+	placement->cpus = topology->cpus[placement->node];
+
+	return;
+}
+
+void applyPlacement(const Placement *placement)
+{
+	if (placement == NULL || !placement->enabled)
+		return;
+
+	// Failures leave the default placement, which is still correct
+	sched_setaffinity(0, sizeof(cpu_set_t), &placement->cpus);
+
+	unsigned long nodeMask[MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 1] = {0};
+	if (placement->nodeId >= 0 && placement->nodeId < MAX_NUMA_NODES)
+	{
+		nodeMask[placement->nodeId / (8 * sizeof(unsigned long))] |= 1UL << (placement->nodeId % (8 * sizeof(unsigned long)));
+		syscall(SYS_set_mempolicy, MPOL_BIND, nodeMask, (unsigned long)MAX_NUMA_NODES + 1);
+	}
+
+	return;
+}
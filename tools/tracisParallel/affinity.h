@@ -0,0 +1,60 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/affinity.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// NUMA placement of tracis processes: each slot runs on the CPUs of one
+// node and allocates its memory there
+
+#ifndef _TRACIS_PARALLEL_AFFINITY_H
+#define _TRACIS_PARALLEL_AFFINITY_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <sched.h>
+
+#define MAX_NUMA_NODES 64
+
+typedef struct NumaTopology
+{
+	int nNodes;
+	int nodeIds[MAX_NUMA_NODES];
+	cpu_set_t cpus[MAX_NUMA_NODES];
+} NumaTopology;
+
+typedef struct Placement
+{
+	bool enabled;
+	int node; // index into NumaTopology, -1 if not placed
+	int nodeId; // kernel node number
+	cpu_set_t cpus;
+} Placement;
+
+// Reads /sys/devices/system/node. Without NUMA information the machine is one node.
+void readNumaTopology(NumaTopology *topology);
+
+// Slots are spread round-robin over nodes
+void slotPlacement(const NumaTopology *topology, int slot, Placement *placement);
+
+// Called in the child between fork() and exec(), so uses system calls only
+void applyPlacement(const Placement *placement);
+
+#endif // _TRACIS_PARALLEL_AFFINITY_H
@@ -0,0 +1,116 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/concurrency.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "concurrency.h"
+
+#include <stdio.h>
+
+// Aggregate CPU times from the first line of /proc/stat
+static bool readCpuTimes(unsigned long long *iowait, unsigned long long *total)
+{
+	FILE *f = fopen("/proc/stat", "r");
+	if (f == NULL)
+		return false;
+
+	unsigned long long user = 0, nice = 0, system = 0, idle = 0, io = 0, irq = 0, softirq = 0, steal = 0;
+	int n = fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &user, &nice, &system, &idle, &io, &irq, &softirq, &steal);
+	fclose(f);
+	if (n < 5)
+		return false;
+
+	*iowait = io;
+	*total = user + nice + system + idle + io + irq + softirq + steal;
+
+	return true;
+}
+
+static int clampLevel(ConcurrencyController *controller, int level)
+{
+	if (level < controller->min)
+		level = controller->min;
+	if (level > controller->max)
+		level = controller->max;
+
+	return level;
+}
+
+static void startWindow(ConcurrencyController *controller, double now, int done)
+{
+	controller->windowStart = now;
+	controller->windowStartDone = done;
+	if (!readCpuTimes(&controller->windowStartIowait, &controller->windowStartTotal))
+	{
+		controller->windowStartIowait = 0;
+		controller->windowStartTotal = 0;
+	}
+
+	return;
+}
+
+void initConcurrency(ConcurrencyController *controller, int min, int max, int initial, int window, double now, int done)
+{
+	controller->min = min < 1 ? 1 : min;
+	controller->max = max < controller->min ? controller->min : max;
+	controller->level = clampLevel(controller, initial);
+	controller->window = window > 0 ? window : CONCURRENCY_DEFAULT_WINDOW;
+	controller->lastThroughput = -1.0;
+	controller->lastIowait = 0.0;
+	controller->lastChangeWasIncrease = false;
+	startWindow(controller, now, done);
+
+	return;
+}
+
+bool updateConcurrency(ConcurrencyController *controller, double now, int done)
+{
+	double elapsed = now - controller->windowStart;
+	if (elapsed < (double)controller->window)
+		return false;
+
+	unsigned long long iowait = 0;
+	unsigned long long total = 0;
+	double iowaitFraction = 0.0;
+	if (readCpuTimes(&iowait, &total) && total > controller->windowStartTotal)
+		iowaitFraction = (double)(iowait - controller->windowStartIowait) / (double)(total - controller->windowStartTotal);
+	double throughput = (double)(done - controller->windowStartDone) / elapsed * 3600.0;
+
+	int level = controller->level;
+	bool increase = false;
+	if (iowaitFraction > CONCURRENCY_IOWAIT_HIGH)
+		level = (int)((double)level * CONCURRENCY_DECREASE_FACTOR);
+	else if (controller->lastChangeWasIncrease && controller->lastThroughput > 0.0 && throughput < CONCURRENCY_THROUGHPUT_TOLERANCE * controller->lastThroughput)
+		// The last step up did not pay off
+		level = (int)((double)level * CONCURRENCY_DECREASE_FACTOR);
+	else
+	{
+		level++;
+		increase = true;
+	}
+	level = clampLevel(controller, level);
+
+	bool changed = level != controller->level;
+	controller->lastChangeWasIncrease = changed && increase;
+	controller->level = level;
+	controller->lastThroughput = throughput;
+	controller->lastIowait = iowaitFraction;
+	startWindow(controller, now, done);
+
+	return changed;
+}
@@ -0,0 +1,56 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/concurrency.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Additive-increase, multiplicative-decrease control of the number of
+// concurrent tracis processes. Each window, concurrency goes up by one
+// while throughput keeps up and the system is not waiting on I/O, and is
+// cut back when iowait is high or the last increase made throughput worse.
+
+#ifndef _TRACIS_PARALLEL_CONCURRENCY_H
+#define _TRACIS_PARALLEL_CONCURRENCY_H
+
+#include <stdbool.h>
+
+#define CONCURRENCY_DEFAULT_WINDOW 60 // seconds between adjustments
+#define CONCURRENCY_IOWAIT_HIGH 0.20 // fraction of CPU time
+#define CONCURRENCY_DECREASE_FACTOR 0.75
+#define CONCURRENCY_THROUGHPUT_TOLERANCE 0.95 // fraction of previous window's throughput counted as keeping up
+
+typedef struct ConcurrencyController
+{
+	int min;
+	int max;
+	int level;
+	int window;
+	double windowStart;
+	int windowStartDone;
+	unsigned long long windowStartIowait;
+	unsigned long long windowStartTotal;
+	double lastThroughput; // jobs per hour, -1 if not measured yet
+	double lastIowait; // fraction
+	bool lastChangeWasIncrease;
+} ConcurrencyController;
+
+void initConcurrency(ConcurrencyController *controller, int min, int max, int initial, int window, double now, int done);
+
+// Call regularly with the number of jobs finished so far. Returns true if the level changed.
+bool updateConcurrency(ConcurrencyController *controller, double now, int done);
+
+#endif // _TRACIS_PARALLEL_CONCURRENCY_H
@@ -0,0 +1,194 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/jobs.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "jobs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+int initJobQueue(JobQueue *queue, const char *startDate, const char *endDate)
+{
+	queue->jobs = NULL;
+	queue->nJobs = 0;
+	queue->next = 0;
+	queue->days = 0;
+
+	if (strlen(startDate) != 8 || strlen(endDate) != 8)
+		return JOBS_DATE;
+
+	char *d1 = strdup(startDate);
+	char *d2 = strdup(endDate);
+	int days = dayCount(d1, d2);
+	free(d1);
+	free(d2);
+
+	queue->jobs = calloc(NUM_SATELLITES * days + 1, sizeof(Job));
+	if (queue->jobs == NULL)
+		return JOBS_MEM;
+
+	char *date = strdup(startDate);
+	for (int sat = 0; sat < NUM_SATELLITES; sat++)
+	{
+		sprintf(date, "%s", startDate);
+		for (int d = 0; d < days; d++)
+		{
+			Job *job = &queue->jobs[sat * days + d];
+			job->satellite = sat;
+			ymd(date, &job->year, &job->month, &job->day);
+			incrementDate(date);
+		}
+	}
+	free(date);
+
+	queue->days = days;
+	queue->nJobs = NUM_SATELLITES * days;
+
+	return JOBS_OK;
+}
+
+void freeJobQueue(JobQueue *queue)
+{
+	free(queue->jobs);
+	queue->jobs = NULL;
+	queue->nJobs = 0;
+	queue->next = 0;
+
+	return;
+}
+
+bool nextJob(JobQueue *queue, Job *job)
+{
+	if (queue->next >= queue->nJobs)
+		return false;
+
+	*job = queue->jobs[queue->next++];
+
+	return true;
+}
+
+char satelliteLetter(int satellite)
+{
+	return "ABC"[satellite];
+}
+
+void jobName(const Job *job, char *name)
+{
+	snprintf(name, JOB_NAME_LENGTH, "%c%04d%02d%02d", satelliteLetter(job->satellite), job->year, job->month, job->day);
+
+	return;
+}
+
+bool parseJobName(const char *name, Job *job)
+{
+	if (strlen(name) != JOB_NAME_LENGTH - 1 || name[0] < 'A' || name[0] > 'C')
+		return false;
+	for (int i = 1; i < JOB_NAME_LENGTH - 1; i++)
+	{
+		if (!isdigit(name[i]))
+			return false;
+	}
+
+	char date[9] = {0};
+	memcpy(date, name + 1, 8);
+	job->satellite = name[0] - 'A';
+	ymd(date, &job->year, &job->month, &job->day);
+
+	return true;
+}
+
+void ymd(char *date, int *y, int *m, int *d)
+{
+	char *dt = strdup(date);
+
+	*d = atoi(dt + 6);
+	dt[6] = 0;
+	*m = atoi(dt + 4);
+	dt[4] = 0;
+	*y = atoi(dt);
+
+	free(dt);
+
+	return;
+
+}
+
+int dayCount(char *startDate, char *endDate)
+{
+	int startDay = atoi(startDate+6);
+	startDate[6] = 0;
+	int startMonth = atoi(startDate+4);
+	startDate[4] = 0;
+	int startYear = atoi(startDate);
+
+	int endDay = atoi(endDate+6);
+	endDate[6] = 0;
+	int endMonth = atoi(endDate+4);
+	endDate[4] = 0;
+	int endYear = atoi(endDate);
+
+	struct tm d = {0};
+	d.tm_year = startYear - 1900;
+	d.tm_mon = startMonth - 1;
+	d.tm_mday = startDay;
+	time_t seconds = timegm(&d);
+
+	struct tm e = {0};
+	e.tm_year = endYear - 1900;
+	e.tm_mon = endMonth - 1;
+	e.tm_mday = endDay;
+	e.tm_hour = 23;
+	e.tm_min = 59;
+	e.tm_sec = 59;
+
+	time_t end = timegm(&e);
+
+	int count = 0;
+	while (seconds < end)
+	{
+		d.tm_mday = d.tm_mday + 1;
+		seconds = timegm(&d);
+		count++;
+	}
+
+	return count;
+
+}
+
+void incrementDate(char *date)
+{
+	int startDay = atoi(date+6);
+	date[6] = 0;
+	int startMonth = atoi(date+4);
+	date[4] = 0;
+	int startYear = atoi(date);
+
+	struct tm d = {0};
+	d.tm_year = startYear - 1900;
+	d.tm_mon = startMonth - 1;
+	d.tm_mday = startDay + 1;
+	timegm(&d);
+	sprintf(date, "%04d%02d%02d", d.tm_year + 1900, d.tm_mon+1, d.tm_mday);
+
+	return;
+
+}
@@ -0,0 +1,67 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/jobs.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TRACIS_PARALLEL_JOBS_H
+#define _TRACIS_PARALLEL_JOBS_H
+
+#include <stdbool.h>
+
+#define NUM_SATELLITES 3
+
+#define JOB_NAME_LENGTH 10 // Xyyyymmdd plus terminating null
+
+// One tracis run: a satellite (0, 1, 2 for A, B, C) and a day
+typedef struct Job
+{
+	int satellite;
+	int year;
+	int month;
+	int day;
+} Job;
+
+// Satellite-major list of jobs for the inclusive date range
+typedef struct JobQueue
+{
+	Job *jobs;
+	int nJobs;
+	int next;
+	int days;
+} JobQueue;
+
+enum JOBS_STATUS
+{
+	JOBS_OK = 0,
+	JOBS_MEM,
+	JOBS_DATE
+};
+
+int initJobQueue(JobQueue *queue, const char *startDate, const char *endDate);
+void freeJobQueue(JobQueue *queue);
+bool nextJob(JobQueue *queue, Job *job);
+
+char satelliteLetter(int satellite);
+void jobName(const Job *job, char *name);
+bool parseJobName(const char *name, Job *job);
+
+void ymd(char *date, int *y, int *m, int *d);
+int dayCount(char *startDate, char *endDate);
+void incrementDate(char *date);
+
+#endif // _TRACIS_PARALLEL_JOBS_H
@@ -21,6 +21,15 @@
 // Based on tiictParallel from TII Ion Drift Processor
 
 #include "tracis_settings.h"
+#include "status.h"
+#include "jobs.h"
+#include "spool.h"
+#include "workers.h"
+#include "planner.h"
+#include "affinity.h"
+#include "concurrency.h"
+#include "calibration_segment.h"
+#include "trace_events.h"
 
 #include <stdio.h>
 
@@ -29,22 +38,30 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include <pthread.h>
 #include <signal.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
 
 #include <time.h>
 #include <curses.h>
 
 
-#define TRACIS_PARALLEL_SOFTWARE_VERSION "1.0"
+#define TRACIS_PARALLEL_SOFTWARE_VERSION "1.1"
 
 #define THREAD_MANAGER_WAIT 100000 // uSeconds
 
 #define MAX_THREADS 38
 
-enum STATUS 
+#define DEFAULT_STATUS_INTERVAL 60 // seconds between status records
+#define MAX_TRACIS_OPTIONS 4
+
+#define SPOOL_POLL_INTERVAL 5 // seconds between claim attempts when the spool has nothing to hand out
+
+enum STATUS
 {
 	STATUS_OK = 0,
 	STATUS_PERMISSION,
@@ -55,38 +72,71 @@ typedef struct CommandArgs
 {
 	bool threadRunning;
 	int returnValue;
-	char *satLetter;
-	int year;
-	int month;
-	int day;
+	Job job;
+	char satLetter[2];
 	char *modDir;
 	char *outputDir;
+	Worker *worker;
+	Placement *placement;
+	char **tracisOptions; // NULL-terminated
+	const char *tracisOptionString;
+	TraceLog *trace;
+	int slot;
+	double wallTime;
+	long peakRssKb;
+	// Process group of a one-shot tracis run, 0 when none is running
+	volatile pid_t childPid;
+	// Set when another spool instance has taken over the job
+	volatile bool leaseLost;
 } CommandArgs;
 
-void ymd(char *date, int *y, int *m, int *d);
-int dayCount(char *startDate, char *endDate);
-void incrementDate(char *date);
-
 static int rows = 0;
 static int cols = 0;
 
+static volatile sig_atomic_t quitRequested = 0;
+
 #define TRACIS_LABEL 0, 0
 #define SAT_ORIGIN 1,1
 #define START_DATE_ORIGIN 2,1
 #define END_DATE_ORIGIN 3,1
 #define START_TIME_ORIGIN 5,1
 #define PROCESSING_TIME_ORIGIN 6, 1
-#define PROCESSING_STATUS_ORIGIN 8,3 
-#define KEYBOARD_ORIGIN 10,2
+#define PROCESSING_STATUS_ORIGIN 8,3
+#define THROUGHPUT_ORIGIN 9,3
+#define KEYBOARD_ORIGIN 11,2
 
 void initScreen(void);
 
 void *runThread(void *a);
 
+int runCommand(const char *command, int *exitStatus, long *peakRssKb, const Placement *placement, volatile pid_t *childPid);
+
+void requestQuit(int sig);
+
 void cleanup(CommandArgs *args);
 
+void usage(const char *name);
+
 int main(int argc, char *argv[])
 {
+	bool headless = false;
+	char *statusFilename = NULL;
+	char *summaryFilename = NULL;
+	char *spoolDir = NULL;
+	int leaseSeconds = SPOOL_DEFAULT_LEASE;
+	bool persistent = false;
+	bool plan = false;
+	bool numa = false;
+	bool sharedCalibration = false;
+	bool adaptive = false;
+	int minThreads = 1;
+	int maxThreads = MAX_THREADS;
+	int adaptiveWindow = CONCURRENCY_DEFAULT_WINDOW;
+	char *gapReportFilename = NULL;
+	char *traceFilename = NULL;
+	int statusInterval = DEFAULT_STATUS_INTERVAL;
+	char *positionalArgs[5] = {NULL};
+	int nPositionalArgs = 0;
 
     for (int i = 1; i < argc; i++)
     {
@@ -99,39 +149,231 @@ int main(int argc, char *argv[])
             fprintf(stdout, "under the terms of the GNU General Public License.\n");
             exit(0);
         }
+		else if (strcmp(argv[i], "--headless") == 0)
+			headless = true;
+		else if (strncmp(argv[i], "--status-file=", 14) == 0)
+			statusFilename = argv[i] + 14;
+		else if (strncmp(argv[i], "--status-interval=", 18) == 0)
+			statusInterval = atoi(argv[i] + 18);
+		else if (strncmp(argv[i], "--summary-file=", 15) == 0)
+			summaryFilename = argv[i] + 15;
+		else if (strcmp(argv[i], "--plan") == 0)
+			plan = true;
+		else if (strncmp(argv[i], "--gap-report=", 13) == 0)
+		{
+			plan = true;
+			gapReportFilename = argv[i] + 13;
+		}
+		else if (strncmp(argv[i], "--adaptive=", 11) == 0)
+		{
+			adaptive = true;
+			if (sscanf(argv[i] + 11, "%d:%d", &minThreads, &maxThreads) != 2)
+			{
+				printf("Expected --adaptive=min:max\n");
+				exit(1);
+			}
+		}
+		else if (strncmp(argv[i], "--adaptive-window=", 18) == 0)
+			adaptiveWindow = atoi(argv[i] + 18);
+		else if (strcmp(argv[i], "--numa") == 0)
+			numa = true;
+		else if (strcmp(argv[i], "--persistent") == 0)
+			persistent = true;
+		else if (strcmp(argv[i], "--shared-calibration") == 0)
+			sharedCalibration = true;
+		else if (strncmp(argv[i], "--spool=", 8) == 0)
+			spoolDir = argv[i] + 8;
+		else if (strncmp(argv[i], "--trace=", 8) == 0)
+			traceFilename = argv[i] + 8;
+		else if (strncmp(argv[i], "--lease=", 8) == 0)
+			leaseSeconds = atoi(argv[i] + 8);
+		else if (strncmp(argv[i], "--", 2) == 0)
+		{
+			printf("Unrecognized option %s\n", argv[i]);
+			usage(argv[0]);
+			exit(1);
+		}
+		else
+		{
+			if (nPositionalArgs < 5)
+				positionalArgs[nPositionalArgs] = argv[i];
+			nPositionalArgs++;
+		}
     }
 
-	if (argc !=  6)
+	if (nPositionalArgs != 5)
 	{
-		printf("usage:\t%s startyyyymmdd endyyyymmdd modFileDir outputDir nthreads\n\t\tparallel processes Swarm TII L0 data to generate TRACIS product for specified satellite and date range.\n", argv[0]);
-		printf("\t%s --about\n\t\tprints copyright and license information.\n", argv[0]);
+		usage(argv[0]);
 		exit(0);
 	}
 
-	initScreen();
-	clear();
-
-	char *startDate = argv[1];
-	char *endDate = argv[2];
-	char *modDir = argv[3];
-	char *outputDir = argv[4];
-	int nThreads = atoi(argv[5]);
+	char *startDate = positionalArgs[0];
+	char *endDate = positionalArgs[1];
+	char *modDir = positionalArgs[2];
+	char *outputDir = positionalArgs[3];
+	int nThreads = atoi(positionalArgs[4]);
 	if (nThreads > MAX_THREADS)
 	{
 		nThreads = MAX_THREADS;
 	}
+	if (nThreads < 1)
+	{
+		nThreads = 1;
+	}
+	// With --adaptive, nthreads is the starting level and there is a slot for each of up to max processes
+	int activeThreads = nThreads;
+	if (adaptive)
+	{
+		if (maxThreads > MAX_THREADS)
+			maxThreads = MAX_THREADS;
+		if (minThreads < 1)
+			minThreads = 1;
+		if (minThreads > maxThreads)
+			minThreads = maxThreads;
+		activeThreads = nThreads < minThreads ? minThreads : (nThreads > maxThreads ? maxThreads : nThreads);
+		nThreads = maxThreads;
+	}
+	if (statusInterval < 1)
+	{
+		statusInterval = 1;
+	}
+	if (leaseSeconds < 1)
+	{
+		leaseSeconds = SPOOL_DEFAULT_LEASE;
+	}
+
+	JobQueue queue = {0};
+	if (initJobQueue(&queue, startDate, endDate) != JOBS_OK)
+	{
+		printf("Could not set up jobs for %s to %s.\n", startDate, endDate);
+		exit(EXIT_FAILURE);
+	}
+
+	// Only days with inputs, and without existing output, are handed out
+	PlanCounts planCounts = {0};
+	if (plan)
+	{
+		int *reasons = calloc(queue.nJobs + 1, sizeof(int));
+		// tracis reads L0 files from its working directory
+		if (reasons == NULL || planJobs(&queue, modDir, ".", outputDir, reasons, &planCounts) != PLAN_OK)
+		{
+			printf("Could not check input availability.\n");
+			exit(EXIT_FAILURE);
+		}
+		char defaultGapReportFilename[FILENAME_MAX] = {0};
+		if (gapReportFilename == NULL)
+		{
+			snprintf(defaultGapReportFilename, FILENAME_MAX, "%s/tracisParallel_%s_%s_gaps.txt", outputDir, startDate, endDate);
+			gapReportFilename = defaultGapReportFilename;
+		}
+		if (writeGapReport(gapReportFilename, &queue, reasons, &planCounts) != PLAN_OK)
+			fprintf(stderr, "Could not write gap report to %s\n", gapReportFilename);
+		pruneJobQueue(&queue, reasons);
+		free(reasons);
+	}
+
+	Spool spoolStorage = {0};
+	Spool *spool = NULL;
+	if (spoolDir != NULL)
+	{
+		// Seeding may wait on another instance, so do it before taking over the terminal
+		if (initSpool(&spoolStorage, spoolDir, leaseSeconds, &queue) != SPOOL_OK)
+		{
+			printf("Could not set up job spool in %s.\n", spoolDir);
+			exit(EXIT_FAILURE);
+		}
+		spool = &spoolStorage;
+	}
 
-	char *date = strdup(startDate);
-	char *d1 = strdup(startDate);
-	char *d2 = strdup(endDate);
-	int days = dayCount(d1, d2);
-	free(d1);
-	free(d2);
+	FILE *statusFile = NULL;
+	if (statusFilename != NULL)
+	{
+		statusFile = fopen(statusFilename, "a");
+		if (statusFile == NULL)
+		{
+			printf("Could not open status file %s.\n", statusFilename);
+			exit(EXIT_FAILURE);
+		}
+	}
+	else if (headless)
+	{
+		statusFile = stdout;
+	}
+
+	// tracis processes append their own spans to the same trace file
+	TraceLog traceLog = {0};
+	TraceLog *trace = NULL;
+	char traceFullFilename[FILENAME_MAX] = {0};
+	char *tracisOptions[MAX_TRACIS_OPTIONS + 1] = {NULL};
+	int nTracisOptions = 0;
+	// Workers come and go during the run, so the segment is removed here at exit
+	if (sharedCalibration)
+		tracisOptions[nTracisOptions++] = "--keep-shared-calibration";
+	if (traceFilename != NULL)
+	{
+		if (openTraceLog(&traceLog, traceFilename) != TRACE_OK || realpath(traceFilename, traceFullFilename) == NULL)
+		{
+			printf("Could not open trace file %s.\n", traceFilename);
+			exit(EXIT_FAILURE);
+		}
+		trace = &traceLog;
+		traceProcessName(trace, "tracisParallel");
+		tracisOptions[nTracisOptions++] = "--trace";
+		tracisOptions[nTracisOptions++] = traceFullFilename;
+	}
+	char tracisOptionString[FILENAME_MAX + 64] = {0};
+	for (int i = 0; i < nTracisOptions; i++)
+	{
+		strcat(tracisOptionString, tracisOptions[i]);
+		strcat(tracisOptionString, " ");
+	}
+
+	signal(SIGINT, requestQuit);
+	signal(SIGTERM, requestQuit);
+
+	NumaTopology topology = {0};
+	Placement placements[MAX_THREADS] = {0};
+	if (numa)
+	{
+		readNumaTopology(&topology);
+		for (int i = 0; i < nThreads; i++)
+			slotPlacement(&topology, i, &placements[i]);
+	}
+
+	char slotName[32];
+	for (int i = 0; i < nThreads; i++)
+	{
+		snprintf(slotName, sizeof slotName, "slot %d", i);
+		traceThreadName(trace, i, slotName);
+	}
+
+	Worker workers[MAX_THREADS] = {0};
+	if (persistent)
+	{
+		// A worker that dies mid-job must not take tracisParallel with it.
+		// Slots above the starting level get their worker when first used.
+		signal(SIGPIPE, SIG_IGN);
+		for (int i = 0; i < activeThreads; i++)
+		{
+			if (startWorker(&workers[i], numa ? &placements[i] : NULL, tracisOptions) != WORKER_OK)
+			{
+				printf("Could not start tracis worker %d.\n", i);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	if (!headless)
+	{
+		initScreen();
+		clear();
+	}
 
 	CommandArgs *commandArgs = calloc(nThreads, sizeof(CommandArgs));
 	if (commandArgs == NULL)
 	{
-		endwin();
+		if (!headless)
+			endwin();
 		printf("Could not calloc memory for thread arguments.\n");
 		exit(EXIT_FAILURE);
 	}
@@ -145,7 +387,8 @@ int main(int argc, char *argv[])
 	int status = pthread_attr_init(&attr);
 	if (status)
 	{
-		endwin();		
+		if (!headless)
+			endwin();
 		printf("Could not init pthread attributes.\n");
 		exit(EXIT_FAILURE);
 	}
@@ -158,27 +401,51 @@ int main(int argc, char *argv[])
 	int minutes = 0;
 	int hours = 0;
 
-	char *satellites[3] = {"A", "B", "C"};
-
+	// One job per satellite-day: all days for Swarm A are queued first, then B, then C.
+	// With a spool, jobs come from the shared directory instead, in the same order.
+	int nJobs = queue.nJobs;
 	int completed = 0;
-	int allCompleted[3] = {0};
-	int queued = 0;	
+	int running = 0;
+	bool moreJobs = true;
+	double lastClaimFailure = -SPOOL_POLL_INTERVAL;
+	double lastHeartbeat = 0.0;
+	int reclaimed = 0;
+	SpoolCounts spoolCounts = {0};
+	Job job = {0};
+
+	RunMetrics metrics = {0};
+	initRunMetrics(&metrics, nJobs, statusFile);
+	if (numa)
+		setRunNodes(&metrics, &topology);
+	ConcurrencyController controller = {0};
+	if (adaptive)
+		initConcurrency(&controller, minThreads, maxThreads, activeThreads, adaptiveWindow, metrics.startTime, 0);
+	metrics.concurrency = activeThreads;
+	double lastStatusTime = metrics.startTime;
+	lastHeartbeat = metrics.startTime;
+	if (plan)
+		reportPlan(&metrics, planCounts.runnable, planCounts.noMod, planCounts.noL0, planCounts.done);
+	reportStatus(&metrics);
+	if (spool != NULL)
+	{
+		spoolCountJobs(spool, &spoolCounts);
+		reportSpool(&metrics, spool->dir, spoolCounts.todo, spoolCounts.running, spoolCounts.done, spoolCounts.failed, reclaimed);
+	}
 
+	char latestSatellite = ' ';
 	int latestYear = 0;
 	int latestMonth = 0;
 	int latestDay = 0;
 
 	bool quit = false;
 
-	for (int sat = 0; sat < 3; sat++)
+	int keyboard = 0;
+
+	if (!headless)
 	{
-		free(date);
-		date = strdup(startDate);
-		completed = 0;
-		queued =0;
 		erase();
         mvprintw(TRACIS_LABEL, "Processing TRACIS version %s", EXPORT_VERSION_STRING);
-		mvprintw(SAT_ORIGIN, "Swarm %s: %d threads", satellites[sat], nThreads);
+		mvprintw(SAT_ORIGIN, "Swarm %c: %d threads", satelliteLetter(queue.nJobs > 0 ? queue.jobs[0].satellite : 0), nThreads);
 		mvprintw(START_DATE_ORIGIN, "From: %s\n", startDate);
 		mvprintw(END_DATE_ORIGIN, "  To: %s\n", endDate);
 		mvprintw(START_TIME_ORIGIN, "Started: %4d%02d%02d %02d:%02d:%02d", now->tm_year+1900, now->tm_mon+1, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec);
@@ -187,185 +454,242 @@ int main(int argc, char *argv[])
 		mvprintw(KEYBOARD_ORIGIN, "[q] - quit");
 		clrtobot();
 		refresh();
+	}
 
-		int keyboard = 0;
-		int year = 0;
-		int month = 0;
-		int day = 0;
-
-		while (completed < days)
+	while (moreJobs || running > 0)
+	{
+		for (int i = 0; i < nThreads; i++)
 		{
-			for (int i = 0; i < nThreads && completed < days; i++)
+			if (!commandArgs[i].threadRunning)
 			{
-				if (!commandArgs[i].threadRunning)
+				// Get return value from completed thread if applicable
+				if (threadIds[i] > 0)
 				{
-					// Get return value from completed thread if applicable
-					if (threadIds[i] > 0)
+					status = pthread_join(threadIds[i], NULL);
+					if (status == 0)
 					{
-						status = pthread_join(threadIds[i], NULL);
-						if (status == 0)
-						{
-							completed++;
-							allCompleted[sat] = completed;
-							commandArgs[i].threadRunning = false;
-							latestYear = commandArgs[i].year;
-							latestMonth = commandArgs[i].month;
-							latestDay = commandArgs[i].day;
+						completed++;
+						running--;
+						commandArgs[i].threadRunning = false;
+						latestSatellite = commandArgs[i].satLetter[0];
+						latestYear = commandArgs[i].job.year;
+						latestMonth = commandArgs[i].job.month;
+						latestDay = commandArgs[i].job.day;
+						// A job whose lease was lost belongs to the instance now running it
+						bool lost = commandArgs[i].leaseLost;
+						if (spool != NULL && !lost)
+							lost = spoolFinishJob(spool, &commandArgs[i].job, jobSucceeded(commandArgs[i].returnValue)) == SPOOL_LOST_LEASE;
+						if (lost)
+							recordJobLost(&metrics, commandArgs[i].satLetter, commandArgs[i].job.year, commandArgs[i].job.month, commandArgs[i].job.day, i);
+						else
+							recordJobEnd(&metrics, commandArgs[i].job.satellite, commandArgs[i].satLetter, commandArgs[i].job.year, commandArgs[i].job.month, commandArgs[i].job.day, i, numa ? placements[i].node : -1, commandArgs[i].wallTime, commandArgs[i].peakRssKb, commandArgs[i].returnValue);
+						if (!headless)
 							clrtoeol();
-							threadIds[i] = 0;
-						}
-					}
-					// start a new thread
-					if (queued < days)
-					{
-						commandArgs[i].threadRunning = true;
-						commandArgs[i].satLetter = satellites[sat];
-						commandArgs[i].modDir = modDir;
-						commandArgs[i].outputDir = outputDir;
-						ymd(date, &year, &month, &day);
-						commandArgs[i].year = year;
-						commandArgs[i].month = month;
-						commandArgs[i].day = day;
-						commandArgs[i].returnValue = 0;
-						pthread_create(&threadIds[i], &attr, &runThread, (void*) &commandArgs[i]);
-						incrementDate(date);
-						queued++;
+						threadIds[i] = 0;
 					}
 				}
+				// start a new thread
+				if (!moreJobs || i >= activeThreads)
+					continue;
+				if (spool == NULL)
+					moreJobs = nextJob(&queue, &job);
+				else if (monotonicSeconds() - lastClaimFailure < SPOOL_POLL_INTERVAL)
+					continue;
+				else if (!spoolClaimJob(spool, &job))
+				{
+					// Other nodes' jobs may still come back if their leases expire
+					lastClaimFailure = monotonicSeconds();
+					reclaimed += spoolReclaimExpiredJobs(spool);
+					moreJobs = !spoolDrained(spool);
+					continue;
+				}
+				if (!moreJobs)
+					continue;
+				commandArgs[i].threadRunning = true;
+				commandArgs[i].job = job;
+				commandArgs[i].satLetter[0] = satelliteLetter(job.satellite);
+				commandArgs[i].satLetter[1] = '\0';
+				commandArgs[i].modDir = modDir;
+				commandArgs[i].outputDir = outputDir;
+				commandArgs[i].worker = persistent ? &workers[i] : NULL;
+				commandArgs[i].placement = numa ? &placements[i] : NULL;
+				commandArgs[i].tracisOptions = tracisOptions;
+				commandArgs[i].tracisOptionString = tracisOptionString;
+				commandArgs[i].trace = trace;
+				commandArgs[i].slot = i;
+				commandArgs[i].returnValue = 0;
+				commandArgs[i].wallTime = 0.0;
+				commandArgs[i].peakRssKb = 0;
+				commandArgs[i].childPid = 0;
+				commandArgs[i].leaseLost = false;
+				pthread_create(&threadIds[i], &attr, &runThread, (void*) &commandArgs[i]);
+				recordJobStart(&metrics);
+				running++;
+				if (!headless)
+					mvprintw(SAT_ORIGIN, "Swarm %s: %d threads", commandArgs[i].satLetter, nThreads);
+			}
+		}
+		if (spool != NULL && monotonicSeconds() - lastHeartbeat >= (double)spool->leaseSeconds / 4.0)
+		{
+			for (int k = 0; k < nThreads; k++)
+			{
+				if (threadIds[k] == 0 || commandArgs[k].leaseLost || spoolHeartbeat(spool, &commandArgs[k].job) != SPOOL_LOST_LEASE)
+					continue;
+				// Another instance reclaimed the job after a missed heartbeat and may be
+				// writing the same products. Stop this copy; its result is discarded.
+				commandArgs[k].leaseLost = true;
+				if (persistent)
+					signalWorker(&workers[k], SIGTERM);
+				else if (commandArgs[k].childPid > 0)
+					kill(-commandArgs[k].childPid, SIGTERM);
 			}
-			currentTime = time(NULL);
-			t = (long)currentTime - (long)startTime;
-			hours = t / 3600;
-			minutes = (t - 3600*hours) / 60;
-			seconds = t - 3600*hours - 60 * minutes;
+			reclaimed += spoolReclaimExpiredJobs(spool);
+			lastHeartbeat = monotonicSeconds();
+		}
+		if (adaptive)
+		{
+			bool changed = updateConcurrency(&controller, monotonicSeconds(), metrics.done);
+			// Jobs above a lowered level run to completion; their slots then stay idle
+			activeThreads = controller.level;
+			metrics.concurrency = activeThreads;
+			metrics.iowait = controller.lastIowait;
+			if (changed)
+				reportStatus(&metrics);
+		}
 
+		currentTime = time(NULL);
+		t = (long)currentTime - (long)startTime;
+		hours = t / 3600;
+		minutes = (t - 3600*hours) / 60;
+		seconds = t - 3600*hours - 60 * minutes;
+
+		if (!headless)
+		{
 			keyboard = getch();
-			if (keyboard != ERR)
+			if (keyboard == 'q')
+				quitRequested = 1;
+		}
+		if (quitRequested)
+		{
+			for (int k = 0; k < nThreads; k++)
 			{
-				switch (keyboard)
+				if (threadIds[k] == 0)
+					continue;
+				if (persistent)
 				{
-					case 'q':
-						for (int k = 0; k < nThreads; k++)
-						{
-							if (threadIds[k] > 0)
-							{
-								pthread_cancel(threadIds[k]);
-								pthread_join(threadIds[k], NULL);
-							}
-						}
-						quit = true;
-						goto exit;
-						break;
-					default:
-						break;
+					// Cancelling a thread blocked in fgets() on the worker's results can leave
+					// the stdio lock held for reapWorker(). Ending the worker gives the thread
+					// EOF instead. Keep signalling in case the thread was just starting a worker.
+					while (commandArgs[k].threadRunning)
+					{
+						signalWorker(&workers[k], SIGTERM);
+						usleep(THREAD_MANAGER_WAIT);
+					}
 				}
+				else
+					pthread_cancel(threadIds[k]);
+				pthread_join(threadIds[k], NULL);
+			}
+			quit = true;
+			goto exit;
+		}
+
+		if (monotonicSeconds() - lastStatusTime >= (double)statusInterval)
+		{
+			reportStatus(&metrics);
+			if (spool != NULL)
+			{
+				spoolCountJobs(spool, &spoolCounts);
+				reportSpool(&metrics, spool->dir, spoolCounts.todo, spoolCounts.running, spoolCounts.done, spoolCounts.failed, reclaimed);
 			}
+			lastStatusTime = monotonicSeconds();
+		}
+
+		if (!headless)
+		{
 			mvprintw(PROCESSING_TIME_ORIGIN, "Total time: %02d:%02d:%02d", hours, minutes, seconds);
 			clrtobot();
-			mvprintw(PROCESSING_STATUS_ORIGIN, "%d/%d processed (%4.1f%%). Latest: %4d%02d%02d", completed, days, (float)completed / (float)days * 100.0, latestYear, latestMonth, latestDay);
+			if (spool != NULL)
+				mvprintw(PROCESSING_STATUS_ORIGIN, "%d processed here, %d/%d left in spool. Latest: %c%4d%02d%02d", completed, spoolCounts.todo + spoolCounts.running, spoolCounts.todo + spoolCounts.running + spoolCounts.done + spoolCounts.failed, latestSatellite, latestYear, latestMonth, latestDay);
+			else
+				mvprintw(PROCESSING_STATUS_ORIGIN, "%d/%d processed (%4.1f%%). Latest: %c%4d%02d%02d", completed, nJobs, (float)completed / (float)nJobs * 100.0, latestSatellite, latestYear, latestMonth, latestDay);
+			clrtobot();
+			if (adaptive)
+				mvprintw(THROUGHPUT_ORIGIN, "%.1f days/hour, %d failed, %d/%d processes (%.0f%% iowait)", daysPerHour(&metrics), metrics.failed, activeThreads, nThreads, 100.0 * controller.lastIowait);
+			else
+				mvprintw(THROUGHPUT_ORIGIN, "%.1f days/hour, %d failed", daysPerHour(&metrics), metrics.failed);
 			clrtobot();
 			mvprintw(KEYBOARD_ORIGIN, "[q] - quit");
 			clrtobot();
 			refresh();
-			usleep(THREAD_MANAGER_WAIT);
 		}
+		usleep(THREAD_MANAGER_WAIT);
 	}
 exit:
-	status = pthread_attr_destroy(&attr);
-	free(commandArgs);
-	free(date);
-	endwin();
-	printf("Days processed:\n");
-	printf("\tSwarm A: %d / %d\n", allCompleted[0], days);
-	printf("\tSwarm B: %d / %d\n", allCompleted[1], days);
-	printf("\tSwarm C: %d / %d\n", allCompleted[2], days);
-	printf("Total time: %02d:%02d:%02d\n", hours, minutes, seconds);
-
-	if (quit == true)
+	reportStatus(&metrics);
+	if (spool != NULL)
 	{
-		printf("--> Processes may still be running. Use\n\t'for i in `pidof tracis`;do kill -9 $i;done'\nto kill them. There may be zip processes running as well.\n");
+		spoolCountJobs(spool, &spoolCounts);
+		reportSpool(&metrics, spool->dir, spoolCounts.todo, spoolCounts.running, spoolCounts.done, spoolCounts.failed, reclaimed);
 	}
-	return 0;
-
-}
 
-void ymd(char *date, int *y, int *m, int *d)
-{
-	char *dt = strdup(date);
-
-	*d = atoi(dt + 6);
-	dt[6] = 0;
-	*m = atoi(dt + 4);
-	dt[4] = 0;
-	*y = atoi(dt);
+	status = pthread_attr_destroy(&attr);
+	if (persistent)
+	{
+		for (int i = 0; i < nThreads; i++)
+		{
+			if (quit)
+				killWorker(&workers[i]);
+			else
+				stopWorker(&workers[i]);
+		}
+	}
+	free(commandArgs);
+	if (!headless)
+		endwin();
 
-	free(dt);
+	// Processes still mapping the segment keep it until they exit
+	if (sharedCalibration)
+		shm_unlink(CALIBRATION_SEGMENT_NAME);
+	if (trace != NULL)
+		closeTraceLog(trace);
 
-	return;
+	char defaultSummaryFilename[FILENAME_MAX] = {0};
+	if (summaryFilename == NULL)
+	{
+		struct tm *started = gmtime(&startTime);
+		snprintf(defaultSummaryFilename, FILENAME_MAX, "%s/tracisParallel_%s_%s_%4d%02d%02dT%02d%02d%02d_summary.json", outputDir, startDate, endDate, started->tm_year+1900, started->tm_mon+1, started->tm_mday, started->tm_hour, started->tm_min, started->tm_sec);
+		summaryFilename = defaultSummaryFilename;
+	}
+	if (writeRunSummary(&metrics, summaryFilename, startDate, endDate, nThreads, quit))
+		fprintf(stderr, "Could not write run summary to %s\n", summaryFilename);
 
-}
+	if (!headless)
+	{
+		printf("Days processed:\n");
+		printf("\tSwarm A: %d / %d\n", metrics.doneBySatellite[0], queue.days);
+		printf("\tSwarm B: %d / %d\n", metrics.doneBySatellite[1], queue.days);
+		printf("\tSwarm C: %d / %d\n", metrics.doneBySatellite[2], queue.days);
+		printf("Failed: %d\n", metrics.failed);
+		printf("Total time: %02d:%02d:%02d\n", hours, minutes, seconds);
+		printf("Run summary: %s\n", summaryFilename);
+		if (spool != NULL)
+			printf("Spool %s: %d todo, %d running, %d done, %d failed\n", spool->dir, spoolCounts.todo, spoolCounts.running, spoolCounts.done, spoolCounts.failed);
+	}
 
-int dayCount(char *startDate, char *endDate)
-{
-	int startDay = atoi(startDate+6);
-	startDate[6] = 0;
-	int startMonth = atoi(startDate+4);
-	startDate[4] = 0;
-	int startYear = atoi(startDate);
-
-	int endDay = atoi(endDate+6);
-	endDate[6] = 0;
-	int endMonth = atoi(endDate+4);
-	endDate[4] = 0;
-	int endYear = atoi(endDate);
-
-	struct tm d = {0};
-	d.tm_year = startYear - 1900;
-	d.tm_mon = startMonth - 1;
-	d.tm_mday = startDay;
-	time_t seconds = timegm(&d);
-
-	struct tm e = {0};
-	e.tm_year = endYear - 1900;
-	e.tm_mon = endMonth - 1;
-	e.tm_mday = endDay;
-	e.tm_hour = 23;
-	e.tm_min = 59;
-	e.tm_sec = 59;
-
-	time_t end = timegm(&e);
-
-	int count = 0;
-	while (seconds < end)
-	{
-		d.tm_mday = d.tm_mday + 1;
-		seconds = timegm(&d);
-		count++;
-	}
-
-	return count;
-		
-}
+	if (quit == true)
+	{
+		if (!persistent)
+			fprintf(headless ? stderr : stdout, "--> Processes may still be running. Use\n\t'for i in `pidof tracis`;do kill -9 $i;done'\nto kill them. There may be zip processes running as well.\n");
+	}
 
-void incrementDate(char *date)
-{
-	int start = atoi(date);
+	if (statusFile != NULL && statusFile != stdout)
+		fclose(statusFile);
 
-	int startDay = atoi(date+6);
-	date[6] = 0;
-	int startMonth = atoi(date+4);
-	date[4] = 0;
-	int startYear = atoi(date);
+	freeJobQueue(&queue);
 
-	struct tm d = {0};
-	d.tm_year = startYear - 1900;
-	d.tm_mon = startMonth - 1;
-	d.tm_mday = startDay + 1;
-	timegm(&d);
-	sprintf(date, "%04d%02d%02d", d.tm_year + 1900, d.tm_mon+1, d.tm_mday);
+	return 0;
 
-	return;
-		
 }
 
 void initScreen(void)
@@ -383,19 +707,105 @@ void *runThread(void *a)
 {
 	CommandArgs* args = (CommandArgs *)a;
 
-	// run tracis command as a system() call because CDF library is not thread safe
+	// run tracis in a child process because CDF library is not thread safe
 	int status = 0;
-	char command[3*FILENAME_MAX+256] = {0};
-	sprintf(command, "tracis %s%4d%02d%02d %s %s >> %s/%s%4d%02d%02d.log 2>&1 ", args->satLetter, args->year, args->month, args->day, args->modDir, args->outputDir, args->outputDir, args->satLetter, args->year, args->month, args->day);
-	status = system(command);
+	double start = monotonicSeconds();
+	double startUs = traceMicroseconds();
+	char name[JOB_NAME_LENGTH] = {0};
+	jobName(&args->job, name);
+	if (args->worker != NULL)
+	{
+		// Replace a worker that died on an earlier job
+		if (args->worker->pid <= 0)
+			startWorker(args->worker, args->placement, args->tracisOptions);
+		runWorkerJob(args->worker, &args->job, args->modDir, args->outputDir, &status, &args->peakRssKb);
+	}
+	else
+	{
+		char command[4*FILENAME_MAX+256] = {0};
+		sprintf(command, "tracis %s%s %s %s >> %s/%s.log 2>&1 ", args->tracisOptionString, name, args->modDir, args->outputDir, args->outputDir, name);
+		runCommand(command, &status, &args->peakRssKb, args->placement, &args->childPid);
+	}
+	args->wallTime = monotonicSeconds() - start;
+	char traceArgs[128];
+	snprintf(traceArgs, sizeof traceArgs, "\"status\": %d, \"peak_rss_kb\": %ld", status, args->peakRssKb);
+	traceSpan(args->trace, name, "job", args->slot, startUs, traceMicroseconds(), traceArgs);
 	args->returnValue = status;
 	args->threadRunning = false;
 
 	pthread_exit(NULL);
 }
 
+// Same as system(), but also returns the peak resident set size of the child in kB.
+// The child leads its own process group, given in childPid while it runs.
+int runCommand(const char *command, int *exitStatus, long *peakRssKb, const Placement *placement, volatile pid_t *childPid)
+{
+	struct rusage usage = {0};
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		*exitStatus = -1;
+		return -1;
+	}
+	if (pid == 0)
+	{
+		setpgid(0, 0);
+		applyPlacement(placement);
+		execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+		_exit(127);
+	}
+
+	setpgid(pid, pid);
+	*childPid = pid;
+
+	pid_t result = 0;
+	do
+	{
+		result = wait4(pid, exitStatus, 0, &usage);
+	} while (result < 0 && errno == EINTR);
+	*childPid = 0;
+	if (result < 0)
+	{
+		*exitStatus = -1;
+		return -1;
+	}
+	if (peakRssKb != NULL)
+		*peakRssKb = usage.ru_maxrss;
+
+	return 0;
+}
+
+void requestQuit(int sig)
+{
+	quitRequested = 1;
+}
+
 void cleanup(CommandArgs *args)
 {
 	args->threadRunning = false;
 	return;
 }
+
+void usage(const char *name)
+{
+	printf("usage:\t%s [options] startyyyymmdd endyyyymmdd modFileDir outputDir nthreads\n\t\tparallel processes Swarm TII L0 data to generate TRACIS product for specified satellite and date range.\n", name);
+	printf("\t%s --about\n\t\tprints copyright and license information.\n", name);
+	printf("options:\n");
+	printf("\t--headless\n\t\tno curses display. JSON-lines status records go to stdout unless --status-file is given.\n");
+	printf("\t--status-file=file\n\t\tappend JSON-lines job and status records to file.\n");
+	printf("\t--status-interval=seconds\n\t\tseconds between status records (default %d).\n", DEFAULT_STATUS_INTERVAL);
+	printf("\t--plan\n\t\tcheck MOD SC_1B and L0 (current directory) availability first, and only run days that have inputs and no TRACIS ZIP files yet.\n");
+	printf("\t--gap-report=file\n\t\timplies --plan. Days not run and why (default outputDir/tracisParallel_<start>_<end>_gaps.txt).\n");
+	printf("\t--adaptive=min:max\n\t\tadjust the number of concurrent processes between min and max from throughput and system iowait, starting at nthreads.\n");
+	printf("\t--adaptive-window=seconds\n\t\tseconds between --adaptive adjustments (default %d).\n", CONCURRENCY_DEFAULT_WINDOW);
+	printf("\t--numa\n\t\tpin each thread's tracis to the CPUs of one NUMA node (round robin) and bind its memory to that node.\n");
+	printf("\t--persistent\n\t\trun one long-lived 'tracis --worker' per thread instead of starting tracis for each day.\n");
+	printf("\t--shared-calibration\n\t\thave tracis processes on this node share one read-only copy of the detector geometry tables in shared memory (%s), removed at the end of the run.\n", CALIBRATION_SEGMENT_NAME);
+	printf("\t--trace=file\n\t\tappend Chrome trace-event JSON spans to file: each job on its thread slot, and the stages of each tracis run.\n");
+	printf("\t--spool=dir\n\t\tclaim jobs from a spool directory shared by tracisParallel instances on several nodes. Each instance adds its date range to the spool and runs until no jobs are left on any node.\n");
+	printf("\t--lease=seconds\n\t\tseconds without a heartbeat after which another instance may rerun a spool job (default %d). An instance that finds its lease taken over stops its copy of the job and discards the result.\n", SPOOL_DEFAULT_LEASE);
+	printf("\t--summary-file=file\n\t\tend-of-run JSON summary (default outputDir/tracisParallel_<start>_<end>_<runstart>_summary.json).\n");
+
+	return;
+}
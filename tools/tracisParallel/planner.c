@@ -0,0 +1,267 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/planner.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "planner.h"
+
+#include "tracis_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <dirent.h>
+#include <fts.h>
+
+// Days present in a directory, per satellite, for the planned date range
+typedef struct DayMap
+{
+	long firstDay;
+	int days;
+	bool *present;
+} DayMap;
+
+static long dayNumber(int year, int month, int day)
+{
+	struct tm d = {0};
+	d.tm_year = year - 1900;
+	d.tm_mon = month - 1;
+	d.tm_mday = day;
+
+	return (long)(timegm(&d) / 86400);
+}
+
+static bool parseDate(const char *s, long *day)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		if (!isdigit(s[i]))
+			return false;
+	}
+	char buf[9] = {0};
+	memcpy(buf, s, 8);
+	int y = 0;
+	int m = 0;
+	int d = 0;
+	ymd(buf, &y, &m, &d);
+	*day = dayNumber(y, m, d);
+
+	return true;
+}
+
+static void markDays(DayMap *map, char satellite, long first, long last)
+{
+	int sat = satellite - 'A';
+	if (sat < 0 || sat >= NUM_SATELLITES)
+		return;
+	if (first < map->firstDay)
+		first = map->firstDay;
+	if (last > map->firstDay + map->days - 1)
+		last = map->firstDay + map->days - 1;
+	for (long d = first; d <= last; d++)
+		map->present[sat * map->days + (d - map->firstDay)] = true;
+
+	return;
+}
+
+static bool dayPresent(DayMap *map, const Job *job)
+{
+	long d = dayNumber(job->year, job->month, job->day) - map->firstDay;
+	if (d < 0 || d >= map->days)
+		return false;
+
+	return map->present[job->satellite * map->days + d];
+}
+
+// Same naming rules as getInputFilename() in tracis
+static void indexModFiles(DayMap *map, const char *modDir)
+{
+	char *searchPath[2] = {(char *)modDir, NULL};
+	FTS *fts = fts_open(searchPath, FTS_PHYSICAL | FTS_NOCHDIR, NULL);
+	if (fts == NULL)
+		return;
+
+	long day = 0;
+	FTSENT *f = NULL;
+	while ((f = fts_read(fts)) != NULL)
+	{
+		size_t len = strlen(f->fts_name);
+		if ((len == 59 || len == 70) && strncmp(f->fts_name + 13, "SC_1B", 5) == 0 && parseDate(f->fts_name + 19, &day))
+			markDays(map, f->fts_name[11], day, day);
+	}
+	fts_close(fts);
+
+	return;
+}
+
+// L0 files are named SW_OPER_EFIX_0_..._yyyymmddThhmmss_yyyymmddThhmmss_vvvv
+// and can span more than one day. tracis reads them from its working directory.
+static void indexL0Files(DayMap *map, const char *l0Dir)
+{
+	DIR *dir = opendir(l0Dir);
+	if (dir == NULL)
+		return;
+
+	long first = 0;
+	long last = 0;
+	struct dirent *entry = NULL;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		const char *name = entry->d_name;
+		if (strlen(name) < 51 || strncmp(name + 8, "EFI", 3) != 0 || strncmp(name + 12, "_0", 2) != 0)
+			continue;
+		if (name[27] != 'T' || name[43] != 'T' || !parseDate(name + 19, &first) || !parseDate(name + 35, &last))
+			continue;
+		markDays(map, name[11], first, last);
+	}
+	closedir(dir);
+
+	return;
+}
+
+// tracis skips a day if either of its ZIP files exists
+static void indexOutputFiles(DayMap *map, const char *outputDir)
+{
+	DIR *dir = opendir(outputDir);
+	if (dir == NULL)
+		return;
+
+	long day = 0;
+	size_t expectedLength = TRACIS_BASE_FILENAME_LENGTH + 4;
+	struct dirent *entry = NULL;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		const char *name = entry->d_name;
+		if (strlen(name) != expectedLength || strcmp(name + TRACIS_BASE_FILENAME_LENGTH, ".ZIP") != 0)
+			continue;
+		if (strncmp(name + 12, TRACIS_PRODUCT_CODE_LR, 6) != 0 && strncmp(name + 12, TRACIS_PRODUCT_CODE_HR, 6) != 0)
+			continue;
+		if (strncmp(name + 51, EXPORT_VERSION_STRING, 4) != 0 || !parseDate(name + 19, &day))
+			continue;
+		markDays(map, name[11], day, day);
+	}
+	closedir(dir);
+
+	return;
+}
+
+static int initDayMap(DayMap *map, JobQueue *queue)
+{
+	map->firstDay = queue->nJobs > 0 ? dayNumber(queue->jobs[0].year, queue->jobs[0].month, queue->jobs[0].day) : 0;
+	map->days = queue->days;
+	map->present = calloc(NUM_SATELLITES * (queue->days > 0 ? queue->days : 1), sizeof(bool));
+	if (map->present == NULL)
+		return PLAN_MEM;
+
+	return PLAN_OK;
+}
+
+int planJobs(JobQueue *queue, const char *modDir, const char *l0Dir, const char *outputDir, int *reasons, PlanCounts *counts)
+{
+	DayMap mod = {0};
+	DayMap l0 = {0};
+	DayMap done = {0};
+	int status = PLAN_OK;
+
+	memset(counts, 0, sizeof(PlanCounts));
+
+	if (initDayMap(&mod, queue) != PLAN_OK || initDayMap(&l0, queue) != PLAN_OK || initDayMap(&done, queue) != PLAN_OK)
+	{
+		status = PLAN_MEM;
+		goto cleanup;
+	}
+
+	indexModFiles(&mod, modDir);
+	indexL0Files(&l0, l0Dir);
+	indexOutputFiles(&done, outputDir);
+
+	for (int i = 0; i < queue->nJobs; i++)
+	{
+		Job *job = &queue->jobs[i];
+		reasons[i] = PLAN_RUNNABLE;
+		if (!dayPresent(&mod, job))
+		{
+			reasons[i] |= PLAN_NO_MOD;
+			counts->noMod++;
+		}
+		if (!dayPresent(&l0, job))
+		{
+			reasons[i] |= PLAN_NO_L0;
+			counts->noL0++;
+		}
+		if (dayPresent(&done, job))
+		{
+			reasons[i] |= PLAN_DONE;
+			counts->done++;
+		}
+		if (reasons[i] == PLAN_RUNNABLE)
+			counts->runnable++;
+	}
+
+cleanup:
+	free(mod.present);
+	free(l0.present);
+	free(done.present);
+
+	return status;
+}
+
+int writeGapReport(const char *filename, JobQueue *queue, int *reasons, PlanCounts *counts)
+{
+	FILE *report = fopen(filename, "w");
+	if (report == NULL)
+		return PLAN_DIR;
+
+	fprintf(report, "# TRACIS input availability: %d runnable, %d without MOD SC_1B, %d without L0, %d already processed\n", counts->runnable, counts->noMod, counts->noL0, counts->done);
+	fprintf(report, "# job reasons\n");
+	char name[JOB_NAME_LENGTH] = {0};
+	for (int i = 0; i < queue->nJobs; i++)
+	{
+		if (reasons[i] == PLAN_RUNNABLE)
+			continue;
+		jobName(&queue->jobs[i], name);
+		fprintf(report, "%s", name);
+		if (reasons[i] & PLAN_NO_MOD)
+			fprintf(report, " no_mod");
+		if (reasons[i] & PLAN_NO_L0)
+			fprintf(report, " no_l0");
+		if (reasons[i] & PLAN_DONE)
+			fprintf(report, " done");
+		fprintf(report, "\n");
+	}
+	fclose(report);
+
+	return PLAN_OK;
+}
+
+void pruneJobQueue(JobQueue *queue, int *reasons)
+{
+	int n = 0;
+	for (int i = 0; i < queue->nJobs; i++)
+	{
+		if (reasons[i] == PLAN_RUNNABLE)
+			queue->jobs[n++] = queue->jobs[i];
+	}
+	queue->nJobs = n;
+	queue->next = 0;
+
+	return;
+}
@@ -0,0 +1,62 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/planner.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Pre-flight check of which satellite-days have inputs, so that tracis is
+// only started for days it can process
+
+#ifndef _TRACIS_PARALLEL_PLANNER_H
+#define _TRACIS_PARALLEL_PLANNER_H
+
+#include "jobs.h"
+
+// Bit flags: a job is runnable when none are set
+enum PLAN_REASON
+{
+	PLAN_RUNNABLE = 0,
+	PLAN_NO_MOD = 1,
+	PLAN_NO_L0 = 2,
+	PLAN_DONE = 4
+};
+
+typedef struct PlanCounts
+{
+	int runnable;
+	int noMod;
+	int noL0;
+	int done;
+} PlanCounts;
+
+enum PLAN_STATUS
+{
+	PLAN_OK = 0,
+	PLAN_MEM,
+	PLAN_DIR
+};
+
+// Indexes the MOD, L0 and output directories once each and sets reasons[i] for queue->jobs[i]
+int planJobs(JobQueue *queue, const char *modDir, const char *l0Dir, const char *outputDir, int *reasons, PlanCounts *counts);
+
+// Writes one line per job that will not be run
+int writeGapReport(const char *filename, JobQueue *queue, int *reasons, PlanCounts *counts);
+
+// Drops jobs that are not runnable, keeping the order of the rest
+void pruneJobQueue(JobQueue *queue, int *reasons);
+
+#endif // _TRACIS_PARALLEL_PLANNER_H
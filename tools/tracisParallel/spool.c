@@ -0,0 +1,328 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/spool.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "spool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static const char *spoolStates[] = {"todo", "running", "done", "failed"};
+#define SPOOL_N_STATES 4
+
+static void spoolPath(Spool *spool, const char *state, const char *name, char *path)
+{
+	if (name == NULL)
+		snprintf(path, FILENAME_MAX, "%s/%s", spool->dir, state);
+	else
+		snprintf(path, FILENAME_MAX, "%s/%s/%s", spool->dir, state, name);
+
+	return;
+}
+
+static int jobEntryFilter(const struct dirent *entry)
+{
+	Job job;
+	return parseJobName(entry->d_name, &job);
+}
+
+// Returns the number of job entries, or -1 if the directory cannot be read.
+// Names are sorted so that all nodes work through the spool in the same order.
+static int listJobs(Spool *spool, const char *state, struct dirent ***entries)
+{
+	char path[FILENAME_MAX];
+	spoolPath(spool, state, NULL, path);
+
+	return scandir(path, entries, jobEntryFilter, alphasort);
+}
+
+static void freeJobList(struct dirent **entries, int n)
+{
+	for (int i = 0; i < n; i++)
+		free(entries[i]);
+	free(entries);
+
+	return;
+}
+
+// Current time on the file server, from a file touched in the spool. Leases are
+// mtimes set by the server, so hosts' clocks need not agree. Falls back to the
+// local clock if the spool cannot be stamped.
+static time_t spoolNow(Spool *spool)
+{
+	char clockFile[FILENAME_MAX];
+	snprintf(clockFile, FILENAME_MAX, "%s/clock", spool->dir);
+	int fd = open(clockFile, O_CREAT | O_WRONLY, 0664);
+	if (fd >= 0)
+		close(fd);
+
+	struct stat s;
+	if (utimensat(AT_FDCWD, clockFile, NULL, 0) != 0 || stat(clockFile, &s) != 0)
+		return time(NULL);
+
+	return s.st_mtime;
+}
+
+static bool seedLockIsStale(Spool *spool, const char *lockFile, ino_t *inode)
+{
+	struct stat s;
+	if (stat(lockFile, &s) != 0)
+		return false;
+	*inode = s.st_ino;
+
+	return spoolNow(spool) - s.st_mtime > spool->leaseSeconds;
+}
+
+// Job entries in running/ and the seed lock start with the owner's "host pid"
+static bool ownsEntry(Spool *spool, const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return false;
+
+	char host[256];
+	int pid = 0;
+	bool owns = fscanf(f, "%255s %d", host, &pid) == 2 && strcmp(host, spool->host) == 0 && pid == (int)getpid();
+	fclose(f);
+
+	return owns;
+}
+
+// Moves a stale seed lock aside. Another seeder may have replaced it with a
+// fresh lock since it was judged stale; that one is put back.
+static void breakStaleSeedLock(Spool *spool, const char *lockFile, ino_t staleInode)
+{
+	char moved[FILENAME_MAX];
+	snprintf(moved, FILENAME_MAX, "%s.%s.%d", lockFile, spool->host, (int)getpid());
+	if (rename(lockFile, moved) != 0)
+		return;
+
+	struct stat s;
+	if (stat(moved, &s) == 0 && s.st_ino != staleInode)
+		rename(moved, lockFile);
+	else
+		unlink(moved);
+
+	return;
+}
+
+static bool jobKnown(Spool *spool, const char *name)
+{
+	char path[FILENAME_MAX];
+	for (int i = 0; i < SPOOL_N_STATES; i++)
+	{
+		spoolPath(spool, spoolStates[i], name, path);
+		if (access(path, F_OK) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+int initSpool(Spool *spool, const char *dir, int leaseSeconds, JobQueue *queue)
+{
+	snprintf(spool->dir, FILENAME_MAX, "%s", dir);
+	spool->leaseSeconds = leaseSeconds > 0 ? leaseSeconds : SPOOL_DEFAULT_LEASE;
+	if (gethostname(spool->host, sizeof(spool->host)) != 0)
+		snprintf(spool->host, sizeof(spool->host), "unknown");
+	spool->host[sizeof(spool->host) - 1] = '\0';
+
+	char path[FILENAME_MAX];
+	if (mkdir(spool->dir, 0775) != 0 && errno != EEXIST)
+		return SPOOL_DIR;
+	for (int i = 0; i < SPOOL_N_STATES; i++)
+	{
+		spoolPath(spool, spoolStates[i], NULL, path);
+		if (mkdir(path, 0775) != 0 && errno != EEXIST)
+			return SPOOL_DIR;
+	}
+
+	// Seeders take turns so that a job is never added twice. A lock older
+	// than a lease belongs to an instance that died while seeding.
+	char lockFile[FILENAME_MAX];
+	snprintf(lockFile, FILENAME_MAX, "%s/seed.lock", spool->dir);
+	int lock = -1;
+	ino_t staleInode = 0;
+	while ((lock = open(lockFile, O_CREAT | O_EXCL | O_WRONLY, 0664)) < 0)
+	{
+		if (errno != EEXIST)
+			return SPOOL_SEED;
+		if (seedLockIsStale(spool, lockFile, &staleInode))
+			breakStaleSeedLock(spool, lockFile, staleInode);
+		else
+			sleep(SPOOL_SEED_POLL);
+	}
+	dprintf(lock, "%s %d\n", spool->host, (int)getpid());
+	close(lock);
+
+	// Jobs already in the spool in any state are left alone, so that
+	// another node's range or a restarted run does not redo finished days
+	int status = SPOOL_OK;
+	char name[JOB_NAME_LENGTH];
+	for (int i = 0; i < queue->nJobs; i++)
+	{
+		jobName(&queue->jobs[i], name);
+		if (jobKnown(spool, name))
+			continue;
+		spoolPath(spool, "todo", name, path);
+		int fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0664);
+		if (fd >= 0)
+			close(fd);
+		else if (errno != EEXIST)
+		{
+			status = SPOOL_SEED;
+			break;
+		}
+	}
+
+	if (ownsEntry(spool, lockFile))
+		unlink(lockFile);
+
+	return status;
+}
+
+bool spoolClaimJob(Spool *spool, Job *job)
+{
+	struct dirent **entries = NULL;
+	int n = listJobs(spool, "todo", &entries);
+	if (n <= 0)
+	{
+		if (n == 0)
+			free(entries);
+		return false;
+	}
+
+	char todoPath[FILENAME_MAX];
+	char runningPath[FILENAME_MAX];
+	bool claimed = false;
+	for (int i = 0; i < n && !claimed; i++)
+	{
+		spoolPath(spool, "todo", entries[i]->d_name, todoPath);
+		spoolPath(spool, "running", entries[i]->d_name, runningPath);
+		// Start the lease before the move, so that the entry never appears
+		// in running/ with an old mtime
+		if (utimensat(AT_FDCWD, todoPath, NULL, 0) != 0)
+			continue;
+		if (rename(todoPath, runningPath) != 0)
+			continue;
+		claimed = parseJobName(entries[i]->d_name, job);
+		FILE *owner = fopen(runningPath, "w");
+		if (owner != NULL)
+		{
+			fprintf(owner, "%s %d %ld\n", spool->host, (int)getpid(), (long)time(NULL));
+			fclose(owner);
+		}
+	}
+	freeJobList(entries, n);
+
+	return claimed;
+}
+
+int spoolHeartbeat(Spool *spool, const Job *job)
+{
+	char name[JOB_NAME_LENGTH];
+	char path[FILENAME_MAX];
+	jobName(job, name);
+	spoolPath(spool, "running", name, path);
+
+	// After an expired lease the entry may have been reclaimed and claimed by another instance
+	if (!ownsEntry(spool, path) || utimensat(AT_FDCWD, path, NULL, 0) != 0)
+		return SPOOL_LOST_LEASE;
+
+	return SPOOL_OK;
+}
+
+int spoolFinishJob(Spool *spool, const Job *job, bool ok)
+{
+	char name[JOB_NAME_LENGTH];
+	char runningPath[FILENAME_MAX];
+	char finishedPath[FILENAME_MAX];
+	jobName(job, name);
+	spoolPath(spool, "running", name, runningPath);
+	spoolPath(spool, ok ? "done" : "failed", name, finishedPath);
+
+	if (!ownsEntry(spool, runningPath))
+		return SPOOL_LOST_LEASE;
+	if (rename(runningPath, finishedPath) != 0)
+		return errno == ENOENT ? SPOOL_LOST_LEASE : SPOOL_RENAME;
+
+	return SPOOL_OK;
+}
+
+int spoolReclaimExpiredJobs(Spool *spool)
+{
+	struct dirent **entries = NULL;
+	int n = listJobs(spool, "running", &entries);
+	if (n <= 0)
+	{
+		if (n == 0)
+			free(entries);
+		return 0;
+	}
+
+	char runningPath[FILENAME_MAX];
+	char todoPath[FILENAME_MAX];
+	struct stat s;
+	time_t now = spoolNow(spool);
+	int reclaimed = 0;
+	for (int i = 0; i < n; i++)
+	{
+		spoolPath(spool, "running", entries[i]->d_name, runningPath);
+		if (stat(runningPath, &s) != 0 || now - s.st_mtime <= spool->leaseSeconds)
+			continue;
+		spoolPath(spool, "todo", entries[i]->d_name, todoPath);
+		if (rename(runningPath, todoPath) == 0)
+			reclaimed++;
+	}
+	freeJobList(entries, n);
+
+	return reclaimed;
+}
+
+static int countJobs(Spool *spool, const char *state)
+{
+	struct dirent **entries = NULL;
+	int n = listJobs(spool, state, &entries);
+	if (n < 0)
+		return 0;
+	freeJobList(entries, n);
+
+	return n;
+}
+
+void spoolCountJobs(Spool *spool, SpoolCounts *counts)
+{
+	counts->todo = countJobs(spool, "todo");
+	counts->running = countJobs(spool, "running");
+	counts->done = countJobs(spool, "done");
+	counts->failed = countJobs(spool, "failed");
+
+	return;
+}
+
+bool spoolDrained(Spool *spool)
+{
+	return countJobs(spool, "todo") == 0 && countJobs(spool, "running") == 0;
+}
@@ -0,0 +1,92 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/spool.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Shared-filesystem job spool, so that tracisParallel instances on several
+// nodes can work through one date range without a central server.
+//
+// Each job is an empty file named Xyyyymmdd that moves between the
+// todo/, running/, done/ and failed/ subdirectories with rename(), which
+// is atomic, so exactly one instance wins a claim. The mtime of a file in
+// running/ is the lease: the owner touches it periodically, and any
+// instance may move a job whose lease has expired back to todo/. Lease ages
+// are measured against the mtime of a "clock" file touched in the spool, so
+// that only the file server's clock matters.
+// Entries in running/ record the owner's host and pid, and only the owner
+// may renew or finish them.
+// The first instance seeds todo/ from its date range, guarded by an
+// O_EXCL lock file; later instances use the spool as seeded.
+
+#ifndef _TRACIS_PARALLEL_SPOOL_H
+#define _TRACIS_PARALLEL_SPOOL_H
+
+#include "jobs.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define SPOOL_DEFAULT_LEASE 600 // seconds
+#define SPOOL_SEED_POLL 1 // seconds between checks for a finished seed
+
+typedef struct Spool
+{
+	char dir[FILENAME_MAX];
+	int leaseSeconds;
+	char host[256];
+} Spool;
+
+typedef struct SpoolCounts
+{
+	int todo;
+	int running;
+	int done;
+	int failed;
+} SpoolCounts;
+
+enum SPOOL_STATUS
+{
+	SPOOL_OK = 0,
+	SPOOL_DIR,
+	SPOOL_SEED,
+	SPOOL_LOST_LEASE,
+	SPOOL_RENAME
+};
+
+// Creates the spool directories and seeds todo/ with the queue's jobs if
+// no other instance has done so already
+int initSpool(Spool *spool, const char *dir, int leaseSeconds, JobQueue *queue);
+
+// Moves the first available job from todo/ to running/
+bool spoolClaimJob(Spool *spool, Job *job);
+
+// Renews the lease on a running job
+int spoolHeartbeat(Spool *spool, const Job *job);
+
+// Moves a running job to done/ or failed/
+int spoolFinishJob(Spool *spool, const Job *job, bool ok);
+
+// Returns jobs in running/ with an expired lease to todo/. Returns the number of jobs reclaimed.
+int spoolReclaimExpiredJobs(Spool *spool);
+
+void spoolCountJobs(Spool *spool, SpoolCounts *counts);
+
+// True once no jobs are waiting or running on any node
+bool spoolDrained(Spool *spool);
+
+#endif // _TRACIS_PARALLEL_SPOOL_H
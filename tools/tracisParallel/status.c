@@ -0,0 +1,274 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/status.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "status.h"
+
+#include "tracis_settings.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+
+// Writes s as a quoted JSON string
+static void writeJsonString(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (const unsigned char *c = (const unsigned char *)s; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			fprintf(f, "\\%c", *c);
+		else if (*c < 0x20)
+			fprintf(f, "\\u%04x", *c);
+		else
+			fputc(*c, f);
+	}
+	fputc('"', f);
+
+	return;
+}
+
+double monotonicSeconds(void)
+{
+	struct timespec ts = {0};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void initRunMetrics(RunMetrics *metrics, int totalJobs, FILE *statusFile)
+{
+	memset(metrics, 0, sizeof(RunMetrics));
+	metrics->statusFile = statusFile;
+	metrics->total = totalJobs;
+	metrics->startTime = monotonicSeconds();
+	metrics->startWallTime = time(NULL);
+
+	return;
+}
+
+void recordJobStart(RunMetrics *metrics)
+{
+	metrics->started++;
+	metrics->running++;
+
+	return;
+}
+
+void setRunNodes(RunMetrics *metrics, const NumaTopology *topology)
+{
+	metrics->nNodes = topology->nNodes;
+	for (int i = 0; i < topology->nNodes; i++)
+		metrics->nodeIds[i] = topology->nodeIds[i];
+
+	return;
+}
+
+bool jobSucceeded(int exitStatus)
+{
+	return WIFEXITED(exitStatus) && WEXITSTATUS(exitStatus) == 0;
+}
+
+void recordJobEnd(RunMetrics *metrics, int satelliteIndex, const char *satLetter, int year, int month, int day, int slot, int node, double wallTime, long peakRssKb, int exitStatus)
+{
+	bool ok = jobSucceeded(exitStatus);
+
+	metrics->running--;
+	metrics->done++;
+	if (satelliteIndex >= 0 && satelliteIndex < NUM_SATELLITES)
+		metrics->doneBySatellite[satelliteIndex]++;
+	if (!ok)
+	{
+		metrics->failed++;
+		if (satelliteIndex >= 0 && satelliteIndex < NUM_SATELLITES)
+			metrics->failedBySatellite[satelliteIndex]++;
+	}
+	metrics->totalJobWallTime += wallTime;
+	if (wallTime > metrics->maxJobWallTime)
+		metrics->maxJobWallTime = wallTime;
+	if (peakRssKb > metrics->maxPeakRssKb)
+		metrics->maxPeakRssKb = peakRssKb;
+	if (node >= 0 && node < metrics->nNodes)
+	{
+		metrics->doneByNode[node]++;
+		if (!ok)
+			metrics->failedByNode[node]++;
+		metrics->jobWallTimeByNode[node] += wallTime;
+	}
+
+	if (metrics->statusFile == NULL)
+		return;
+
+	char now[32] = {0};
+	isoDateString(time(NULL), now, sizeof(now));
+	int code = WIFEXITED(exitStatus) ? WEXITSTATUS(exitStatus) : -1;
+	fprintf(metrics->statusFile, "{\"event\":\"job\",\"time\":\"%s\",\"satellite\":", now);
+	writeJsonString(metrics->statusFile, satLetter);
+	fprintf(metrics->statusFile, ",\"date\":\"%04d%02d%02d\",\"slot\":%d,\"node\":%d,\"wall_s\":%.3f,\"peak_rss_kb\":%ld,\"exit_code\":%d,\"ok\":%s}\n", year, month, day, slot, node >= 0 && node < metrics->nNodes ? metrics->nodeIds[node] : -1, wallTime, peakRssKb, code, ok ? "true" : "false");
+	fflush(metrics->statusFile);
+
+	return;
+}
+
+void recordJobLost(RunMetrics *metrics, const char *satLetter, int year, int month, int day, int slot)
+{
+	metrics->running--;
+	metrics->lostLeases++;
+
+	if (metrics->statusFile == NULL)
+		return;
+
+	char now[32] = {0};
+	isoDateString(time(NULL), now, sizeof(now));
+	fprintf(metrics->statusFile, "{\"event\":\"lost_lease\",\"time\":\"%s\",\"satellite\":", now);
+	writeJsonString(metrics->statusFile, satLetter);
+	fprintf(metrics->statusFile, ",\"date\":\"%04d%02d%02d\",\"slot\":%d}\n", year, month, day, slot);
+	fflush(metrics->statusFile);
+
+	return;
+}
+
+double daysPerHour(RunMetrics *metrics)
+{
+	double elapsed = monotonicSeconds() - metrics->startTime;
+	if (elapsed <= 0.0)
+		return 0.0;
+
+	return (double)metrics->done / elapsed * 3600.0;
+}
+
+double estimatedSecondsRemaining(RunMetrics *metrics)
+{
+	double rate = daysPerHour(metrics);
+	if (metrics->done == 0 || rate <= 0.0)
+		return -1.0;
+	if (metrics->done >= metrics->total)
+		return 0.0;
+
+	return (double)(metrics->total - metrics->done) / rate * 3600.0;
+}
+
+void reportStatus(RunMetrics *metrics)
+{
+	if (metrics->statusFile == NULL)
+		return;
+
+	char now[32] = {0};
+	isoDateString(time(NULL), now, sizeof(now));
+	double elapsed = monotonicSeconds() - metrics->startTime;
+	// Spool jobs claimed from other nodes' ranges can push started past total
+	int queued = metrics->total > metrics->started ? metrics->total - metrics->started : 0;
+	fprintf(metrics->statusFile, "{\"event\":\"status\",\"time\":\"%s\",\"elapsed_s\":%.1f,\"total\":%d,\"queued\":%d,\"running\":%d,\"done\":%d,\"failed\":%d,\"days_per_hour\":%.2f,\"eta_s\":%.0f,\"concurrency\":%d,\"iowait\":%.3f}\n", now, elapsed, metrics->total, queued, metrics->running, metrics->done, metrics->failed, daysPerHour(metrics), estimatedSecondsRemaining(metrics), metrics->concurrency, metrics->iowait);
+	fflush(metrics->statusFile);
+
+	return;
+}
+
+void reportPlan(RunMetrics *metrics, int runnable, int noMod, int noL0, int done)
+{
+	if (metrics->statusFile == NULL)
+		return;
+
+	char now[32] = {0};
+	isoDateString(time(NULL), now, sizeof(now));
+	fprintf(metrics->statusFile, "{\"event\":\"plan\",\"time\":\"%s\",\"runnable\":%d,\"no_mod\":%d,\"no_l0\":%d,\"done\":%d}\n", now, runnable, noMod, noL0, done);
+	fflush(metrics->statusFile);
+
+	return;
+}
+
+void reportSpool(RunMetrics *metrics, const char *spoolDir, int todo, int running, int done, int failed, int reclaimed)
+{
+	if (metrics->statusFile == NULL)
+		return;
+
+	char now[32] = {0};
+	isoDateString(time(NULL), now, sizeof(now));
+	fprintf(metrics->statusFile, "{\"event\":\"spool\",\"time\":\"%s\",\"spool\":", now);
+	writeJsonString(metrics->statusFile, spoolDir);
+	fprintf(metrics->statusFile, ",\"todo\":%d,\"running\":%d,\"done\":%d,\"failed\":%d,\"reclaimed\":%d}\n", todo, running, done, failed, reclaimed);
+	fflush(metrics->statusFile);
+
+	return;
+}
+
+int writeRunSummary(RunMetrics *metrics, const char *filename, const char *startDate, const char *endDate, int nThreads, bool interrupted)
+{
+	FILE *summary = fopen(filename, "w");
+	if (summary == NULL)
+		return 1;
+
+	char started[32] = {0};
+	char finished[32] = {0};
+	isoDateString(metrics->startWallTime, started, sizeof(started));
+	isoDateString(time(NULL), finished, sizeof(finished));
+	double elapsed = monotonicSeconds() - metrics->startTime;
+	double meanJobWallTime = metrics->done > 0 ? metrics->totalJobWallTime / (double)metrics->done : 0.0;
+	char *satellites[NUM_SATELLITES] = {"A", "B", "C"};
+
+	fprintf(summary, "{\n");
+	fprintf(summary, "  \"tracis_version\": \"%s\",\n", EXPORT_VERSION_STRING);
+	fprintf(summary, "  \"start_date\": ");
+	writeJsonString(summary, startDate);
+	fprintf(summary, ",\n  \"end_date\": ");
+	writeJsonString(summary, endDate);
+	fprintf(summary, ",\n");
+	fprintf(summary, "  \"threads\": %d,\n", nThreads);
+	fprintf(summary, "  \"started\": \"%s\",\n", started);
+	fprintf(summary, "  \"finished\": \"%s\",\n", finished);
+	fprintf(summary, "  \"interrupted\": %s,\n", interrupted ? "true" : "false");
+	fprintf(summary, "  \"elapsed_s\": %.1f,\n", elapsed);
+	fprintf(summary, "  \"total\": %d,\n", metrics->total);
+	fprintf(summary, "  \"done\": %d,\n", metrics->done);
+	fprintf(summary, "  \"failed\": %d,\n", metrics->failed);
+	fprintf(summary, "  \"lost_leases\": %d,\n", metrics->lostLeases);
+	fprintf(summary, "  \"days_per_hour\": %.2f,\n", daysPerHour(metrics));
+	fprintf(summary, "  \"mean_job_wall_s\": %.3f,\n", meanJobWallTime);
+	fprintf(summary, "  \"max_job_wall_s\": %.3f,\n", metrics->maxJobWallTime);
+	fprintf(summary, "  \"max_peak_rss_kb\": %ld,\n", metrics->maxPeakRssKb);
+	fprintf(summary, "  \"satellites\": {");
+	for (int i = 0; i < NUM_SATELLITES; i++)
+		fprintf(summary, "%s\"%s\": {\"done\": %d, \"failed\": %d}", i > 0 ? ", " : "", satellites[i], metrics->doneBySatellite[i], metrics->failedBySatellite[i]);
+	fprintf(summary, "}");
+	if (metrics->nNodes > 0)
+	{
+		fprintf(summary, ",\n  \"numa_nodes\": [");
+		for (int i = 0; i < metrics->nNodes; i++)
+		{
+			double nodeDaysPerHour = elapsed > 0.0 ? (double)metrics->doneByNode[i] / elapsed * 3600.0 : 0.0;
+			double nodeMeanWallTime = metrics->doneByNode[i] > 0 ? metrics->jobWallTimeByNode[i] / (double)metrics->doneByNode[i] : 0.0;
+			fprintf(summary, "%s\n    {\"node\": %d, \"done\": %d, \"failed\": %d, \"days_per_hour\": %.2f, \"mean_job_wall_s\": %.3f}", i > 0 ? "," : "", metrics->nodeIds[i], metrics->doneByNode[i], metrics->failedByNode[i], nodeDaysPerHour, nodeMeanWallTime);
+		}
+		fprintf(summary, "\n  ]");
+	}
+	fprintf(summary, "\n}\n");
+
+	fclose(summary);
+
+	return 0;
+}
+
+void isoDateString(time_t seconds, char *dateString, size_t length)
+{
+	struct tm d = {0};
+	gmtime_r(&seconds, &d);
+	snprintf(dateString, length, "%04d-%02d-%02dT%02d:%02d:%02dZ", d.tm_year + 1900, d.tm_mon + 1, d.tm_mday, d.tm_hour, d.tm_min, d.tm_sec);
+
+	return;
+}
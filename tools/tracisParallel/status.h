@@ -0,0 +1,96 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/status.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TRACIS_PARALLEL_STATUS_H
+#define _TRACIS_PARALLEL_STATUS_H
+
+#include "jobs.h"
+#include "affinity.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Run-wide throughput bookkeeping. Counts are in jobs, one job being
+// one satellite-day.
+typedef struct RunMetrics
+{
+	FILE *statusFile;
+	int total;
+	int started;
+	int running;
+	int done;
+	int failed;
+	int lostLeases;
+	int doneBySatellite[NUM_SATELLITES];
+	int failedBySatellite[NUM_SATELLITES];
+	double startTime;
+	time_t startWallTime;
+	double totalJobWallTime;
+	double maxJobWallTime;
+	long maxPeakRssKb;
+	// Current number of concurrent jobs allowed, and system iowait fraction when measured
+	int concurrency;
+	double iowait;
+	// Per NUMA node, when slots are placed
+	int nNodes;
+	int nodeIds[MAX_NUMA_NODES];
+	int doneByNode[MAX_NUMA_NODES];
+	int failedByNode[MAX_NUMA_NODES];
+	double jobWallTimeByNode[MAX_NUMA_NODES];
+} RunMetrics;
+
+double monotonicSeconds(void);
+
+void initRunMetrics(RunMetrics *metrics, int totalJobs, FILE *statusFile);
+
+void recordJobStart(RunMetrics *metrics);
+
+// Enables per-node accounting for jobs placed with NUMA affinity
+void setRunNodes(RunMetrics *metrics, const NumaTopology *topology);
+
+// Updates the counters and, if a status file is set, writes a "job" JSON line
+void recordJobEnd(RunMetrics *metrics, int satelliteIndex, const char *satLetter, int year, int month, int day, int slot, int node, double wallTime, long peakRssKb, int exitStatus);
+
+// For a spool job another instance took over: frees its running slot without
+// counting it as done, and writes a "lost_lease" JSON line
+void recordJobLost(RunMetrics *metrics, const char *satLetter, int year, int month, int day, int slot);
+
+// Writes a periodic "status" JSON line
+void reportStatus(RunMetrics *metrics);
+
+// Writes a "plan" JSON line with the outcome of the input availability check
+void reportPlan(RunMetrics *metrics, int runnable, int noMod, int noL0, int done);
+
+// Writes a "spool" JSON line with job counts across all nodes sharing the spool
+void reportSpool(RunMetrics *metrics, const char *spoolDir, int todo, int running, int done, int failed, int reclaimed);
+
+double daysPerHour(RunMetrics *metrics);
+
+// Returns -1 if no job has finished yet
+double estimatedSecondsRemaining(RunMetrics *metrics);
+
+bool jobSucceeded(int exitStatus);
+
+int writeRunSummary(RunMetrics *metrics, const char *filename, const char *startDate, const char *endDate, int nThreads, bool interrupted);
+
+void isoDateString(time_t seconds, char *dateString, size_t length);
+
+#endif // _TRACIS_PARALLEL_STATUS_H
@@ -0,0 +1,166 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/workers.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "workers.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define WORKER_RESULT_LENGTH 256
+#define WORKER_MAX_ARGS 16
+
+int startWorker(Worker *worker, const Placement *placement, char *const *tracisOptions)
+{
+	worker->pid = 0;
+	worker->jobs = NULL;
+	worker->results = NULL;
+
+	// Close-on-exec keeps other workers' pipe ends out of this child,
+	// so each worker sees end of input when its own pipe is closed
+	int toWorker[2];
+	int fromWorker[2];
+	if (pipe2(toWorker, O_CLOEXEC) != 0)
+		return WORKER_START;
+	if (pipe2(fromWorker, O_CLOEXEC) != 0)
+	{
+		close(toWorker[0]);
+		close(toWorker[1]);
+		return WORKER_START;
+	}
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		close(toWorker[0]);
+		close(toWorker[1]);
+		close(fromWorker[0]);
+		close(fromWorker[1]);
+		return WORKER_START;
+	}
+	if (pid == 0)
+	{
+		dup2(toWorker[0], STDIN_FILENO);
+		dup2(fromWorker[1], STDOUT_FILENO);
+		applyPlacement(placement);
+		char *args[WORKER_MAX_ARGS] = {"tracis", "--worker"};
+		int nArgs = 2;
+		for (int i = 0; tracisOptions != NULL && tracisOptions[i] != NULL && nArgs < WORKER_MAX_ARGS - 1; i++)
+			args[nArgs++] = tracisOptions[i];
+		args[nArgs] = NULL;
+		execvp("tracis", args);
+		_exit(127);
+	}
+
+	close(toWorker[0]);
+	close(fromWorker[1]);
+	worker->pid = pid;
+	worker->jobs = fdopen(toWorker[1], "w");
+	worker->results = fdopen(fromWorker[0], "r");
+	if (worker->jobs == NULL || worker->results == NULL)
+	{
+		killWorker(worker);
+		return WORKER_START;
+	}
+
+	return WORKER_OK;
+}
+
+static void reapWorker(Worker *worker)
+{
+	if (worker->jobs != NULL)
+		fclose(worker->jobs);
+	if (worker->results != NULL)
+		fclose(worker->results);
+	worker->jobs = NULL;
+	worker->results = NULL;
+	if (worker->pid > 0)
+	{
+		while (waitpid(worker->pid, NULL, 0) < 0 && errno == EINTR)
+			;
+	}
+	worker->pid = 0;
+
+	return;
+}
+
+int runWorkerJob(Worker *worker, const Job *job, const char *modDir, const char *outputDir, int *exitStatus, long *peakRssKb)
+{
+	char name[JOB_NAME_LENGTH] = {0};
+	jobName(job, name);
+
+	*exitStatus = -1;
+	if (worker->pid <= 0)
+		return WORKER_DIED;
+
+	if (fprintf(worker->jobs, "%s %s %s\n", name, modDir, outputDir) < 0 || fflush(worker->jobs) != 0)
+	{
+		reapWorker(worker);
+		return WORKER_DIED;
+	}
+
+	char result[WORKER_RESULT_LENGTH];
+	char resultName[16] = {0};
+	int code = 0;
+	double wallTime = 0.0;
+	long rss = 0;
+	if (fgets(result, WORKER_RESULT_LENGTH, worker->results) == NULL || sscanf(result, "%15s %d %lf %ld", resultName, &code, &wallTime, &rss) != 4 || strcmp(resultName, name) != 0)
+	{
+		reapWorker(worker);
+		return WORKER_DIED;
+	}
+
+	*exitStatus = W_EXITCODE(code, 0);
+	if (peakRssKb != NULL)
+		*peakRssKb = rss;
+
+	return WORKER_OK;
+}
+
+void stopWorker(Worker *worker)
+{
+	reapWorker(worker);
+
+	return;
+}
+
+void signalWorker(Worker *worker, int signal)
+{
+	pid_t pid = worker->pid;
+	if (pid > 0)
+		kill(pid, signal);
+
+	return;
+}
+
+void killWorker(Worker *worker)
+{
+	if (worker->pid > 0)
+		kill(worker->pid, SIGTERM);
+	reapWorker(worker);
+
+	return;
+}
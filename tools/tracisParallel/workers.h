@@ -0,0 +1,65 @@
+/*
+
+    TRACIS Processor: tools/tracisParallel/workers.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Long-lived "tracis --worker" processes, one per slot, fed job lines over a pipe
+
+#ifndef _TRACIS_PARALLEL_WORKERS_H
+#define _TRACIS_PARALLEL_WORKERS_H
+
+#include "jobs.h"
+#include "affinity.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+typedef struct Worker
+{
+	pid_t pid;
+	FILE *jobs;
+	FILE *results;
+} Worker;
+
+enum WORKER_STATUS
+{
+	WORKER_OK = 0,
+	WORKER_START,
+	WORKER_DIED
+};
+
+// placement may be NULL. tracisOptions is a NULL-terminated list of extra tracis arguments.
+int startWorker(Worker *worker, const Placement *placement, char *const *tracisOptions);
+
+// Sends one job and waits for its status line. exitStatus is in wait() format,
+// so that it can be treated like that of a one-shot tracis run.
+// On WORKER_DIED the worker has been reaped and should be restarted.
+int runWorkerJob(Worker *worker, const Job *job, const char *modDir, const char *outputDir, int *exitStatus, long *peakRssKb);
+
+// Closes the job pipe so the worker exits after its current job, then waits for it
+void stopWorker(Worker *worker);
+
+// Terminates the worker without waiting for its current job
+void killWorker(Worker *worker);
+
+// Sends signal to the worker without reaping it, so that a thread waiting on
+// its results sees end of file. Safe to call while another thread uses the worker.
+void signalWorker(Worker *worker, int signal);
+
+#endif // _TRACIS_PARALLEL_WORKERS_H
@@ -0,0 +1,333 @@
+/*
+
+    TRACIS: tools/tracisRegression/cdf_compare.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cdf_compare.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <cdf.h>
+
+// 64-bit FNV-1a
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+typedef struct CdfVariable
+{
+    long numRecs;
+    long dataType;
+    long numElems;
+    long numDims;
+    long dimSizes[CDF_MAX_DIMS];
+    long recVary;
+    long dimVarys[CDF_MAX_DIMS];
+    CDFdata data;
+    size_t values; // over all records
+    long valueBytes;
+} CdfVariable;
+
+int readTolerances(const char *filename, Tolerances *tolerances)
+{
+    tolerances->n = 0;
+    FILE *f = fopen(filename, "r");
+    if (f == NULL)
+        return 0;
+
+    char line[512];
+    Tolerance *t = NULL;
+    while (tolerances->n < MAX_TOLERANCES && fgets(line, sizeof line, f) != NULL)
+    {
+        if (line[0] == '#')
+            continue;
+        t = &tolerances->entries[tolerances->n];
+        if (sscanf(line, "%127s %lf %lf", t->name, &t->absolute, &t->relative) == 3)
+            tolerances->n++;
+    }
+    fclose(f);
+
+    return 0;
+}
+
+static const Tolerance *findTolerance(const Tolerances *tolerances, const char *name)
+{
+    const Tolerance *wildcard = NULL;
+    for (int i = 0; i < tolerances->n; i++)
+    {
+        if (strcmp(tolerances->entries[i].name, name) == 0)
+            return &tolerances->entries[i];
+        if (strcmp(tolerances->entries[i].name, "*") == 0)
+            wildcard = &tolerances->entries[i];
+    }
+
+    return wildcard;
+}
+
+static int readVariable(CDFid id, long varNum, CdfVariable *v)
+{
+    memset(v, 0, sizeof(CdfVariable));
+    CDFstatus status = CDFreadzVarAllByVarID(id, varNum, &v->numRecs, &v->dataType, &v->numElems, &v->numDims, v->dimSizes, &v->recVary, v->dimVarys, &v->data);
+    if (status != CDF_OK)
+        return COMPARE_READ;
+    CDFgetDataTypeSize(v->dataType, &v->valueBytes);
+
+    size_t perRecord = (size_t)v->numElems;
+    for (long i = 0; i < v->numDims; i++)
+        perRecord *= (size_t)v->dimSizes[i];
+    v->values = perRecord * (size_t)(v->numRecs > 0 ? v->numRecs : 1);
+
+    return COMPARE_OK;
+}
+
+static void freeVariable(CdfVariable *v)
+{
+    if (v->data != NULL)
+        CDFdataFree(v->data);
+    v->data = NULL;
+}
+
+// Numeric value of element i, or NAN for types compared only bit-exact
+static double value(const CdfVariable *v, size_t i)
+{
+    const void *d = v->data;
+    switch (v->dataType)
+    {
+        case CDF_INT1:
+        case CDF_BYTE:
+            return ((const int8_t *)d)[i];
+        case CDF_UINT1:
+            return ((const uint8_t *)d)[i];
+        case CDF_INT2:
+            return ((const int16_t *)d)[i];
+        case CDF_UINT2:
+            return ((const uint16_t *)d)[i];
+        case CDF_INT4:
+            return ((const int32_t *)d)[i];
+        case CDF_UINT4:
+            return ((const uint32_t *)d)[i];
+        case CDF_INT8:
+        case CDF_TIME_TT2000:
+            return (double)((const int64_t *)d)[i];
+        case CDF_REAL4:
+        case CDF_FLOAT:
+            return ((const float *)d)[i];
+        case CDF_REAL8:
+        case CDF_DOUBLE:
+        case CDF_EPOCH:
+            return ((const double *)d)[i];
+        default:
+            return NAN;
+    }
+}
+
+// Types that value() converts
+static bool numericType(long dataType)
+{
+    return dataType != CDF_CHAR && dataType != CDF_UCHAR && dataType != CDF_EPOCH16;
+}
+
+static int digestVariable(CDFid id, long varNum, VariableDigest *d)
+{
+    CdfVariable v;
+    memset(d, 0, sizeof(VariableDigest));
+    if (CDFgetzVarName(id, varNum, d->name) != CDF_OK || readVariable(id, varNum, &v) != COMPARE_OK)
+        return COMPARE_READ;
+
+    d->dataType = v.dataType;
+    d->numRecs = v.numRecs;
+    d->values = v.numRecs > 0 ? v.values : 0;
+    d->hash = FNV_OFFSET;
+    const uint8_t *bytes = v.data;
+    size_t nBytes = d->values * (size_t)v.valueBytes;
+    for (size_t i = 0; i < nBytes; i++)
+        d->hash = (d->hash ^ bytes[i]) * FNV_PRIME;
+
+    d->sum = numericType(v.dataType) ? 0.0 : NAN;
+    d->min = NAN;
+    d->max = NAN;
+    double x = 0.0;
+    for (size_t i = 0; i < d->values && numericType(v.dataType); i++)
+    {
+        // Fill values that are NaN leave the sum, minimum and maximum alone
+        x = value(&v, i);
+        if (isnan(x))
+            continue;
+        d->sum += x;
+        d->min = fmin(d->min, x);
+        d->max = fmax(d->max, x);
+    }
+    freeVariable(&v);
+
+    return COMPARE_OK;
+}
+
+static void printDigest(FILE *f, const VariableDigest *d)
+{
+    fprintf(f, "%s %ld %ld %zu %016llx %.17g %.17g %.17g\n", d->name, d->dataType, d->numRecs, d->values, (unsigned long long)d->hash, d->sum, d->min, d->max);
+}
+
+static bool withinTolerance(double golden, double new, double absolute, const Tolerance *tolerance)
+{
+    if (isnan(golden) && isnan(new))
+        return true;
+
+    return fabs(new - golden) <= absolute + tolerance->relative * fabs(golden);
+}
+
+static int compareDigest(const VariableDigest *golden, const VariableDigest *new, const Tolerance *tolerance, FILE *report)
+{
+    if (golden->dataType != new->dataType || golden->numRecs != new->numRecs || golden->values != new->values)
+    {
+        fprintf(report, "  %s: type, records or values differ (type %ld/%ld, %ld/%ld records, %zu/%zu values)\n", golden->name, golden->dataType, new->dataType, golden->numRecs, new->numRecs, golden->values, new->values);
+        return COMPARE_DIFFERENT;
+    }
+    if (golden->hash == new->hash)
+        return COMPARE_OK;
+
+    // Not bit-exact. Character and other non-numeric variables have no tolerance.
+    if (tolerance == NULL || !numericType(golden->dataType))
+    {
+        fprintf(report, "  %s: differs and has no declared tolerance\n", golden->name);
+        return COMPARE_DIFFERENT;
+    }
+    // The sum may move by the absolute tolerance for every value
+    if (!withinTolerance(golden->sum, new->sum, tolerance->absolute * (double)golden->values, tolerance) || !withinTolerance(golden->min, new->min, tolerance->absolute, tolerance) || !withinTolerance(golden->max, new->max, tolerance->absolute, tolerance))
+    {
+        fprintf(report, "  %s: outside tolerance (absolute %g, relative %g): sum %.17g/%.17g, min %.17g/%.17g, max %.17g/%.17g\n", golden->name, tolerance->absolute, tolerance->relative, golden->sum, new->sum, golden->min, new->min, golden->max, new->max);
+        return COMPARE_DIFFERENT;
+    }
+    fprintf(report, "  %s: within tolerance, sum %.17g/%.17g\n", golden->name, golden->sum, new->sum);
+
+    return COMPARE_OK;
+}
+
+static CDFid openCdf(const char *filename, FILE *report)
+{
+    CDFid id = NULL;
+    CDFsetValidate(VALIDATEFILEoff);
+    if (CDFopenCDF(filename, &id) != CDF_OK)
+    {
+        fprintf(report, "  Could not open %s\n", filename);
+        return NULL;
+    }
+
+    return id;
+}
+
+int writeCdfDigests(const char *cdfFilename, FILE *f)
+{
+    CDFid id = openCdf(cdfFilename, stdout);
+    if (id == NULL)
+        return COMPARE_OPEN;
+
+    long n = 0;
+    CDFgetNumzVars(id, &n);
+    VariableDigest d;
+    int result = COMPARE_OK;
+    for (long i = 0; i < n && result == COMPARE_OK; i++)
+    {
+        result = digestVariable(id, i, &d);
+        if (result == COMPARE_OK)
+            printDigest(f, &d);
+    }
+    CDFcloseCDF(id);
+
+    return result;
+}
+
+int compareCdfDigests(const char *goldenFilename, const char *cdfFilename, const Tolerances *tolerances, FILE *report)
+{
+    FILE *f = fopen(goldenFilename, "r");
+    if (f == NULL)
+    {
+        fprintf(report, "  Could not open %s\n", goldenFilename);
+        return COMPARE_OPEN;
+    }
+    CDFid id = openCdf(cdfFilename, report);
+    if (id == NULL)
+    {
+        fclose(f);
+        return COMPARE_OPEN;
+    }
+
+    long nNew = 0;
+    CDFgetNumzVars(id, &nNew);
+    bool *seen = calloc(nNew > 0 ? nNew : 1, sizeof(bool));
+    if (seen == NULL)
+    {
+        fclose(f);
+        CDFcloseCDF(id);
+        return COMPARE_MEM;
+    }
+
+    char line[512];
+    unsigned long long hash = 0;
+    long varNum = 0;
+    VariableDigest golden;
+    VariableDigest new;
+    int result = COMPARE_OK;
+    int status = COMPARE_OK;
+    while (fgets(line, sizeof line, f) != NULL)
+    {
+        if (line[0] == '#')
+            continue;
+        memset(&golden, 0, sizeof(VariableDigest));
+        if (sscanf(line, "%127s %ld %ld %zu %llx %lf %lf %lf", golden.name, &golden.dataType, &golden.numRecs, &golden.values, &hash, &golden.sum, &golden.min, &golden.max) != 8)
+        {
+            fprintf(report, "  Malformed line in %s: %s", goldenFilename, line);
+            result = COMPARE_READ;
+            continue;
+        }
+        golden.hash = hash;
+        varNum = CDFgetVarNum(id, golden.name);
+        if (varNum < 0)
+        {
+            fprintf(report, "  %s: missing\n", golden.name);
+            result = COMPARE_DIFFERENT;
+            continue;
+        }
+        seen[varNum] = true;
+        status = digestVariable(id, varNum, &new);
+        if (status == COMPARE_OK)
+            status = compareDigest(&golden, &new, findTolerance(tolerances, golden.name), report);
+        else
+            fprintf(report, "  %s: could not be read\n", golden.name);
+        if (status != COMPARE_OK)
+            result = status;
+    }
+    fclose(f);
+
+    // Variables only in the new product
+    char name[CDF_VAR_NAME_LEN256 + 1];
+    for (long i = 0; i < nNew; i++)
+    {
+        if (!seen[i] && CDFgetzVarName(id, i, name) == CDF_OK)
+        {
+            fprintf(report, "  %s: not in golden product\n", name);
+            result = COMPARE_DIFFERENT;
+        }
+    }
+    free(seen);
+    CDFcloseCDF(id);
+
+    return result;
+}
@@ -0,0 +1,81 @@
+/*
+
+    TRACIS: tools/tracisRegression/cdf_compare.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Variable-by-variable comparison of a CDF product with golden digests of its
+// variables, small enough to commit: one line per variable with its type,
+// records, value count, a hash of the values and their sum, minimum and
+// maximum. Variables compare bit-exact by hash unless a tolerance is declared
+// for them, in which case the sum, minimum and maximum must agree within it.
+
+#ifndef _CDF_COMPARE_H
+#define _CDF_COMPARE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TOLERANCE_NAME_LENGTH 128
+#define MAX_TOLERANCES 256
+
+enum CompareStatus
+{
+    COMPARE_OK = 0,
+    COMPARE_DIFFERENT,
+    COMPARE_OPEN,
+    COMPARE_READ,
+    COMPARE_MEM
+};
+
+typedef struct VariableDigest
+{
+    char name[TOLERANCE_NAME_LENGTH];
+    long dataType;
+    long numRecs;
+    size_t values;
+    uint64_t hash; // FNV-1a of the values as stored
+    double sum; // NAN for non-numeric types
+    double min;
+    double max;
+} VariableDigest;
+
+// Values a and b match if |a - b| <= absolute + relative * |b|
+typedef struct Tolerance
+{
+    char name[TOLERANCE_NAME_LENGTH]; // "*" for all variables without their own
+    double absolute;
+    double relative;
+} Tolerance;
+
+typedef struct Tolerances
+{
+    Tolerance entries[MAX_TOLERANCES];
+    int n;
+} Tolerances;
+
+// Reads "name absolute relative" lines; # starts a comment. A missing file declares no tolerances.
+int readTolerances(const char *filename, Tolerances *tolerances);
+
+// Writes the digest of every zVariable of the CDF file to f
+int writeCdfDigests(const char *cdfFilename, FILE *f);
+
+// Compares every zVariable of the CDF file with the digests in goldenFilename, reporting differences to report.
+// Returns COMPARE_DIFFERENT if any variable is missing, extra, differently shaped or out of tolerance.
+int compareCdfDigests(const char *goldenFilename, const char *cdfFilename, const Tolerances *tolerances, FILE *report);
+
+#endif // _CDF_COMPARE_H
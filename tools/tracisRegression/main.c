@@ -0,0 +1,402 @@
+/*
+
+    TRACIS: tools/tracisRegression/main.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Runs tracis on a fixed day and checks its products against golden digests,
+// variable by variable, and its wall time, peak RSS and output size against
+// the golden run's. For ctest: exits 0 on success and 1 on a regression or if
+// the inputs or golden files are missing.
+
+#define _GNU_SOURCE
+
+#include "cdf_compare.h"
+#include "zip_member.h"
+
+#include "tracis_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define MAX_TRACIS_OPTIONS 16
+#define METRICS_FILENAME "metrics.txt"
+#define TOLERANCES_FILENAME "tolerances.txt"
+#define DEFAULT_MAX_TIME_INCREASE 10.0 // percent
+#define DEFAULT_MAX_RSS_INCREASE 10.0
+#define DEFAULT_MAX_SIZE_INCREASE 1.0
+
+enum Product
+{
+    PRODUCT_LR = 0,
+    PRODUCT_HR,
+    PRODUCTS
+};
+
+typedef struct RunMetrics
+{
+    double wallSeconds;
+    long peakRssKb;
+    long long outputBytes;
+} RunMetrics;
+
+static const char *productCodes[PRODUCTS] = {TRACIS_PRODUCT_CODE_LR, TRACIS_PRODUCT_CODE_HR};
+
+static void usage(const char *name)
+{
+    printf("\nTRACIS end-to-end regression check\n");
+    printf("\nUsage:\n");
+    printf("\n  %s [options] --tracis path --data dir --day Xyyyymmdd\n", name);
+    printf("\ndir contains l0/ (the working directory for tracis) and mod/. The golden directory holds\n");
+    printf("Xyyyymmdd_<product>.txt variable digests for each product, %s and optionally %s,\n", METRICS_FILENAME, TOLERANCES_FILENAME);
+    printf("with lines \"variable absolute relative\" (\"*\" for all others); other variables must match bit for bit.\n");
+    printf("Missing inputs or golden files are a failure.\n");
+    printf("\nOptions:\n");
+    printf("\n  --golden dir\n\tgolden directory (default dir/golden).\n");
+    printf("\n  --max-time-increase percent\n\tallowed wall time increase over the golden run (default %.0f).\n", DEFAULT_MAX_TIME_INCREASE);
+    printf("\n  --max-rss-increase percent\n\tallowed peak RSS increase (default %.0f).\n", DEFAULT_MAX_RSS_INCREASE);
+    printf("\n  --max-size-increase percent\n\tallowed increase in the size of the ZIP files (default %.0f).\n", DEFAULT_MAX_SIZE_INCREASE);
+    printf("\n  --tracis-option option\n\tpass option to tracis. May be repeated.\n");
+    printf("\n  --update-golden\n\treplace the golden digests and metrics with those of this run.\n");
+    printf("\n  --keep-output\n\tkeep the output directory, which is otherwise kept only on failure.\n");
+    printf("\n");
+}
+
+static bool isDirectory(const char *path)
+{
+    struct stat s;
+    return stat(path, &s) == 0 && S_ISDIR(s.st_mode);
+}
+
+static void productFilename(char *filename, const char *dir, const char *day, int product)
+{
+    snprintf(filename, FILENAME_MAX, "%s/SW_%s_EFI%c%s_%.8sT000000_%.8sT235959_%s.ZIP", dir, TRACIS_PRODUCT_TYPE, day[0], productCodes[product], day + 1, day + 1, EXPORT_VERSION_STRING);
+}
+
+static void digestFilename(char *filename, const char *dir, const char *day, int product)
+{
+    snprintf(filename, FILENAME_MAX, "%s/%s_%s.txt", dir, day, productCodes[product]);
+}
+
+// Stages the CDF file in a product ZIP file as cdfFilename
+static int extractCdf(const char *zipFilename, const char *cdfFilename)
+{
+    ZipMember member;
+    int zipStatus = findZipMember(zipFilename, ".cdf", &member);
+    if (zipStatus == ZIP_OK)
+        zipStatus = stageZipMember(zipFilename, &member, cdfFilename);
+    if (zipStatus != ZIP_OK)
+        printf("  Could not extract CDF file from %s: %s\n", zipFilename, zipStatusMessage(zipStatus));
+
+    return zipStatus;
+}
+
+static int runTracis(const char *tracis, char *const *tracisOptions, int nTracisOptions, const char *day, const char *l0Dir, const char *modDir, const char *outputDir, RunMetrics *metrics)
+{
+    char logFilename[FILENAME_MAX];
+    snprintf(logFilename, FILENAME_MAX, "%s/tracis.log", outputDir);
+
+    char *args[MAX_TRACIS_OPTIONS + 5];
+    int n = 0;
+    args[n++] = (char *)tracis;
+    for (int i = 0; i < nTracisOptions; i++)
+        args[n++] = tracisOptions[i];
+    args[n++] = (char *)day;
+    args[n++] = (char *)modDir;
+    args[n++] = (char *)outputDir;
+    args[n] = NULL;
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0)
+    {
+        int fd = open(logFilename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || chdir(l0Dir) != 0)
+            _exit(127);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+        execv(tracis, args);
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    metrics->wallSeconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    metrics->peakRssKb = usage.ru_maxrss;
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static int writeMetrics(const char *filename, const char *day, const RunMetrics *metrics)
+{
+    FILE *f = fopen(filename, "w");
+    if (f == NULL)
+        return 1;
+    fprintf(f, "# tracisRegression metrics for %s\n", day);
+    fprintf(f, "wall_seconds %.3f\n", metrics->wallSeconds);
+    fprintf(f, "peak_rss_kb %ld\n", metrics->peakRssKb);
+    fprintf(f, "output_bytes %lld\n", metrics->outputBytes);
+
+    return fclose(f) == 0 ? 0 : 1;
+}
+
+static int readMetrics(const char *filename, RunMetrics *metrics)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL)
+        return 1;
+
+    char line[256];
+    int found = 0;
+    while (fgets(line, sizeof line, f) != NULL)
+    {
+        if (sscanf(line, "wall_seconds %lf", &metrics->wallSeconds) == 1 || sscanf(line, "peak_rss_kb %ld", &metrics->peakRssKb) == 1 || sscanf(line, "output_bytes %lld", &metrics->outputBytes) == 1)
+            found++;
+    }
+    fclose(f);
+
+    return found == 3 ? 0 : 1;
+}
+
+// Returns true if the increase is within the allowed percentage
+static bool checkMetric(const char *name, double golden, double new, double maxIncrease)
+{
+    double change = golden > 0.0 ? 100.0 * (new - golden) / golden : 0.0;
+    bool ok = change <= maxIncrease;
+    printf("  %-14s %14.3f %14.3f %+9.1f%% (limit %+.1f%%)%s\n", name, golden, new, change, maxIncrease, ok ? "" : "  REGRESSION");
+
+    return ok;
+}
+
+static int removeEntry(const char *path, const struct stat *s, int flag, struct FTW *ftw)
+{
+    return remove(path);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *tracis = NULL;
+    const char *dataDir = NULL;
+    const char *goldenDirOption = NULL;
+    const char *day = NULL;
+    double maxTimeIncrease = DEFAULT_MAX_TIME_INCREASE;
+    double maxRssIncrease = DEFAULT_MAX_RSS_INCREASE;
+    double maxSizeIncrease = DEFAULT_MAX_SIZE_INCREASE;
+    char *tracisOptions[MAX_TRACIS_OPTIONS];
+    int nTracisOptions = 0;
+    bool updateGolden = false;
+    bool keepOutput = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            usage(argv[0]);
+            exit(0);
+        }
+        else if (strcmp(argv[i], "--tracis") == 0 && i + 1 < argc)
+            tracis = argv[++i];
+        else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc)
+            dataDir = argv[++i];
+        else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc)
+            goldenDirOption = argv[++i];
+        else if (strcmp(argv[i], "--day") == 0 && i + 1 < argc)
+            day = argv[++i];
+        else if (strcmp(argv[i], "--max-time-increase") == 0 && i + 1 < argc)
+            maxTimeIncrease = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-rss-increase") == 0 && i + 1 < argc)
+            maxRssIncrease = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-size-increase") == 0 && i + 1 < argc)
+            maxSizeIncrease = atof(argv[++i]);
+        else if (strcmp(argv[i], "--tracis-option") == 0 && i + 1 < argc && nTracisOptions < MAX_TRACIS_OPTIONS)
+            tracisOptions[nTracisOptions++] = argv[++i];
+        else if (strcmp(argv[i], "--update-golden") == 0)
+            updateGolden = true;
+        else if (strcmp(argv[i], "--keep-output") == 0)
+            keepOutput = true;
+        else
+        {
+            printf("Unrecognized option %s\n", argv[i]);
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (tracis == NULL || day == NULL || strlen(day) != 9)
+    {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    // tracis runs in l0Dir, so the other directories must be absolute
+    char data[PATH_MAX];
+    if (dataDir == NULL || dataDir[0] == '\0' || realpath(dataDir, data) == NULL)
+    {
+        printf("No regression data directory %s\n", dataDir != NULL ? dataDir : "");
+        exit(1);
+    }
+    char l0Dir[FILENAME_MAX];
+    char modDir[FILENAME_MAX];
+    char goldenDir[FILENAME_MAX];
+    char goldenMetricsFilename[FILENAME_MAX];
+    char tolerancesFilename[FILENAME_MAX];
+    snprintf(l0Dir, FILENAME_MAX, "%s/l0", data);
+    snprintf(modDir, FILENAME_MAX, "%s/mod", data);
+    if (goldenDirOption != NULL)
+        snprintf(goldenDir, FILENAME_MAX, "%s", goldenDirOption);
+    else
+        snprintf(goldenDir, FILENAME_MAX, "%s/golden", data);
+    snprintf(goldenMetricsFilename, FILENAME_MAX, "%s/%s", goldenDir, METRICS_FILENAME);
+    snprintf(tolerancesFilename, FILENAME_MAX, "%s/%s", goldenDir, TOLERANCES_FILENAME);
+    if (!isDirectory(l0Dir) || !isDirectory(modDir))
+    {
+        printf("%s has no l0 and mod directories\n", data);
+        exit(1);
+    }
+    RunMetrics golden = {0};
+    if (!updateGolden && readMetrics(goldenMetricsFilename, &golden))
+    {
+        printf("No golden run in %s. Record one with --update-golden (the tracis_golden target) and commit it.\n", goldenDir);
+        exit(1);
+    }
+
+    char tracisPath[PATH_MAX];
+    if (realpath(tracis, tracisPath) == NULL)
+    {
+        printf("Could not find %s\n", tracis);
+        exit(1);
+    }
+
+    char outputDir[FILENAME_MAX];
+    const char *tmpDir = getenv("TMPDIR");
+    snprintf(outputDir, FILENAME_MAX, "%s/tracis_regression_XXXXXX", tmpDir != NULL ? tmpDir : "/tmp");
+    if (mkdtemp(outputDir) == NULL)
+    {
+        printf("Could not create output directory: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    int status = 0;
+    RunMetrics metrics = {0};
+    char newFilenames[PRODUCTS][FILENAME_MAX];
+    char goldenFilenames[PRODUCTS][FILENAME_MAX];
+    char newCdfs[PRODUCTS][FILENAME_MAX];
+    struct stat s;
+
+    printf("Running %s %s\n", tracisPath, day);
+    int tracisStatus = runTracis(tracisPath, tracisOptions, nTracisOptions, day, l0Dir, modDir, outputDir, &metrics);
+    if (tracisStatus != 0)
+    {
+        printf("tracis exited with status %d; see %s/tracis.log\n", tracisStatus, outputDir);
+        status = 1;
+        goto cleanup;
+    }
+    for (int p = 0; p < PRODUCTS; p++)
+    {
+        productFilename(newFilenames[p], outputDir, day, p);
+        digestFilename(goldenFilenames[p], goldenDir, day, p);
+        snprintf(newCdfs[p], FILENAME_MAX, "%s/new_%s.cdf", outputDir, productCodes[p]);
+        if (stat(newFilenames[p], &s) != 0)
+        {
+            printf("tracis did not write %s\n", newFilenames[p]);
+            status = 1;
+            goto cleanup;
+        }
+        metrics.outputBytes += s.st_size;
+        if (extractCdf(newFilenames[p], newCdfs[p]) != ZIP_OK)
+        {
+            status = 1;
+            goto cleanup;
+        }
+    }
+
+    if (updateGolden)
+    {
+        mkdir(goldenDir, 0755);
+        FILE *f = NULL;
+        for (int p = 0; p < PRODUCTS; p++)
+        {
+            f = fopen(goldenFilenames[p], "w");
+            if (f == NULL)
+            {
+                status = 1;
+                continue;
+            }
+            fprintf(f, "# tracisRegression digests of %s for %s: name type records values hash sum min max\n", productCodes[p], day);
+            if (writeCdfDigests(newCdfs[p], f) != COMPARE_OK)
+                status = 1;
+            if (fclose(f) != 0)
+                status = 1;
+        }
+        if (status != 0 || writeMetrics(goldenMetricsFilename, day, &metrics))
+        {
+            printf("Could not update %s\n", goldenDir);
+            status = 1;
+            goto cleanup;
+        }
+        printf("Updated %s: %.3f s, %ld kB peak RSS, %lld bytes\n", goldenDir, metrics.wallSeconds, metrics.peakRssKb, metrics.outputBytes);
+        goto cleanup;
+    }
+
+    Tolerances tolerances;
+    readTolerances(tolerancesFilename, &tolerances);
+
+    for (int p = 0; p < PRODUCTS; p++)
+    {
+        printf("%s:\n", productCodes[p]);
+        if (compareCdfDigests(goldenFilenames[p], newCdfs[p], &tolerances, stdout) != COMPARE_OK)
+            status = 1;
+        else
+            printf("  all variables match\n");
+    }
+
+    printf("Metrics:\n");
+    printf("  %-14s %14s %14s\n", "", "golden", "this run");
+    if (!checkMetric("wall (s)", golden.wallSeconds, metrics.wallSeconds, maxTimeIncrease))
+        status = 1;
+    if (!checkMetric("peak RSS (kB)", (double)golden.peakRssKb, (double)metrics.peakRssKb, maxRssIncrease))
+        status = 1;
+    if (!checkMetric("output (B)", (double)golden.outputBytes, (double)metrics.outputBytes, maxSizeIncrease))
+        status = 1;
+
+cleanup:
+    if (status == 0 && !keepOutput)
+        nftw(outputDir, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    else
+        printf("Output kept in %s\n", outputDir);
+    printf("%s\n", status == 0 ? "PASSED" : "FAILED");
+
+    return status;
+}
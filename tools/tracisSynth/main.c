@@ -0,0 +1,313 @@
+/*
+
+    TRACIS: tools/tracisSynth/main.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Writes synthetic MODx_SC_1B orbit files and EFI L0 files of TII image and
+// science packets for a span of hours to days, for benchmarking and load
+// testing tracis and tracisParallel without flight data.
+
+#include "orbit.h"
+#include "tii_stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define SYNTH_VERSION "1.0.0"
+#define MAX_GAPS 1024
+#define MAX_RANDOM_GAP_MINUTES 20
+
+static void usage(const char *name)
+{
+    printf("\nTRACIS synthetic input generator version %s compiled %s %s UTC\n", SYNTH_VERSION, __DATE__, __TIME__);
+    printf("\nUsage:\n");
+    printf("\n  %s [options] satellites yyyymmdd[Thh]\n", name);
+    printf("\nsatellites is one or more of A, B and C. Writes one MOD%c_SC_1B SP3 file and one\n", 'x');
+    printf("SW_OPER_EFIx_0_SYN_... L0 file per satellite and UTC day, starting at the given time.\n");
+    printf("Packet layouts are described in tii_stream.h. Image packets have the sizes of libtii's\n");
+    printf("FullImagePacket and FullImageContinuedPacket.\n");
+    printf("\nOptions:\n");
+    printf("\n  --hours h\n\tspan to generate (default 24).\n");
+    printf("\n  --days d\n\tsame as --hours 24d.\n");
+    printf("\n  --mod-dir dir\n\tdirectory for MOD files, created if needed (default .).\n");
+    printf("\n  --l0-dir dir\n\tdirectory for L0 files, created if needed (default .).\n");
+    printf("\n  --duty-cycle f\n\tfraction of each orbit with high voltages on (default 1).\n");
+    printf("\n  --image-interval s\n\tseconds between image pairs (default 1). Science packets are 2 Hz.\n");
+    printf("\n  --bias V, --mcp V, --phosphor V, --faceplate V\n\tvoltages while on (defaults -62, -1800, 4000, -3).\n");
+    printf("\n  --gap hours,minutes\n\tno packets for minutes starting hours after the start. May be repeated.\n");
+    printf("\n  --random-gaps n\n\tn gaps of up to %d minutes at random in each day.\n", MAX_RANDOM_GAP_MINUTES);
+    printf("\n  --anomaly-rate f\n\tfraction of images with an anomaly pattern (default 0.02).\n");
+    printf("\n  --anomalies list\n\tcomma-separated patterns to use, from");
+    for (int i = 1; i < SYNTH_ANOMALIES; i++)
+        printf(" %s", synthAnomalyNames[i]);
+    printf(" (default all).\n");
+    printf("\n  --gcr-rate n\n\tmean cosmic ray hits per image (default 0.5).\n");
+    printf("\n  --seed n\n\tseed for noise, hits, gaps and anomalies (default 1).\n");
+    printf("\n  --help\n\tprint this message.\n");
+    printf("\n");
+}
+
+// Creates dir and any missing parents
+static int makeDirectory(const char *dir)
+{
+    char path[FILENAME_MAX];
+    snprintf(path, FILENAME_MAX, "%s", dir);
+    for (char *p = path + 1; *p != '\0'; p++)
+    {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST)
+            return 1;
+        *p = '/';
+    }
+
+    return mkdir(path, 0755) != 0 && errno != EEXIST;
+}
+
+static int parseStart(const char *s, double *start)
+{
+    struct tm tm = {0};
+    int hour = 0;
+    if (strlen(s) < 8 || sscanf(s, "%4d%2d%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3)
+        return 1;
+    if (s[8] == 'T' && sscanf(s + 9, "%2d", &hour) != 1)
+        return 1;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_hour = hour;
+    *start = (double)timegm(&tm);
+
+    return 0;
+}
+
+static int parseAnomalies(char *list, unsigned int *anomalies)
+{
+    *anomalies = 0;
+    int found = 0;
+    for (char *name = strtok(list, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        found = 0;
+        for (int i = 1; i < SYNTH_ANOMALIES; i++)
+        {
+            if (strcmp(name, synthAnomalyNames[i]) == 0)
+            {
+                *anomalies |= 1u << i;
+                found = 1;
+            }
+        }
+        if (!found && strcmp(name, "none") != 0)
+        {
+            fprintf(stderr, "Unrecognized anomaly %s\n", name);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    TiiSettings settings = {0};
+    settings.dutyCycle = 1.0;
+    settings.imageInterval = 1.0;
+    settings.biasGridVoltage = -62.0;
+    settings.mcpVoltage = -1800.0;
+    settings.phosphorVoltage = 4000.0;
+    settings.faceplateVoltage = -3.0;
+    settings.anomalyRate = 0.02;
+    settings.gcrRate = 0.5;
+    for (int i = 1; i < SYNTH_ANOMALIES; i++)
+        settings.anomalies |= 1u << i;
+
+    double hours = 24.0;
+    const char *modDir = ".";
+    const char *l0Dir = ".";
+    uint32_t seed = 1;
+    int randomGaps = 0;
+    Gap gaps[MAX_GAPS];
+    int nGaps = 0;
+    // Explicit gaps are relative to the start until it is known
+    double gapHours = 0.0;
+    double gapMinutes = 0.0;
+
+    const char *satellites = NULL;
+    const char *startString = NULL;
+    int nArgs = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            usage(argv[0]);
+            exit(0);
+        }
+        else if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc)
+            hours = atof(argv[++i]);
+        else if (strcmp(argv[i], "--days") == 0 && i + 1 < argc)
+            hours = 24.0 * atof(argv[++i]);
+        else if (strcmp(argv[i], "--mod-dir") == 0 && i + 1 < argc)
+            modDir = argv[++i];
+        else if (strcmp(argv[i], "--l0-dir") == 0 && i + 1 < argc)
+            l0Dir = argv[++i];
+        else if (strcmp(argv[i], "--duty-cycle") == 0 && i + 1 < argc)
+            settings.dutyCycle = atof(argv[++i]);
+        else if (strcmp(argv[i], "--image-interval") == 0 && i + 1 < argc)
+            settings.imageInterval = atof(argv[++i]);
+        else if (strcmp(argv[i], "--bias") == 0 && i + 1 < argc)
+            settings.biasGridVoltage = atof(argv[++i]);
+        else if (strcmp(argv[i], "--mcp") == 0 && i + 1 < argc)
+            settings.mcpVoltage = atof(argv[++i]);
+        else if (strcmp(argv[i], "--phosphor") == 0 && i + 1 < argc)
+            settings.phosphorVoltage = atof(argv[++i]);
+        else if (strcmp(argv[i], "--faceplate") == 0 && i + 1 < argc)
+            settings.faceplateVoltage = atof(argv[++i]);
+        else if (strcmp(argv[i], "--gap") == 0 && i + 1 < argc)
+        {
+            if (nGaps >= MAX_GAPS || sscanf(argv[++i], "%lf,%lf", &gapHours, &gapMinutes) != 2 || gapMinutes <= 0.0)
+            {
+                fprintf(stderr, "Invalid gap %s: expected hours,minutes\n", argv[i]);
+                exit(1);
+            }
+            gaps[nGaps].start = gapHours * 3600.0;
+            gaps[nGaps].stop = gaps[nGaps].start + gapMinutes * 60.0;
+            nGaps++;
+        }
+        else if (strcmp(argv[i], "--random-gaps") == 0 && i + 1 < argc)
+            randomGaps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--anomaly-rate") == 0 && i + 1 < argc)
+            settings.anomalyRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--anomalies") == 0 && i + 1 < argc)
+        {
+            if (parseAnomalies(argv[++i], &settings.anomalies))
+                exit(1);
+        }
+        else if (strcmp(argv[i], "--gcr-rate") == 0 && i + 1 < argc)
+            settings.gcrRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            printf("Unrecognized option %s\n", argv[i]);
+            usage(argv[0]);
+            exit(1);
+        }
+        else if (nArgs == 0)
+        {
+            satellites = argv[i];
+            nArgs++;
+        }
+        else if (nArgs == 1)
+        {
+            startString = argv[i];
+            nArgs++;
+        }
+        else
+        {
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    double start = 0.0;
+    if (nArgs != 2 || parseStart(startString, &start) || hours <= 0.0 || settings.imageInterval <= 0.0 || settings.dutyCycle < 0.0 || settings.dutyCycle > 1.0)
+    {
+        usage(argv[0]);
+        exit(1);
+    }
+    if (makeDirectory(modDir) || makeDirectory(l0Dir))
+    {
+        fprintf(stderr, "Could not create %s or %s\n", modDir, l0Dir);
+        exit(1);
+    }
+    double stop = start + hours * 3600.0;
+    for (int i = 0; i < nGaps; i++)
+    {
+        gaps[i].start += start;
+        gaps[i].stop += start;
+    }
+
+    // Random gaps are the same for every satellite
+    uint32_t gapSeed = seed;
+    double firstDay = floor(start / 86400.0) * 86400.0;
+    for (double day = firstDay; day < stop && randomGaps > 0; day += 86400.0)
+    {
+        for (int i = 0; i < randomGaps && nGaps < MAX_GAPS; i++)
+        {
+            gapSeed = gapSeed * 1664525u + 1013904223u;
+            gaps[nGaps].start = day + (double)(gapSeed >> 8) / 16777216.0 * 86400.0;
+            gapSeed = gapSeed * 1664525u + 1013904223u;
+            gaps[nGaps].stop = gaps[nGaps].start + 60.0 * (1 + (gapSeed >> 8) % MAX_RANDOM_GAP_MINUTES);
+            nGaps++;
+        }
+    }
+    settings.gaps = gaps;
+    settings.nGaps = nGaps;
+
+    OrbitModel orbit;
+    char filename[FILENAME_MAX];
+    TiiStreamCounts counts;
+    size_t records = 0;
+    double dayStart = 0.0;
+    double dayStop = 0.0;
+    int status = 0;
+    for (const char *satellite = satellites; *satellite != '\0' && status == 0; satellite++)
+    {
+        if (initOrbit(&orbit, *satellite))
+        {
+            fprintf(stderr, "Invalid satellite %c\n", *satellite);
+            exit(1);
+        }
+        for (double day = firstDay; day < stop; day += 86400.0)
+        {
+            dayStart = day > start ? day : start;
+            dayStop = day + 86400.0 < stop ? day + 86400.0 : stop;
+
+            if (writeModFile(&orbit, *satellite, dayStart, dayStop, modDir, filename, &records))
+            {
+                fprintf(stderr, "Could not write %s\n", filename);
+                status = 1;
+                break;
+            }
+            printf("%s: %zu records\n", filename, records);
+
+            status = writeTiiStream(&settings, &orbit, *satellite, dayStart, dayStop, seed ^ ((uint32_t)*satellite << 24) ^ (uint32_t)(day / 86400.0) * 2654435761u, l0Dir, filename, &counts);
+            if (status == 2)
+            {
+                fprintf(stderr, "libtii's image packets are too small for a %d-pixel image\n", IMAGE_PIXELS);
+                break;
+            }
+            if (status != 0)
+            {
+                fprintf(stderr, "Could not write %s\n", filename);
+                status = 1;
+                break;
+            }
+            printf("%s: %zu image packets, %zu science packets, %zu anomalies, %.1f MB\n", filename, counts.imagePackets, counts.sciencePackets, counts.anomalies, counts.bytes / 1e6);
+            fflush(stdout);
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,70 @@
+#!/bin/bash
+
+# TRACIS: tools/tracisSynth/synthetic_day_test.sh
+
+# Copyright (C) 2023  Johnathan K Burchill
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+# Generates three hours of synthetic inputs with tracisSynth, processes the day
+# with tracis, and checks that every generated image pair and 2 Hz sample was
+# decoded and that both products were exported.
+
+if test "$#" -ne "3"; then
+  echo "Usage: $0 tracisSynth tracis workDir"
+  exit 1
+fi
+
+synth=$1
+tracis=$2
+workDir=$3
+
+satellite=A
+day=20200101
+hours=3
+imageInterval=2
+expectedImagePairs=$((hours * 3600 / imageInterval))
+expectedColumnSums=$((hours * 3600 * 2))
+
+rm -rf "$workDir"
+mkdir -p "$workDir/out" || exit 1
+
+"$synth" --hours $hours --image-interval $imageInterval --l0-dir "$workDir/l0" --mod-dir "$workDir/mod" $satellite $day || exit 1
+
+(cd "$workDir/l0" && "$tracis" --profile $satellite$day "$workDir/mod" "$workDir/out") || { echo "tracis failed"; exit 1; }
+
+profile="$workDir/out/${satellite}${day}_profile.json"
+if ! test -f "$profile"; then
+  echo "tracis wrote no profile"
+  exit 1
+fi
+imagePairs=$(sed -n 's/.*"image_pairs": \([0-9]*\).*/\1/p' "$profile")
+columnSums=$(sed -n 's/.*"column_sums": \([0-9]*\).*/\1/p' "$profile")
+status=0
+if test "$imagePairs" != "$expectedImagePairs"; then
+  echo "decoded $imagePairs image pairs, generated $expectedImagePairs"
+  status=1
+fi
+if test "$columnSums" != "$expectedColumnSums"; then
+  echo "decoded $columnSums column sums, generated $expectedColumnSums"
+  status=1
+fi
+for product in TISL1B TISH1B; do
+  if ! ls "$workDir/out"/SW_OPER_EFI${satellite}${product}_${day}T000000_*.ZIP > /dev/null 2>&1; then
+    echo "no $product product"
+    status=1
+  fi
+done
+
+exit $status
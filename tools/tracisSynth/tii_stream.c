@@ -0,0 +1,462 @@
+/*
+
+    TRACIS: tools/tracisSynth/tii_stream.c
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tii_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include <tii/isp.h>
+
+#define PRIMARY_HEADER_BYTES 6
+#define SECONDARY_HEADER_BYTES 6
+#define HEADER_BYTES (PRIMARY_HEADER_BYTES + SECONDARY_HEADER_BYTES)
+#define IMAGE_AUX_BYTES (4 + 6 * 4)
+#define IMAGE_PIXEL_BYTES (IMAGE_PIXELS * 3 / 2)
+#define FULL_IMAGE_PAYLOAD_BYTES (sizeof(FullImagePacket) - HEADER_BYTES)
+#define CONTINUED_IMAGE_PAYLOAD_BYTES (sizeof(FullImageContinuedPacket) - HEADER_BYTES)
+#define SCIENCE_PAYLOAD_BYTES (6 * 4 + 2 * COLUMN_SUMS * 2)
+#define LARGER(a, b) ((a) > (b) ? (a) : (b))
+#define MAX_PACKET_BYTES LARGER(LARGER(sizeof(FullImagePacket), sizeof(FullImageContinuedPacket)), HEADER_BYTES + SCIENCE_PAYLOAD_BYTES)
+
+#define SENSOR_H 0
+#define SENSOR_V 1
+#define SENSORS 2
+#define CENTRE_COLUMN 20.0
+#define CENTRE_ROW 33.0
+#define INNER_DOME_PIXELS 29.5
+#define BACKGROUND_COUNTS 20
+#define PEAK_COUNTS 1500.0
+#define RING_WIDTH 2.0 // pixels, Gaussian sigma
+#define PROFILE_STEPS_PER_PIXEL 20
+#define PROFILE_PIXELS 40
+#define COLUMN_SUM_FIRST_COLUMN 4
+#define COLUMN_SUM_SCALE 8
+
+const char *synthAnomalyNames[SYNTH_ANOMALIES] = {
+    "none",
+    "classic_wing",
+    "peripheral",
+    "angels_wing",
+    "bifurcation",
+    "measles"
+};
+
+typedef struct StreamState
+{
+    const TiiSettings *settings;
+    const OrbitModel *orbit;
+    FILE *f;
+    uint32_t random;
+    uint16_t sequence[EFI_APIDS];
+    float radius[SENSORS][IMAGE_PIXELS];
+    float cosAngle[SENSORS][IMAGE_PIXELS];
+    float sinAngle[SENSORS][IMAGE_PIXELS];
+    float profile[PROFILE_PIXELS * PROFILE_STEPS_PER_PIXEL];
+    uint16_t pixels[IMAGE_PIXELS];
+    uint8_t pixelBytes[IMAGE_PIXEL_BYTES];
+    uint8_t packet[MAX_PACKET_BYTES];
+    TiiStreamCounts *counts;
+} StreamState;
+
+static uint32_t nextRandom(StreamState *s)
+{
+    uint32_t x = s->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    s->random = x;
+    return x;
+}
+
+static double uniform(StreamState *s)
+{
+    return (double)nextRandom(s) / 4294967296.0;
+}
+
+static void initGeometry(StreamState *s)
+{
+    double x = 0.0;
+    double y = 0.0;
+    double r = 0.0;
+    for (int sensor = 0; sensor < SENSORS; sensor++)
+    {
+        for (int i = 0; i < IMAGE_COLS; i++)
+        {
+            for (int j = 0; j < IMAGE_ROWS; j++)
+            {
+                // V sensor image is offset a little, as for the flight detectors
+                x = CENTRE_COLUMN + 0.7 * sensor - (double)i;
+                y = CENTRE_ROW - 0.5 * sensor - (double)j;
+                r = hypot(x, y);
+                s->radius[sensor][i * IMAGE_ROWS + j] = (float)r;
+                s->cosAngle[sensor][i * IMAGE_ROWS + j] = r > 0.0 ? (float)(x / r) : 1.0f;
+                s->sinAngle[sensor][i * IMAGE_ROWS + j] = r > 0.0 ? (float)(y / r) : 0.0f;
+            }
+        }
+    }
+    for (int i = 0; i < PROFILE_PIXELS * PROFILE_STEPS_PER_PIXEL; i++)
+    {
+        r = (double)i / PROFILE_STEPS_PER_PIXEL;
+        s->profile[i] = (float)exp(-0.5 * r * r / (RING_WIDTH * RING_WIDTH));
+    }
+}
+
+static float ringProfile(const StreamState *s, float distance)
+{
+    int index = (int)(fabsf(distance) * PROFILE_STEPS_PER_PIXEL);
+    return index < PROFILE_PIXELS * PROFILE_STEPS_PER_PIXEL ? s->profile[index] : 0.0f;
+}
+
+static bool highVoltageOn(const StreamState *s, double t)
+{
+    double fraction = fmod(s->orbit->phase + s->orbit->angularRate * t, 2.0 * M_PI) / (2.0 * M_PI);
+    return fraction < s->settings->dutyCycle;
+}
+
+static bool inGap(const StreamState *s, double t)
+{
+    for (int i = 0; i < s->settings->nGaps; i++)
+    {
+        if (t >= s->settings->gaps[i].start && t < s->settings->gaps[i].stop)
+            return true;
+    }
+
+    return false;
+}
+
+// Ion ring whose radius and bright side follow latitude, roughly as for thermal ions in the ram flow
+static void ringParameters(const StreamState *s, double t, float *ringRadius, float *cosPeak, float *sinPeak, float *intensity)
+{
+    double position[3];
+    double velocity[3];
+    double latitude = 0.0;
+    orbitState(s->orbit, t, position, velocity, &latitude, NULL);
+    double lat = latitude * M_PI / 180.0;
+    double peak = 40.0 * M_PI / 180.0 * sin(2.0 * lat);
+    *ringRadius = (float)(17.0 + 3.0 * cos(lat));
+    *cosPeak = (float)cos(peak);
+    *sinPeak = (float)sin(peak);
+    *intensity = (float)(PEAK_COUNTS * (0.4 + 0.6 * cos(lat) * cos(lat)));
+}
+
+static void addAnomaly(StreamState *s, int sensor, int anomaly, float ringRadius, float intensity)
+{
+    const float *radius = s->radius[sensor];
+    const float *sinAngle = s->sinAngle[sensor];
+    const float *cosAngle = s->cosAngle[sensor];
+    float value = 0.0;
+    for (int i = 0; i < IMAGE_PIXELS; i++)
+    {
+        value = 0.0;
+        switch (anomaly)
+        {
+            case SYNTH_ANOMALY_CLASSIC_WING:
+                // Bright arcs above and below the ring
+                if (fabsf(sinAngle[i]) > 0.85f)
+                    value = 0.6f * intensity * ringProfile(s, radius[i] - ringRadius - 8.0f);
+                break;
+            case SYNTH_ANOMALY_PERIPHERAL:
+                if (radius[i] > INNER_DOME_PIXELS - 2.0f)
+                    value = 400.0f;
+                break;
+            case SYNTH_ANOMALY_ANGELS_WING:
+                if (sinAngle[i] > 0.5f && cosAngle[i] > -0.2f)
+                    value = 0.5f * intensity * ringProfile(s, radius[i] - ringRadius - 6.0f);
+                break;
+            case SYNTH_ANOMALY_BIFURCATION:
+                // Second ring inside the first
+                value = 0.8f * intensity * ringProfile(s, radius[i] - ringRadius + 6.0f);
+                break;
+            default:
+                break;
+        }
+        if (value > 0.0f)
+            s->pixels[i] = (uint16_t)fminf(MAX_PIXEL_VALUE, s->pixels[i] + value);
+    }
+    if (anomaly == SYNTH_ANOMALY_MEASLES)
+    {
+        for (int k = 0; k < 30; k++)
+            s->pixels[nextRandom(s) % IMAGE_PIXELS] = (uint16_t)(2000 + nextRandom(s) % 1000);
+    }
+}
+
+static void addCosmicRays(StreamState *s)
+{
+    double hits = s->settings->gcrRate;
+    int n = (int)hits + (uniform(s) < hits - floor(hits) ? 1 : 0);
+    uint32_t pixel = 0;
+    for (int k = 0; k < n; k++)
+    {
+        pixel = nextRandom(s) % IMAGE_PIXELS;
+        s->pixels[pixel] = (uint16_t)(1500 + nextRandom(s) % 2500);
+        // Some hits leave a short track
+        if (nextRandom(s) % 3 == 0 && pixel + IMAGE_ROWS < IMAGE_PIXELS)
+            s->pixels[pixel + IMAGE_ROWS] = (uint16_t)(1000 + nextRandom(s) % 2000);
+    }
+}
+
+static int makeImage(StreamState *s, int sensor, double t, bool hvOn)
+{
+    float ringRadius = 0.0;
+    float cosPeak = 0.0;
+    float sinPeak = 0.0;
+    float intensity = 0.0;
+    float value = 0.0;
+    ringParameters(s, t, &ringRadius, &cosPeak, &sinPeak, &intensity);
+
+    const float *radius = s->radius[sensor];
+    const float *cosAngle = s->cosAngle[sensor];
+    const float *sinAngle = s->sinAngle[sensor];
+    for (int i = 0; i < IMAGE_PIXELS; i++)
+    {
+        value = (float)(nextRandom(s) % BACKGROUND_COUNTS);
+        if (hvOn && radius[i] < INNER_DOME_PIXELS)
+            value += intensity * ringProfile(s, radius[i] - ringRadius) * (1.0f + 0.5f * (cosAngle[i] * cosPeak + sinAngle[i] * sinPeak));
+        s->pixels[i] = (uint16_t)fminf(MAX_PIXEL_VALUE, value);
+    }
+
+    int anomaly = SYNTH_ANOMALY_NONE;
+    if (hvOn && s->settings->anomalies != 0 && uniform(s) < s->settings->anomalyRate)
+    {
+        do
+            anomaly = 1 + nextRandom(s) % (SYNTH_ANOMALIES - 1);
+        while ((s->settings->anomalies & (1u << anomaly)) == 0);
+        addAnomaly(s, sensor, anomaly, ringRadius, intensity);
+        s->counts->anomalies++;
+    }
+    addCosmicRays(s);
+
+    return anomaly;
+}
+
+static uint8_t *putUint16(uint8_t *p, uint16_t value)
+{
+    value = htons(value);
+    memcpy(p, &value, 2);
+    return p + 2;
+}
+
+static uint8_t *putUint32(uint8_t *p, uint32_t value)
+{
+    value = htonl(value);
+    memcpy(p, &value, 4);
+    return p + 4;
+}
+
+static uint8_t *putFloat(uint8_t *p, float value)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &value, 4);
+    return putUint32(p, bits);
+}
+
+// Fills the headers for a payload of the given size and returns where the payload goes
+static uint8_t *startPacket(StreamState *s, int apid, double t, size_t payloadBytes)
+{
+    uint16_t *sequence = &s->sequence[apid - EFI_APID_IMAGE_H];
+    uint8_t *p = s->packet;
+    // Version 0, telemetry, secondary header present
+    p = putUint16(p, (uint16_t)(0x0800 | (apid & 0x07ff)));
+    // Unsegmented
+    p = putUint16(p, (uint16_t)(0xc000 | (*sequence & 0x3fff)));
+    p = putUint16(p, (uint16_t)(SECONDARY_HEADER_BYTES + payloadBytes - 1));
+    *sequence = (*sequence + 1) & 0x3fff;
+
+    double seconds = floor(t);
+    p = putUint32(p, (uint32_t)(seconds - SYNTH_SECONDS_TO_2000));
+    p = putUint16(p, (uint16_t)((t - seconds) * 65536.0));
+
+    return p;
+}
+
+static int finishPacket(StreamState *s, size_t payloadBytes)
+{
+    size_t bytes = HEADER_BYTES + payloadBytes;
+    if (fwrite(s->packet, 1, bytes, s->f) != bytes)
+        return 1;
+    s->counts->bytes += bytes;
+
+    return 0;
+}
+
+// Two 12-bit pixels in every three bytes
+static void packPixels(StreamState *s)
+{
+    uint8_t *p = s->pixelBytes;
+    for (int i = 0; i < IMAGE_PIXELS; i += 2)
+    {
+        *p++ = (uint8_t)(s->pixels[i] >> 4);
+        *p++ = (uint8_t)((s->pixels[i] & 0x0f) << 4 | s->pixels[i + 1] >> 8);
+        *p++ = (uint8_t)(s->pixels[i + 1] & 0xff);
+    }
+}
+
+// Full image packet with the auxiliary data and the first pixels, then a continued packet with the rest
+static int writeImagePackets(StreamState *s, int sensor, double t, bool hvOn)
+{
+    int anomaly = makeImage(s, sensor, t, hvOn);
+    packPixels(s);
+    const TiiSettings *settings = s->settings;
+    double orbitPhase = s->orbit->phase + s->orbit->angularRate * t;
+
+    uint8_t *p = startPacket(s, sensor == SENSOR_H ? EFI_APID_IMAGE_H : EFI_APID_IMAGE_V, t, FULL_IMAGE_PAYLOAD_BYTES);
+    memset(p, 0, FULL_IMAGE_PAYLOAD_BYTES);
+    *p++ = (uint8_t)sensor;
+    *p++ = (uint8_t)anomaly;
+    p = putUint16(p, (uint16_t)(100 + nextRandom(s) % 8));
+    p = putFloat(p, hvOn ? settings->biasGridVoltage : 0.0f);
+    p = putFloat(p, hvOn ? settings->mcpVoltage : 0.0f);
+    p = putFloat(p, hvOn ? settings->phosphorVoltage : 0.0f);
+    p = putFloat(p, settings->faceplateVoltage);
+    // CCD warms on the dayside
+    p = putFloat(p, (float)(-10.0 + 4.0 * sin(orbitPhase)));
+    p = putFloat(p, 1.0f);
+    size_t firstBytes = FULL_IMAGE_PAYLOAD_BYTES - IMAGE_AUX_BYTES;
+    if (firstBytes > IMAGE_PIXEL_BYTES)
+        firstBytes = IMAGE_PIXEL_BYTES;
+    memcpy(p, s->pixelBytes, firstBytes);
+    if (finishPacket(s, FULL_IMAGE_PAYLOAD_BYTES))
+        return 1;
+
+    p = startPacket(s, sensor == SENSOR_H ? EFI_APID_IMAGE_H_CONTINUED : EFI_APID_IMAGE_V_CONTINUED, t, CONTINUED_IMAGE_PAYLOAD_BYTES);
+    memset(p, 0, CONTINUED_IMAGE_PAYLOAD_BYTES);
+    memcpy(p, s->pixelBytes + firstBytes, IMAGE_PIXEL_BYTES - firstBytes);
+    s->counts->imagePackets += 2;
+
+    return finishPacket(s, CONTINUED_IMAGE_PAYLOAD_BYTES);
+}
+
+static int writeSciencePacket(StreamState *s, double t, bool hvOn)
+{
+    const TiiSettings *settings = s->settings;
+    uint8_t *p = startPacket(s, EFI_APID_SCIENCE, t, SCIENCE_PAYLOAD_BYTES);
+    for (int sensor = 0; sensor < SENSORS; sensor++)
+    {
+        p = putFloat(p, hvOn ? settings->biasGridVoltage : 0.0f);
+        p = putFloat(p, hvOn ? settings->mcpVoltage : 0.0f);
+        p = putFloat(p, hvOn ? settings->phosphorVoltage : 0.0f);
+    }
+
+    // Column sums of the noise-free ring
+    float ringRadius = 0.0;
+    float cosPeak = 0.0;
+    float sinPeak = 0.0;
+    float intensity = 0.0;
+    ringParameters(s, t, &ringRadius, &cosPeak, &sinPeak, &intensity);
+    float sum = 0.0;
+    int pixel = 0;
+    for (int sensor = 0; sensor < SENSORS; sensor++)
+    {
+        for (int k = 0; k < COLUMN_SUMS; k++)
+        {
+            sum = 0.0;
+            for (int j = 0; j < IMAGE_ROWS; j++)
+            {
+                pixel = (COLUMN_SUM_FIRST_COLUMN + k) * IMAGE_ROWS + j;
+                sum += BACKGROUND_COUNTS / 2;
+                if (hvOn && s->radius[sensor][pixel] < INNER_DOME_PIXELS)
+                    sum += intensity * ringProfile(s, s->radius[sensor][pixel] - ringRadius) * (1.0f + 0.5f * (s->cosAngle[sensor][pixel] * cosPeak + s->sinAngle[sensor][pixel] * sinPeak));
+            }
+            p = putUint16(p, (uint16_t)fminf(65535.0f, sum / COLUMN_SUM_SCALE));
+        }
+    }
+    s->counts->sciencePackets++;
+
+    return finishPacket(s, SCIENCE_PAYLOAD_BYTES);
+}
+
+static void formatTime(double t, char *buf, size_t size)
+{
+    time_t seconds = (time_t)floor(t);
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    snprintf(buf, size, "%04d%02d%02dT%02d%02d%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+int writeTiiStream(const TiiSettings *settings, const OrbitModel *orbit, char satellite, double start, double stop, uint32_t seed, const char *dir, char *filename, TiiStreamCounts *counts)
+{
+    if (stop <= start)
+        return 1;
+    if (sizeof(FullImagePacket) < HEADER_BYTES + IMAGE_AUX_BYTES || sizeof(FullImageContinuedPacket) < HEADER_BYTES || FULL_IMAGE_PAYLOAD_BYTES - IMAGE_AUX_BYTES + CONTINUED_IMAGE_PAYLOAD_BYTES < IMAGE_PIXEL_BYTES)
+        return 2;
+
+    memset(counts, 0, sizeof(TiiStreamCounts));
+
+    char first[32];
+    char last[32];
+    formatTime(start, first, sizeof first);
+    formatTime(stop - 1.0, last, sizeof last);
+    snprintf(filename, FILENAME_MAX, "%s/SW_OPER_EFI%c_0_SYN_%s_%s_%s.DBL", dir, satellite, first, last, SYNTH_L0_FILE_VERSION);
+
+    static StreamState state;
+    StreamState *s = &state;
+    memset(s, 0, sizeof(StreamState));
+    s->settings = settings;
+    s->orbit = orbit;
+    s->counts = counts;
+    s->random = seed != 0 ? seed : 2463534242u;
+    initGeometry(s);
+
+    s->f = fopen(filename, "w");
+    if (s->f == NULL)
+        return 1;
+
+    // Packets in time order: image pairs every imageInterval, science every SCIENCE_INTERVAL
+    double imageTime = ceil(start / settings->imageInterval) * settings->imageInterval;
+    double scienceTime = ceil(start / SCIENCE_INTERVAL) * SCIENCE_INTERVAL;
+    long imageIndex = 0;
+    long scienceIndex = 0;
+    double t = 0.0;
+    int status = 0;
+    while (status == 0)
+    {
+        double nextImage = imageTime + imageIndex * settings->imageInterval;
+        double nextScience = scienceTime + scienceIndex * SCIENCE_INTERVAL;
+        if (nextImage >= stop && nextScience >= stop)
+            break;
+        if (nextScience <= nextImage)
+        {
+            t = nextScience;
+            scienceIndex++;
+            if (!inGap(s, t))
+                status = writeSciencePacket(s, t, highVoltageOn(s, t));
+        }
+        else
+        {
+            t = nextImage;
+            imageIndex++;
+            if (!inGap(s, t))
+            {
+                status = writeImagePackets(s, SENSOR_H, t, highVoltageOn(s, t));
+                if (status == 0)
+                    status = writeImagePackets(s, SENSOR_V, t, highVoltageOn(s, t));
+            }
+        }
+    }
+
+    if (fclose(s->f) != 0)
+        status = 1;
+
+    return status;
+}
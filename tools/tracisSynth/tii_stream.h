@@ -0,0 +1,115 @@
+/*
+
+    TRACIS: tools/tracisSynth/tii_stream.h
+
+    Copyright (C) 2023  Johnathan K Burchill
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Synthetic EFI L0 files of TII image pairs and 2 Hz science packets in CCSDS
+// space packets, named SW_OPER_EFIx_0_SYN_<first>_<last>_vvvv.DBL like the
+// flight L0 files read by tracis, the tracisParallel planner and libtii. The
+// SYN in the file type keeps them apart from flight data.
+//
+// Each packet has the 6-byte CCSDS primary header (secondary header flag set)
+// and a 6-byte secondary header: uint32 seconds since 2000-01-01T00:00:00 UTC
+// and uint16 1/65536 s. Payloads are big-endian:
+//
+//   full image (APID EFI_APID_IMAGE_H or _V), sizeof(FullImagePacket) bytes:
+//     uint8 sensor, uint8 anomaly pattern, uint16 CCD dark current,
+//     float32 bias grid, MCP, phosphor and faceplate voltage monitors,
+//     float32 CCD temperature and shutter duty cycle,
+//     then 12-bit pixels, column by column, two in every three bytes
+//
+//   continued image (APID EFI_APID_IMAGE_H_CONTINUED or _V_CONTINUED),
+//   sizeof(FullImageContinuedPacket) bytes:
+//     the rest of the pixels, zero padded
+//
+//   science (APID EFI_APID_SCIENCE), 2 Hz:
+//     float32 bias grid, MCP and phosphor voltage settings for H then V,
+//     uint16 column sums H[COLUMN_SUMS], V[COLUMN_SUMS]
+
+#ifndef _TII_STREAM_H
+#define _TII_STREAM_H
+
+#include "orbit.h"
+#include "tracis_settings.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define EFI_APID_IMAGE_H 0x3c0
+#define EFI_APID_IMAGE_V 0x3c1
+#define EFI_APID_SCIENCE 0x3c2
+#define EFI_APID_IMAGE_H_CONTINUED 0x3c3
+#define EFI_APID_IMAGE_V_CONTINUED 0x3c4
+#define EFI_APIDS 5
+#define SYNTH_SECONDS_TO_2000 946684800L
+#define SYNTH_L0_FILE_VERSION "0001"
+
+#define IMAGE_PIXELS (IMAGE_COLS * IMAGE_ROWS)
+#define MAX_PIXEL_VALUE 4095 // 12-bit DN
+#define COLUMN_SUMS COLUMN_SUM_ENERGY_BINS
+#define SCIENCE_INTERVAL 0.5 // s
+
+enum SynthAnomaly
+{
+    SYNTH_ANOMALY_NONE = 0,
+    SYNTH_ANOMALY_CLASSIC_WING,
+    SYNTH_ANOMALY_PERIPHERAL,
+    SYNTH_ANOMALY_ANGELS_WING,
+    SYNTH_ANOMALY_BIFURCATION,
+    SYNTH_ANOMALY_MEASLES,
+    SYNTH_ANOMALIES
+};
+
+typedef struct Gap
+{
+    double start; // seconds since 1970
+    double stop;
+} Gap;
+
+typedef struct TiiSettings
+{
+    double dutyCycle; // fraction of each orbit with high voltages on
+    double imageInterval; // s between image pairs
+    float biasGridVoltage;
+    float mcpVoltage;
+    float phosphorVoltage;
+    float faceplateVoltage;
+    double anomalyRate; // fraction of images with an anomaly pattern
+    unsigned int anomalies; // bit (1 << SynthAnomaly) for each pattern to use
+    double gcrRate; // cosmic ray hits per image
+    const Gap *gaps;
+    int nGaps;
+} TiiSettings;
+
+typedef struct TiiStreamCounts
+{
+    size_t imagePackets;
+    size_t sciencePackets;
+    size_t anomalies;
+    size_t bytes;
+} TiiStreamCounts;
+
+extern const char *synthAnomalyNames[SYNTH_ANOMALIES];
+
+// Writes the packets from start to stop (seconds since 1970) as one L0 file in dir.
+// seed selects the noise, hits and anomalies. Returns 0 on success, 1 if the file
+// could not be written and 2 if libtii's image packets cannot hold an image.
+int writeTiiStream(const TiiSettings *settings, const OrbitModel *orbit, char satellite, double start, double stop, uint32_t seed, const char *dir, char *filename, TiiStreamCounts *counts);
+
+#endif // _TII_STREAM_H